@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+
+// Monotonic time for the benchmark programs
+inline uint64_t benchNowNs () {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+// Runs body (iterations) in growing batches until at least seconds have gone by; returns ns per iteration
+template<typename Body> double benchRun (double seconds, Body body) {
+    uint64_t const budget = (uint64_t) (seconds * 1.0e9);
+    uint64_t iterations = 0, batch = 16, elapsed = 0;
+
+    while (elapsed < budget) {
+        uint64_t started = benchNowNs ();
+
+        body (batch);
+
+        elapsed += benchNowNs () - started;
+        iterations += batch;
+
+        if (batch < (1u << 24)) batch *= 2;
+    }
+
+    return (double) elapsed / (double) iterations;
+}
+
+// Keeps the optimizer from dropping work whose result is otherwise unused
+template<typename T> inline void benchKeep (const T& value) {
+    static volatile T sink;
+
+    sink = value;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "conversion.h"
+#include "lamp.h"
+#include "bench.h"
+
+// Elevation <-> range for 4096 lamps at a time, libm against the fast polynomials, batch and one value at a time
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    size_t const count = 4096;
+    double const mastHeight = 10.0;
+    std::vector<double> elevations (count), ranges (count), converted (count);
+    double sum = 0.0;
+
+    // shuffled, so the steep and the flat branch alternate unpredictably
+    for (size_t i = 0; i < count; ++ i) {
+        ranges [i] = 1.0 + (MAX_RANGE - 1.0) * (double) (i * 7919 % count) / count;
+        elevations [i] = range2elevation (mastHeight, ranges [i]);
+    }
+
+    struct Case {
+        const char *name;
+        ConversionMode mode;
+        bool toRange;
+    };
+
+    Case const cases [] = {
+        { "libm elevation -> range", ConversionMode::ExactConversion, true },
+        { "fast elevation -> range", ConversionMode::FastConversion, true },
+        { "libm range -> elevation", ConversionMode::ExactConversion, false },
+        { "fast range -> elevation", ConversionMode::FastConversion, false },
+    };
+
+    for (const Case& test: cases) {
+        double batch = benchRun (seconds, [&] (uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++ i) {
+                if (test.toRange) {
+                    elevations2ranges (test.mode, mastHeight, elevations.data (), converted.data (), count);
+                } else {
+                    ranges2elevations (test.mode, mastHeight, ranges.data (), converted.data (), count);
+                }
+
+                sum += converted [i & (count - 1)];
+            }
+        });
+        double single = benchRun (seconds, [&] (uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++ i) {
+                double value = test.toRange ? elevations [i & (count - 1)] : ranges [i & (count - 1)];
+
+                sum += test.toRange ? convertElevation2range (test.mode, mastHeight, value) : convertRange2elevation (test.mode, mastHeight, value);
+            }
+        });
+
+        printf ("%s  batch %6.2f ns per value, one at a time %6.2f ns\n", test.name, batch / (double) count, single);
+    }
+
+    benchKeep (sum);
+
+    return 0;
+}
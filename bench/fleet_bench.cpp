@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <vector>
+#include "fleet.h"
+#include "psmack.h"
+#include "bench.h"
+
+// One simulator tick at 1, 64 and MAX_LAMPS lamps: a slew step of the whole fleet, then a $PSMACK for every lamp,
+// each from its own formatter as the window and the daemon keep them. Every lamp is sent back to where it started
+// every few ticks so that the fleet keeps moving and the sentence cache is mostly missed.
+
+static int const TICKS_PER_RESET = 16;
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    size_t const counts [] = { 1, 64, MAX_LAMPS };
+    std::mt19937_64 random (1);
+    std::uniform_real_distribution<double> anyBrg (0.0, 360.0);
+    size_t total = 0;
+
+    printf ("fleet kernel: %s\n", motionKernelName (detectMotionKernel ()));
+
+    for (size_t count: counts) {
+        LampFleet fleet (count);
+        std::vector<PsmackFormatter> formatters (count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            fleet.actualBrg [i] = anyBrg (random);
+            fleet.actualElev [i] = 5.0;
+            fleet.requestedBrg [i] = fmod (fleet.actualBrg [i] + 160.0 + fmod (anyBrg (random), 40.0), 360.0);
+            fleet.requestedElev [i] = 0.3;
+        }
+
+        std::vector<double> const startBrg = fleet.actualBrg, startElev = fleet.actualElev;
+
+        auto restart = [&] (uint64_t tick) {
+            if (tick % TICKS_PER_RESET == 0) {
+                fleet.actualBrg = startBrg;
+                fleet.actualElev = startElev;
+            }
+        };
+
+        double stepOnly = benchRun (seconds, [&] (uint64_t ticks) {
+            for (uint64_t tick = 0; tick < ticks; ++ tick) {
+                restart (tick);
+                total += fleet.step ();
+            }
+        });
+        double withSentences = benchRun (seconds, [&] (uint64_t ticks) {
+            for (uint64_t tick = 0; tick < ticks; ++ tick) {
+                size_t size;
+
+                restart (tick);
+                total += fleet.step ();
+
+                for (size_t i = 0; i < count; ++ i) {
+                    formatters [i].format ((uint16_t) (i + 1), fleet.actualBrg [i], fleet.actualElev [i], fleet.status [i], size);
+                    total += size;
+                }
+            }
+        });
+
+        printf (
+            "%4zu lamps: step %8.2f us per tick, step + $PSMACK %8.2f us per tick (%.0f ns per lamp)\n",
+            count, stepOnly * 1.0e-3, withSentences * 1.0e-3, withSentences / (double) count
+        );
+    }
+
+    benchKeep (total);
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <random>
+#include <vector>
+#include "motion.h"
+#include "fleet.h"
+#include "bench.h"
+
+// Lamps stepped per second by each motion kernel the CPU runs, for a full fleet of MAX_LAMPS turning by bearing alone
+// and by bearing and elevation, with both conversion modes. Positions are put back every few ticks so that every
+// lamp keeps moving; the copy is part of what is measured.
+
+static int const TICKS_PER_RESET = 16;
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    size_t const count = MAX_LAMPS;
+    std::mt19937_64 random (1);
+    std::uniform_real_distribution<double> anyBrg (0.0, 360.0);
+    std::vector<double> startBrg (count), startElev (count, 5.0), requestedBrg (count), requestedElev (count, 0.3);
+    std::vector<double> actualBrg (count), actualElev (count);
+
+    // at least 160 degrees and 1700 m to go, more than TICKS_PER_RESET steps take
+    for (size_t i = 0; i < count; ++ i) {
+        startBrg [i] = anyBrg (random);
+        requestedBrg [i] = fmod (startBrg [i] + 160.0 + fmod (anyBrg (random), 40.0), 360.0);
+    }
+
+    MotionKernel const best = detectMotionKernel ();
+    std::vector<MotionKernel> kernels { MotionKernel::ScalarKernel };
+    ConversionMode const modes [] = { ConversionMode::ExactConversion, ConversionMode::FastConversion };
+    size_t total = 0;
+
+    if (best != MotionKernel::ScalarKernel) kernels.push_back (MotionKernel::Sse2Kernel);
+    if (best == MotionKernel::Avx2Kernel) kernels.push_back (MotionKernel::Avx2Kernel);
+
+    for (int withElevation = 0; withElevation < 2; ++ withElevation) {
+        for (ConversionMode mode: modes) {
+            // the conversion mode only matters once elevations move
+            if (!withElevation && mode == ConversionMode::FastConversion) continue;
+
+            for (MotionKernel kernel: kernels) {
+                const double *targetElev = withElevation ? requestedElev.data () : startElev.data ();
+                double perTick = benchRun (seconds, [&] (uint64_t ticks) {
+                    for (uint64_t tick = 0; tick < ticks; ++ tick) {
+                        if (tick % TICKS_PER_RESET == 0) {
+                            actualBrg = startBrg;
+                            actualElev = startElev;
+                        }
+
+                        total += stepLamps (kernel, mode, 10.0, actualBrg.data (), actualElev.data (), requestedBrg.data (), targetElev, count);
+                    }
+                });
+
+                printf (
+                    "%-26s %-6s %-6s %7.1f M lamps/s\n", withElevation ? "bearing and elevation" : "bearing only",
+                    withElevation ? (mode == ConversionMode::FastConversion ? "fast" : "libm") : "", motionKernelName (kernel),
+                    (double) count * 1.0e3 / perTick
+                );
+            }
+        }
+    }
+
+    benchKeep (total);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "nmea.h"
+#include "framer.h"
+#include "bench.h"
+
+// Control unit sentences per second: split into std::string fields as the reader used to, against the in place
+// tokenizer on its own and with the fields read, and the framer and tokenizer together as the receive path runs them,
+// fields taken from the framer's scan
+
+static uint8_t calcCrc (char *sentence) {
+    uint8_t crc = sentence [1];
+
+    for (int i = 2; sentence [i] != '*' && i < 81; crc ^= sentence [i++]);
+
+    return crc;
+}
+
+static int splitFields (char *source, std::vector<std::string>& fields) {
+    uint8_t actualCrc = calcCrc (source);
+
+    fields.clear ();
+
+    std::string field;
+
+    for (char *chr = source + 1; *chr; ++ chr) {
+        if (*chr == ',') {
+            fields.emplace_back (field.c_str ());
+            field.clear ();
+        } else if (*chr == '*') {
+            fields.emplace_back (field.c_str ());
+            uint8_t crc = htodec (chr [1]) * 16 + htodec (chr [2]);
+
+            if (crc != actualCrc) return 0;
+
+            *chr = '\0';
+        } else {
+            field += *chr;
+        }
+    }
+
+    return (int) fields.size ();
+}
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    std::mt19937_64 random (1);
+    std::vector<std::string> sentences (1024);
+
+    // "$<lamp>,<brg>,<elev>,<focus>,<flags>*hh" as the control unit sends them
+    for (auto& sentence: sentences) {
+        char text [64];
+        int size = snprintf (
+            text, sizeof (text), "$%02d,%.1f,%.2f,%d,%d", (int) (random () % 64 + 1), (double) (random () % 3600) / 10.0,
+            (double) (random () % 9000) / 100.0, (int) (random () % 100), (int) (random () % 2)
+        );
+        uint8_t crc = 0;
+
+        for (int i = 1; i < size; ++ i) crc ^= (uint8_t) text [i];
+
+        snprintf (text + size, sizeof (text) - size, "*%02X", crc);
+        sentence = text;
+    }
+
+    size_t const mask = sentences.size () - 1;
+    std::string stream;
+
+    for (const auto& sentence: sentences) stream += sentence + "\r\n";
+
+    std::vector<std::string> fields;
+    double sum = 0.0;
+
+    double split = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& sentence = sentences [i & mask];
+            char buffer [100];
+
+            memcpy (buffer, sentence.c_str (), sentence.size () + 1);
+
+            if (splitFields (buffer, fields) > 4) sum += atoi (fields [0].c_str ()) + atof (fields [1].c_str ()) + atof (fields [2].c_str ());
+        }
+    });
+    double scalar = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& sentence = sentences [i & mask];
+            SentenceFields view;
+
+            sum += tokenizeSentenceScalar (sentence.data (), sentence.size (), view);
+        }
+    });
+    double scanned = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& sentence = sentences [i & mask];
+            SentenceFields view;
+
+            sum += tokenizeSentence (sentence.data (), sentence.size (), view);
+        }
+    });
+    double parsed = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& sentence = sentences [i & mask];
+            SentenceFields view;
+
+            if (tokenizeSentence (sentence.data (), sentence.size (), view) > 4) {
+                sum += fieldToInt (view [0]) + fieldToDouble (view [1]) + fieldToDouble (view [2]);
+            }
+        }
+    });
+
+    // per stream of every sentence once, as one read
+    auto framedRun = [&] (bool fromScan) {
+        return benchRun (seconds, [&] (uint64_t count) {
+            SentenceFramer framer;
+
+            for (uint64_t i = 0; i < count; ++ i) {
+                framer.feed (stream.data (), stream.size (), [&] (const char *sentence, size_t size, const SentenceScan *scan) {
+                    SentenceFields view;
+                    int numOfFields = fromScan && scan ? tokenizeScannedSentence (sentence, size, * scan, view) : tokenizeSentenceScalar (sentence, size, view);
+
+                    if (numOfFields > 4) sum += fieldToInt (view [0]) + fieldToDouble (view [1]) + fieldToDouble (view [2]);
+                });
+            }
+        }) / (double) sentences.size ();
+    };
+    double framedScalar = framedRun (false);
+    double framed = framedRun (true);
+
+    benchKeep (sum);
+
+    printf ("splitFields + atof       %6.1f M sentences/s\n", 1.0e3 / split);
+    printf ("tokenizeSentenceScalar   %6.1f M sentences/s\n", 1.0e3 / scalar);
+    printf ("tokenizeSentence         %6.1f M sentences/s\n", 1.0e3 / scanned);
+    printf ("tokenizeSentence + parse %6.1f M sentences/s (%.1fx)\n", 1.0e3 / parsed, split / parsed);
+    printf ("framer + scalar + parse  %6.1f M sentences/s\n", 1.0e3 / framedScalar);
+    printf ("framer + scanned + parse %6.1f M sentences/s (%.1fx)\n", 1.0e3 / framed, framedScalar / framed);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "nmeascan.h"
+#include "nmea.h"
+#include "framer.h"
+#include "bench.h"
+
+// Delimiter scan throughput of each kernel the CPU runs, masks alone and with the checksum prefix, and the
+// framer and tokenizer together over a megabyte of sentences
+
+static std::string makeSentence (std::mt19937& random) {
+    std::string sentence = "$GPGGA";
+
+    for (int i = 0; i < 14; ++ i) {
+        sentence += ',';
+
+        for (size_t size = random () % 12; size > 0; -- size) sentence += "0123456789." [random () % 11];
+    }
+
+    uint8_t crc = 0;
+    char checksum [8];
+
+    for (size_t i = 1; i < sentence.size (); ++ i) crc ^= (uint8_t) sentence [i];
+
+    snprintf (checksum, sizeof (checksum), "*%02X\r\n", crc);
+
+    return sentence + checksum;
+}
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    std::mt19937 random (1);
+    std::string data;
+
+    while (data.size () < (1u << 20)) data += makeSentence (random);
+
+    std::vector<ScanBlock> blocks (data.size () / SCAN_BLOCK_SIZE + 1);
+    std::vector<uint8_t> prefixXor (data.size ());
+    ScanKernel const best = detectScanKernel ();
+    std::vector<ScanKernel> kernels { ScanKernel::ScalarScan };
+    double const megabytes = (double) data.size () / 1.0e6;
+    size_t total = 0;
+
+    if (best == ScanKernel::Avx2Scan) kernels.push_back (ScanKernel::Sse2Scan);
+    if (best != ScanKernel::ScalarScan) kernels.push_back (best);
+
+    for (ScanKernel kernel: kernels) {
+        double masks = benchRun (seconds, [&] (uint64_t count) {
+            for (uint64_t i = 0; i < count; ++ i) scanNmea (kernel, data.data (), data.size (), blocks.data (), 0);
+        });
+        double withXor = benchRun (seconds, [&] (uint64_t count) {
+            for (uint64_t i = 0; i < count; ++ i) scanNmea (kernel, data.data (), data.size (), blocks.data (), prefixXor.data ());
+        });
+
+        total += blocks [0].lfs + prefixXor [0];
+
+        printf ("scan %-8s masks       %8.0f MB/s\n", scanKernelName (kernel), megabytes * 1.0e9 / masks);
+        printf ("scan %-8s masks + xor %8.0f MB/s\n", scanKernelName (kernel), megabytes * 1.0e9 / withXor);
+    }
+
+    for (ScanKernel kernel: kernels) {
+        double framed = benchRun (seconds, [&] (uint64_t count) {
+            for (uint64_t i = 0; i < count; ++ i) {
+                SentenceFramer framer;
+
+                framer.kernel = kernel;
+                framer.feed (data.data (), data.size (), [&] (const char *sentence, size_t size, const SentenceScan *scan) {
+                    SentenceFields fields;
+
+                    total += scan ? tokenizeScannedSentence (sentence, size, * scan, fields) : tokenizeSentence (sentence, size, fields);
+                });
+            }
+        });
+
+        printf ("framer %-6s + tokenizer %8.0f MB/s\n", scanKernelName (kernel), megabytes * 1.0e9 / framed);
+    }
+
+    benchKeep (total);
+
+    return 0;
+}
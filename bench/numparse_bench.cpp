@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "numparse.h"
+#include "bench.h"
+
+// NMEA style numeric fields: copy to a terminated buffer and atof/atoi as the reader used to, against parsing in place
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    std::mt19937_64 random (1);
+    std::vector<std::string> fields (4096), integers (4096);
+
+    for (auto& field: fields) {
+        char text [32];
+
+        snprintf (text, sizeof (text), "%.*f", (int) (random () % 4), (double) (random () % 3600000) / 1000.0);
+        field = text;
+    }
+    for (auto& field: integers) field = std::to_string (random () % 100000);
+
+    size_t const mask = fields.size () - 1;
+    double sum = 0.0;
+
+    double viaAtof = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& field = fields [i & mask];
+            char buffer [32];
+
+            memcpy (buffer, field.data (), field.size ());
+            buffer [field.size ()] = '\0';
+            sum += atof (buffer);
+        }
+    });
+    double inPlace = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& field = fields [i & mask];
+
+            sum += toDouble (field.data (), field.data () + field.size ());
+        }
+    });
+    double viaAtoi = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& field = integers [i & mask];
+            char buffer [32];
+
+            memcpy (buffer, field.data (), field.size ());
+            buffer [field.size ()] = '\0';
+            sum += atoi (buffer);
+        }
+    });
+    double intInPlace = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) {
+            const std::string& field = integers [i & mask];
+
+            sum += toInt (field.data (), field.data () + field.size ());
+        }
+    });
+
+    benchKeep (sum);
+
+    printf ("copy + atof      %6.1f ns per field\n", viaAtof);
+    printf ("toDouble         %6.1f ns per field (%.1fx)\n", inPlace, viaAtof / inPlace);
+    printf ("copy + atoi      %6.1f ns per field\n", viaAtoi);
+    printf ("toInt            %6.1f ns per field (%.1fx)\n", intInPlace, viaAtoi / intInPlace);
+
+    return 0;
+}
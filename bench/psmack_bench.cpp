@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "psmack.h"
+#include "bench.h"
+
+// $PSMACK with sprintf as sendLampSentence used to do it, against PsmackFormatter encoding and reusing
+
+struct Sample {
+    uint16_t lampID;
+    double brg, elevation;
+    uint32_t status;
+};
+
+static size_t sprintfPsmack (char *buffer, const Sample& sample) {
+    int size = sprintf (buffer, "$PSMACK,%02d,%d,%.2f,100,%02X", sample.lampID, (int) sample.brg, sample.elevation, sample.status);
+    uint8_t crc = 0;
+
+    for (int i = 1; i < size; ++ i) crc ^= (uint8_t) buffer [i];
+
+    return (size_t) (size + sprintf (buffer + size, "*%02X\r\n", crc));
+}
+
+int main (int argCount, char *args []) {
+    double seconds = argCount > 1 ? atof (args [1]) : 1.0;
+    std::mt19937_64 random (1);
+    std::uniform_real_distribution<double> anyElevation (-5.0, 90.0), anyBearing (0.0, 360.0);
+    std::vector<Sample> samples (4096);
+
+    for (auto& sample: samples) sample = Sample { (uint16_t) (random () % 64 + 1), anyBearing (random), anyElevation (random), (uint32_t) (random () % 256) };
+
+    char buffer [MAX_PSMACK_SIZE * 2];
+    size_t mask = samples.size () - 1, total = 0;
+    PsmackFormatter formatter;
+
+    double viaSprintf = benchRun (seconds, [&] (uint64_t count) {
+        for (uint64_t i = 0; i < count; ++ i) total += sprintfPsmack (buffer, samples [i & mask]);
+    });
+    double encoded = benchRun (seconds, [&] (uint64_t count) {
+        size_t size;
+
+        for (uint64_t i = 0; i < count; ++ i) {
+            const Sample& sample = samples [i & mask];
+
+            total += formatter.format (sample.lampID, sample.brg, sample.elevation, sample.status, size) [size - 3] + size;
+        }
+    });
+    double reused = benchRun (seconds, [&] (uint64_t count) {
+        size_t size;
+        const Sample& sample = samples [0];
+
+        for (uint64_t i = 0; i < count; ++ i) total += formatter.format (sample.lampID, sample.brg, sample.elevation, sample.status, size) [size - 3] + size;
+    });
+
+    benchKeep (total);
+
+    printf ("sprintf          %8.1f ns per sentence\n", viaSprintf);
+    printf ("formatter        %8.1f ns per sentence (%.1fx)\n", encoded, viaSprintf / encoded);
+    printf ("unchanged lamp   %8.1f ns per sentence (%.1fx)\n", reused, viaSprintf / reused);
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <string.h>
+#include "binding.h"
+
+void ControlBindings::bindText (HWND control, uint32_t sources, const char *format, std::function<double ()> value, std::function<void ()> beforeUpdate) {
+    TextBinding binding;
+
+    binding.control = control;
+    binding.sources = sources;
+    binding.format = format;
+    binding.value = value;
+    binding.beforeUpdate = beforeUpdate;
+    binding.shownValue = 0.0;
+    binding.shownText [0] = '\0';
+    binding.shown = false;
+
+    texts.push_back (binding);
+}
+
+void ControlBindings::bindCheck (HWND control, uint32_t sources, std::function<bool ()> checked) {
+    checks.push_back (CheckBinding { control, sources, checked, false, false });
+}
+
+void ControlBindings::accepted (HWND control, double value) {
+    for (auto& binding: texts) {
+        if (binding.control == control) {
+            binding.shownValue = value;
+            binding.shown = true;
+            snprintf (binding.shownText, sizeof (binding.shownText), binding.format, value);
+        }
+    }
+}
+
+void ControlBindings::invalidate () {
+    for (auto& binding: texts) binding.shown = false;
+    for (auto& binding: checks) binding.shown = false;
+
+    changedSources = ALL_BOUND_SOURCES;
+}
+
+size_t ControlBindings::refresh () {
+    size_t count = 0;
+    uint32_t sources = changedSources;
+
+    changedSources = 0;
+
+    if (sources == 0) return 0;
+
+    for (auto& binding: texts) {
+        if (binding.shown && (binding.sources & sources) == 0) continue;
+
+        double value = binding.value ();
+
+        if (binding.shown && value == binding.shownValue) continue;
+
+        char text [MAX_BOUND_TEXT_SIZE];
+
+        snprintf (text, sizeof (text), binding.format, value);
+
+        binding.shownValue = value;
+
+        // a change too small for the format shows nothing new
+        if (binding.shown && strcmp (text, binding.shownText) == 0) continue;
+
+        strcpy (binding.shownText, text);
+        binding.shown = true;
+
+        if (binding.beforeUpdate) binding.beforeUpdate ();
+
+        SetWindowText (binding.control, text);
+
+        ++ count;
+    }
+
+    for (auto& binding: checks) {
+        if (binding.shown && (binding.sources & sources) == 0) continue;
+
+        bool checked = binding.checked ();
+
+        if (binding.shown && checked == binding.shownChecked) continue;
+
+        binding.shownChecked = checked;
+        binding.shown = true;
+
+        SendMessage (binding.control, BM_SETCHECK, checked ? BST_CHECKED : BST_UNCHECKED, 0);
+
+        ++ count;
+    }
+
+    updates += count;
+
+    return count;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+static size_t const MAX_BOUND_TEXT_SIZE = 32;
+static uint32_t const ALL_BOUND_SOURCES = 0xFFFFFFFF;
+
+// Edit control showing one number of the model
+struct TextBinding {
+    HWND control;
+    uint32_t sources;                       // parts of the model the value comes from, as the caller numbers them
+    const char *format;
+    std::function<double ()> value;
+    std::function<void ()> beforeUpdate;    // runs right before the text is set, e.g. to ignore the EN_CHANGE that follows
+    double shownValue;
+    char shownText [MAX_BOUND_TEXT_SIZE];
+    bool shown;
+};
+
+// Check box showing one condition of the model
+struct CheckBinding {
+    HWND control;
+    uint32_t sources;
+    std::function<bool ()> checked;
+    bool shownChecked;
+    bool shown;
+};
+
+// Keeps controls in step with the model, never the other way round. Whatever changes the model says which parts
+// it changed; refresh () reads only the bindings on those parts and tells a control only when its value changed:
+// a number whose text comes out the same or a check box already in that state is left alone. Controls are never
+// read back.
+struct ControlBindings {
+    std::vector<TextBinding> texts;
+    std::vector<CheckBinding> checks;
+    uint32_t changedSources;    // marked since the last refresh
+    uint64_t updates;           // controls touched so far
+
+    ControlBindings (): changedSources (ALL_BOUND_SOURCES), updates (0) {}
+
+    void bindText (HWND control, uint32_t sources, const char *format, std::function<double ()> value, std::function<void ()> beforeUpdate = nullptr);
+    void bindCheck (HWND control, uint32_t sources, std::function<bool ()> checked);
+
+    // The model changed in these parts; the next refresh reads the bindings on them
+    void changed (uint32_t sources) { changedSources |= sources; }
+
+    // The user typed the value into the control; it is taken as shown, so refresh leaves the typing alone
+    void accepted (HWND control, double value);
+
+    // Makes the next refresh update every control, e.g. when another lamp is shown
+    void invalidate ();
+
+    // Reads the bindings on the parts changed since the last refresh; returns number of controls touched
+    size_t refresh ();
+};
@@ -0,0 +1,501 @@
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "capture.h"
+
+namespace {
+    uint64_t steadyNs () {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+    }
+
+    uint64_t paddedRecordSize (uint32_t size) {
+        return sizeof (CaptureRecord) + (((uint64_t) size + 7) & ~(uint64_t) 7);
+    }
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile (): file (INVALID_HANDLE_VALUE), mapping (0), base (0), capacity (0), writable (false) {}
+
+static bool mapView (MappedFile& mapped, uint64_t size) {
+    mapped.mapping = CreateFileMapping (
+        mapped.file, 0, mapped.writable ? PAGE_READWRITE : PAGE_READONLY, (DWORD) (size >> 32), (DWORD) size, 0
+    );
+
+    if (!mapped.mapping) return false;
+
+    mapped.base = (char *) MapViewOfFile (mapped.mapping, mapped.writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, (SIZE_T) size);
+
+    if (!mapped.base) {
+        CloseHandle (mapped.mapping);
+
+        mapped.mapping = 0;
+
+        return false;
+    }
+
+    mapped.capacity = size;
+
+    return true;
+}
+
+static void unmapView (MappedFile& mapped) {
+    if (mapped.base) UnmapViewOfFile (mapped.base);
+    if (mapped.mapping) CloseHandle (mapped.mapping);
+
+    mapped.base = 0;
+    mapped.mapping = 0;
+}
+
+bool MappedFile::create (const char *path, uint64_t size) {
+    close ();
+
+    file = CreateFile (path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    writable = true;
+
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    // a read/write mapping larger than the file extends it
+    if (!mapView (* this, size)) {
+        close (); return false;
+    }
+
+    return true;
+}
+
+bool MappedFile::openReadOnly (const char *path) {
+    LARGE_INTEGER size;
+
+    close ();
+
+    file = CreateFile (path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    writable = false;
+
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    if (!GetFileSizeEx (file, & size) || size.QuadPart == 0 || !mapView (* this, (uint64_t) size.QuadPart)) {
+        close (); return false;
+    }
+
+    return true;
+}
+
+bool MappedFile::grow (uint64_t size) {
+    if (!writable || file == INVALID_HANDLE_VALUE) return false;
+
+    unmapView (* this);
+
+    return mapView (* this, size) || mapView (* this, capacity);
+}
+
+void MappedFile::close (uint64_t finalSize) {
+    unmapView (* this);
+
+    if (file != INVALID_HANDLE_VALUE) {
+        if (writable && finalSize > 0) {
+            LARGE_INTEGER end;
+
+            end.QuadPart = (LONGLONG) finalSize;
+
+            if (SetFilePointerEx (file, end, 0, FILE_BEGIN)) SetEndOfFile (file);
+        }
+
+        CloseHandle (file);
+
+        file = INVALID_HANDLE_VALUE;
+    }
+
+    capacity = 0;
+}
+#else
+MappedFile::MappedFile (): fd (-1), base (0), capacity (0), writable (false) {}
+
+static bool mapView (MappedFile& mapped, uint64_t size) {
+    void *address = mmap (0, (size_t) size, mapped.writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, mapped.fd, 0);
+
+    if (address == MAP_FAILED) return false;
+
+    mapped.base = (char *) address;
+    mapped.capacity = size;
+
+    return true;
+}
+
+static void unmapView (MappedFile& mapped) {
+    if (mapped.base) munmap (mapped.base, (size_t) mapped.capacity);
+
+    mapped.base = 0;
+}
+
+bool MappedFile::create (const char *path, uint64_t size) {
+    close ();
+
+    fd = open (path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    writable = true;
+
+    if (fd < 0) return false;
+
+    if (ftruncate (fd, (off_t) size) != 0 || !mapView (* this, size)) {
+        close (); return false;
+    }
+
+    return true;
+}
+
+bool MappedFile::openReadOnly (const char *path) {
+    struct stat info;
+
+    close ();
+
+    fd = open (path, O_RDONLY);
+    writable = false;
+
+    if (fd < 0) return false;
+
+    if (fstat (fd, & info) != 0 || info.st_size == 0 || !mapView (* this, (uint64_t) info.st_size)) {
+        close (); return false;
+    }
+
+    return true;
+}
+
+bool MappedFile::grow (uint64_t size) {
+    if (!writable || fd < 0 || ftruncate (fd, (off_t) size) != 0) return false;
+
+    uint64_t oldCapacity = capacity;
+
+    unmapView (* this);
+
+    return mapView (* this, size) || mapView (* this, oldCapacity);
+}
+
+void MappedFile::close (uint64_t finalSize) {
+    unmapView (* this);
+
+    if (fd >= 0) {
+        if (writable && finalSize > 0 && ftruncate (fd, (off_t) finalSize) != 0) {
+            // the capture is still readable, only with zeros past its end
+        }
+
+        ::close (fd);
+
+        fd = -1;
+    }
+
+    capacity = 0;
+}
+#endif
+
+MappedFile::~MappedFile () {
+    close ();
+}
+
+bool CaptureWriter::start (const char *path) {
+    stop ();
+
+    std::lock_guard<std::mutex> lock (locker);
+
+    if (!file.create (path, CAPTURE_INITIAL_CAPACITY)) return false;
+
+    CaptureHeader *header = (CaptureHeader *) file.base;
+
+    memset (header, 0, sizeof (*header));
+    memcpy (header->magic, CAPTURE_MAGIC, sizeof (header->magic));
+
+    header->version = CAPTURE_VERSION;
+    header->headerSize = sizeof (CaptureHeader);
+    header->startedUnixNs = (int64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::system_clock::now ().time_since_epoch ()).count ();
+    header->dataEnd = sizeof (CaptureHeader);
+
+    index.clear ();
+    index.reserve (1024);
+
+    startedNs = steadyNs ();
+    nextIndexOffset = header->dataEnd;
+    records = bytes = failures = 0;
+
+    active.store (true, std::memory_order_release);
+
+    return true;
+}
+
+void CaptureWriter::stop () {
+    std::lock_guard<std::mutex> lock (locker);
+
+    if (!active.load (std::memory_order_relaxed)) return;
+
+    active.store (false, std::memory_order_relaxed);
+
+    uint64_t indexOffset = ((CaptureHeader *) file.base)->dataEnd;
+    uint64_t indexSize = index.size () * sizeof (CaptureIndexEntry);
+
+    if (indexOffset + indexSize <= file.capacity || file.grow (indexOffset + indexSize)) {
+        CaptureHeader *header = (CaptureHeader *) file.base;
+
+        if (indexSize > 0) memcpy (file.base + indexOffset, index.data (), (size_t) indexSize);
+
+        header->indexOffset = indexOffset;
+        header->numOfIndexEntries = index.size ();
+
+        file.close (indexOffset + indexSize);
+    } else {
+        file.close (indexOffset);
+    }
+}
+
+void CaptureWriter::write (CaptureDirection direction, const char *data, size_t size) {
+    std::lock_guard<std::mutex> lock (locker);
+
+    if (!active.load (std::memory_order_relaxed)) return;
+
+    uint64_t timeNs = steadyNs () - startedNs;
+    uint64_t offset = ((CaptureHeader *) file.base)->dataEnd;
+    uint64_t end = offset + paddedRecordSize ((uint32_t) size);
+
+    if (end > file.capacity) {
+        uint64_t newCapacity = file.capacity;
+
+        while (newCapacity < end) newCapacity += newCapacity < CAPTURE_MAX_GROWTH ? newCapacity : CAPTURE_MAX_GROWTH;
+
+        if (!file.grow (newCapacity)) {
+            ++ failures; return;
+        }
+    }
+
+    if (offset >= nextIndexOffset) {
+        index.push_back ({ timeNs, offset });
+
+        nextIndexOffset = offset + CAPTURE_INDEX_STRIDE;
+    }
+
+    CaptureRecord *record = (CaptureRecord *) (file.base + offset);
+    CaptureHeader *header = (CaptureHeader *) file.base;
+
+    memcpy (file.base + offset + sizeof (CaptureRecord), data, size);
+
+    record->timeNs = timeNs;
+    record->size = (uint32_t) size;
+    record->direction = (uint8_t) direction;
+
+    // the record is complete before the header says so
+    header->numOfRecords ++;
+    header->dataEnd = end;
+
+    records.fetch_add (1, std::memory_order_relaxed);
+    bytes.fetch_add (size, std::memory_order_relaxed);
+}
+
+bool CaptureReader::open (const char *path) {
+    close ();
+
+    if (!file.openReadOnly (path)) return false;
+
+    header = (const CaptureHeader *) file.base;
+
+    if (
+        file.capacity < sizeof (CaptureHeader) ||
+        memcmp (header->magic, CAPTURE_MAGIC, sizeof (header->magic)) != 0 ||
+        header->version != CAPTURE_VERSION ||
+        header->headerSize < sizeof (CaptureHeader) ||
+        header->dataEnd > file.capacity
+    ) {
+        close (); return false;
+    }
+
+    rewind ();
+
+    return true;
+}
+
+void CaptureReader::close () {
+    file.close ();
+
+    header = 0;
+    offset = 0;
+}
+
+bool CaptureReader::next (const CaptureRecord *& record, const char *& data) {
+    if (!header || offset + sizeof (CaptureRecord) > header->dataEnd) return false;
+
+    record = (const CaptureRecord *) (file.base + offset);
+
+    uint64_t end = offset + paddedRecordSize (record->size);
+
+    if (end > header->dataEnd) return false;
+
+    data = file.base + offset + sizeof (CaptureRecord);
+    offset = end;
+
+    return true;
+}
+
+void CaptureReader::seek (uint64_t timeNs) {
+    if (!header) return;
+
+    rewind ();
+
+    uint64_t indexEnd = header->indexOffset + header->numOfIndexEntries * sizeof (CaptureIndexEntry);
+
+    if (header->indexOffset > 0 && indexEnd <= file.capacity) {
+        const CaptureIndexEntry *entries = (const CaptureIndexEntry *) (file.base + header->indexOffset);
+        size_t first = 0, last = (size_t) header->numOfIndexEntries;
+
+        // last entry not later than timeNs
+        while (last - first > 1) {
+            size_t middle = (first + last) / 2;
+
+            if (entries [middle].timeNs <= timeNs) first = middle; else last = middle;
+        }
+
+        if (header->numOfIndexEntries > 0 && entries [first].timeNs <= timeNs) offset = entries [first].offset;
+    }
+
+    const CaptureRecord *record;
+    const char *data;
+    uint64_t recordOffset = offset;
+
+    while (next (record, data) && record->timeNs < timeNs) recordOffset = offset;
+
+    offset = recordOffset;
+}
+
+// Replays the received records; the reader thread calls read and waitForData, interrupt may come from anywhere
+struct ReplayTransport: Transport {
+    CaptureReader reader;
+    double speed;
+    bool opened;
+    const CaptureRecord *pending;
+    const char *pendingData;
+    size_t pendingDone;
+    uint64_t firstTimeNs;
+    std::chrono::steady_clock::time_point started;
+    bool interrupted;
+    std::mutex locker;
+    std::condition_variable wakeUp;
+
+    ReplayTransport (double _speed): speed (_speed), opened (false), pending (0), pendingData (0), pendingDone (0), firstTimeNs (0), interrupted (false) {}
+
+    bool open (const char *path) {
+        if (!reader.open (path)) return false;
+
+        fetch ();
+
+        firstTimeNs = pending ? pending->timeNs : 0;
+        started = std::chrono::steady_clock::now ();
+        opened = true;
+
+        return true;
+    }
+
+    void fetch () {
+        const CaptureRecord *record;
+        const char *data;
+
+        pending = 0;
+        pendingDone = 0;
+
+        while (reader.next (record, data)) {
+            if (record->direction == CaptureDirection::CaptureReceived && record->size > 0) {
+                pending = record;
+                pendingData = data;
+                break;
+            }
+        }
+    }
+
+    // the first received chunk plays at once, the rest keep their distance from it
+    std::chrono::steady_clock::time_point dueTime () {
+        if (speed <= 0.0) return started;
+
+        return started + std::chrono::nanoseconds ((int64_t) ((double) (pending->timeNs - firstTimeNs) / speed));
+    }
+
+    virtual bool isOpen () {
+        return opened;
+    }
+
+    virtual void close () {
+        reader.close ();
+
+        pending = 0;
+        opened = false;
+    }
+
+    virtual long read (char *buffer, size_t size) {
+        size_t bytesRead = 0;
+
+        if (!opened) return -1;
+
+        auto now = std::chrono::steady_clock::now ();
+
+        while (pending && bytesRead < size && dueTime () <= now) {
+            size_t chunk = pending->size - pendingDone;
+
+            if (chunk > size - bytesRead) chunk = size - bytesRead;
+
+            memcpy (buffer + bytesRead, pendingData + pendingDone, chunk);
+
+            bytesRead += chunk;
+            pendingDone += chunk;
+
+            if (pendingDone == pending->size) fetch ();
+        }
+
+        return (long) bytesRead;
+    }
+
+    virtual long write (const char *, size_t size) {
+        return opened ? (long) size : -1;
+    }
+
+    virtual WaitResult waitForData (uint32_t timeoutMs) {
+        std::unique_lock<std::mutex> lock (locker);
+        auto deadline = std::chrono::steady_clock::now () + std::chrono::milliseconds (timeoutMs);
+
+        while (true) {
+            if (interrupted) return WaitResult::WaitInterrupted;
+            if (!opened) return WaitResult::WaitFailed;
+
+            auto now = std::chrono::steady_clock::now ();
+
+            if (pending && dueTime () <= now) return WaitResult::DataReady;
+            if (timeoutMs != WAIT_FOREVER && now >= deadline) return WaitResult::WaitTimeout;
+
+            if (pending) {
+                auto due = dueTime ();
+
+                wakeUp.wait_until (lock, timeoutMs != WAIT_FOREVER && deadline < due ? deadline : due);
+            } else if (timeoutMs != WAIT_FOREVER) {
+                // nothing left to replay; stays quiet like an idle port
+                wakeUp.wait_until (lock, deadline);
+            } else {
+                wakeUp.wait (lock);
+            }
+        }
+    }
+
+    virtual void interrupt () {
+        std::lock_guard<std::mutex> lock (locker);
+
+        interrupted = true;
+
+        wakeUp.notify_all ();
+    }
+};
+
+Transport *openReplayTransport (const char *path, double speed) {
+    ReplayTransport *transport = new ReplayTransport (speed);
+
+    if (!transport->open (path)) {
+        delete transport; return 0;
+    }
+
+    return transport;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "transport.h"
+
+// Capture file: CaptureHeader, then records back to back, each a CaptureRecord followed by its bytes padded to 8,
+// then (once the capture is closed properly) the index. The header is kept up to date after every record, so a
+// capture cut short by a crash is still readable up to the last complete record, only without the index.
+static char const CAPTURE_MAGIC [8] = { 'L', 'S', 'C', 'A', 'P', 'T', 'R', '1' };
+static uint32_t const CAPTURE_VERSION = 1;
+static uint64_t const CAPTURE_INDEX_STRIDE = 64 * 1024;        // one index entry per this many bytes of records
+static uint64_t const CAPTURE_INITIAL_CAPACITY = 16 * 1024 * 1024;
+static uint64_t const CAPTURE_MAX_GROWTH = 256 * 1024 * 1024;
+
+enum CaptureDirection {
+    CaptureReceived = 1,
+    CaptureTransmitted = 2,
+};
+
+struct CaptureHeader {
+    char magic [8];
+    uint32_t version;
+    uint32_t headerSize;
+    int64_t startedUnixNs;          // wall clock time of the first timestamp, for display only
+    uint64_t dataEnd;               // offset past the last complete record
+    uint64_t numOfRecords;
+    uint64_t indexOffset;           // 0 until the capture is closed
+    uint64_t numOfIndexEntries;
+};
+
+struct CaptureRecord {
+    uint64_t timeNs;                // monotonic, since the capture was started
+    uint32_t size;
+    uint8_t direction;
+    uint8_t reserved [3];
+};
+
+struct CaptureIndexEntry {
+    uint64_t timeNs;
+    uint64_t offset;
+};
+
+// Read/write or read-only mapping of a whole file which may be grown while mapped
+struct MappedFile {
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#else
+    int fd;
+#endif
+    char *base;
+    uint64_t capacity;
+    bool writable;
+
+    MappedFile ();
+    ~MappedFile ();
+
+    bool create (const char *path, uint64_t size);
+    bool openReadOnly (const char *path);
+    bool grow (uint64_t size);
+    void close (uint64_t finalSize = 0);     // a writable file is cut down to finalSize when it is non-zero
+
+    bool isOpen () { return base != 0; }
+};
+
+// Appends every chunk a link receives or transmits to a capture file. The live I/O path pays for one flag test
+// while nothing is captured, and for a lock, a clock read and a memcpy into the mapping while a capture runs.
+struct CaptureWriter {
+    MappedFile file;
+    std::atomic<bool> active;
+    std::mutex locker;
+    std::vector<CaptureIndexEntry> index;
+    uint64_t startedNs;
+    uint64_t nextIndexOffset;
+    std::atomic<uint64_t> records;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> failures;         // chunks lost because the file could not grow
+
+    CaptureWriter (): active (false), startedNs (0), nextIndexOffset (0), records (0), bytes (0), failures (0) {}
+    ~CaptureWriter () {
+        stop ();
+    }
+
+    bool start (const char *path);
+    void stop ();
+
+    bool isActive () { return active.load (std::memory_order_relaxed); }
+
+    void append (CaptureDirection direction, const char *data, size_t size) {
+        if (active.load (std::memory_order_relaxed) && size > 0) write (direction, data, size);
+    }
+
+    void write (CaptureDirection direction, const char *data, size_t size);
+};
+
+// Walks the records of a capture file, complete or cut short
+struct CaptureReader {
+    MappedFile file;
+    const CaptureHeader *header;
+    uint64_t offset;
+
+    CaptureReader (): header (0), offset (0) {}
+
+    bool open (const char *path);
+    void close ();
+
+    // Next record and its bytes, false past the last one
+    bool next (const CaptureRecord *& record, const char *& data);
+
+    // Continues from the last indexed record at or before timeNs, so next () gets there after a few records at most
+    void seek (uint64_t timeNs);
+    void rewind () { offset = header ? header->headerSize : 0; }
+};
+
+// Feeds the received side of a capture to whoever reads the transport, with the original timing scaled by
+// speed (1 for real time, 2 for twice as fast...) or as fast as it is read when speed is 0. Writes are accepted
+// and thrown away. Returns 0 when the file is not a capture.
+Transport *openReplayTransport (const char *path, double speed = 1.0);
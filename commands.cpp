@@ -0,0 +1,181 @@
+#include <string.h>
+#include "commands.h"
+#include "nmeascan.h"
+
+static uint64_t bitsOf (double value) {
+    uint64_t bits;
+
+    memcpy (& bits, & value, sizeof (bits));
+
+    return bits;
+}
+
+static double doubleOf (uint64_t bits) {
+    double value;
+
+    memcpy (& value, & bits, sizeof (value));
+
+    return value;
+}
+
+CommandInbox::CommandInbox (): superseded (0), invalidLamps (0), latency (0), arrivedNs (0) {
+    for (auto& slot: slots) {
+        slot.sequence.store (0, std::memory_order_relaxed);
+        slot.brgBits.store (0, std::memory_order_relaxed);
+        slot.elevBits.store (0, std::memory_order_relaxed);
+        slot.parsedNs.store (0, std::memory_order_relaxed);
+        slot.focus.store (0, std::memory_order_relaxed);
+    }
+
+    for (auto& word: pending) word.store (0, std::memory_order_relaxed);
+
+    memset (taken, 0, sizeof (taken));
+    memset (absent, 0, sizeof (absent));
+}
+
+void CommandInbox::post (size_t lamp, const LampCommand& command, uint64_t parsedNs) {
+    LampCommandSlot& slot = slots [lamp];
+    uint32_t sequence = slot.sequence.load (std::memory_order_relaxed);
+
+    // odd while the fields are being written
+    slot.sequence.store (sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+
+    slot.brgBits.store (bitsOf (command.brg), std::memory_order_relaxed);
+    slot.elevBits.store (bitsOf (command.elev), std::memory_order_relaxed);
+    slot.parsedNs.store (parsedNs, std::memory_order_relaxed);
+    slot.focus.store (command.focus, std::memory_order_relaxed);
+
+    slot.sequence.store (sequence + 2, std::memory_order_release);
+    pending [lamp / 64].fetch_or (1ull << (lamp % 64), std::memory_order_release);
+}
+
+bool parseLampCommand (SentenceFields& fields, int first, LampCommand& command) {
+    if (fields.count < first + 4) return false;
+
+    int lampID = fieldToInt (fields [first]);
+
+    if (lampID < 0 || lampID > UINT16_MAX) lampID = 0;
+
+    command.lampID = (uint16_t) lampID;
+    command.elev = fieldToDouble (fields [first + 2]) /*- 45.0*/;
+    command.brg = fieldToDouble (fields [first + 1]);
+    command.focus = (uint8_t) fieldToInt (fields [first + 3]);
+
+    return true;
+}
+
+static bool onLampCommand (SentenceFields& fields, int first, const LampFleet& fleet, CommandInbox& inbox) {
+    LampCommand command;
+
+    if (!parseLampCommand (fields, first, command)) return false;
+
+    if (!fleet.hasLamp (command.lampID) || inbox.isAbsent (fleet.indexOf (command.lampID))) {
+        inbox.invalidLamps.fetch_add (1, std::memory_order_relaxed); return false;
+    }
+
+    uint64_t parsedNs = 0;
+
+    if (inbox.latency) {
+        parsedNs = latencyNow ();
+        inbox.latency->record (LatencyStage::ArrivalToParse, inbox.arrivedNs, parsedNs);
+    }
+
+    // never waits for the owner; a request the owner has not picked up yet is replaced by this newer one
+    inbox.post (fleet.indexOf (command.lampID), command, parsedNs);
+
+    return true;
+}
+
+void registerLampCommandHandlers (SentenceDispatcher& dispatcher, const LampFleet& fleet, CommandInbox& inbox) {
+    // the legacy form has always needed one field more than the command uses
+    dispatcher.on (SentenceId::LegacyLampCommand, [&fleet, &inbox] (SentenceFields& fields) {
+        return fields.count > 4 && onLampCommand (fields, 0, fleet, inbox);
+    });
+    dispatcher.on (SentenceId::PsmaccSentence, [&fleet, &inbox] (SentenceFields& fields) {
+        return onLampCommand (fields, 1, fleet, inbox);
+    });
+}
+
+size_t applyPendingCommands (CommandInbox& inbox, LampFleet& fleet) {
+    size_t count = 0;
+    uint64_t appliedNs = 0;
+
+    for (size_t word = 0; word < MAX_LAMPS / 64; ++ word) {
+        for (uint64_t lamps = inbox.pending [word].exchange (0, std::memory_order_acquire); lamps; lamps &= lamps - 1) {
+            size_t lamp = word * 64 + lowestSetBit (lamps);
+            LampCommandSlot& slot = inbox.slots [lamp];
+            LampCommand command;
+            uint64_t parsedNs;
+            uint32_t sequence;
+
+            for (;;) {
+                sequence = slot.sequence.load (std::memory_order_acquire);
+
+                if (sequence & 1) continue;
+
+                command.brg = doubleOf (slot.brgBits.load (std::memory_order_relaxed));
+                command.elev = doubleOf (slot.elevBits.load (std::memory_order_relaxed));
+                command.focus = slot.focus.load (std::memory_order_relaxed);
+                parsedNs = slot.parsedNs.load (std::memory_order_relaxed);
+
+                std::atomic_thread_fence (std::memory_order_acquire);
+
+                if (slot.sequence.load (std::memory_order_relaxed) == sequence) break;
+            }
+
+            // a command written while the previous drain was copying the slot may have been applied already
+            uint32_t written = (sequence - inbox.taken [lamp]) / 2;
+
+            if (written == 0) continue;
+
+            inbox.taken [lamp] = sequence;
+            inbox.superseded.fetch_add (written - 1, std::memory_order_relaxed);
+
+            command.lampID = (uint16_t) (lamp + 1);
+            fleet.apply (command);
+
+            // one clock read per drain; commands applied together take effect together
+            if (inbox.latency) {
+                if (appliedNs == 0) appliedNs = latencyNow ();
+
+                inbox.latency->record (LatencyStage::ParseToApply, parsedNs, appliedNs);
+                inbox.latency->applied (lamp, appliedNs);
+            }
+
+            ++ count;
+        }
+    }
+
+    return count;
+}
+
+void runCommandReader (Link& link, SentenceDispatcher& dispatcher, CommandInbox& inbox, uint32_t timeoutMs, const std::function<void (char *chunk, size_t size)>& onChunk) {
+    char buffer [5000];
+    bool keepRunning = true;
+
+    while (keepRunning) {
+        switch (link.waitForData (timeoutMs)) {
+            case WaitResult::DataReady: {
+                long bytesRead;
+
+                while ((bytesRead = link.receive (buffer, sizeof (buffer) - 1)) > 0) {
+                    inbox.arrivedNs = latencyNow ();
+                    buffer [bytesRead] = '\0';
+
+                    if (onChunk) onChunk (buffer, (size_t) bytesRead);
+
+                    link.framer.feed (buffer, (size_t) bytesRead, [&dispatcher] (const char *sentence, size_t size, const SentenceScan *scan) {
+                        dispatcher.dispatch (sentence, size, scan);
+                    });
+                }
+
+                break;
+            }
+            case WaitResult::WaitTimeout:
+                break;
+            default:
+                keepRunning = false;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include "lamp.h"
+#include "fleet.h"
+#include "dispatch.h"
+#include "latency.h"
+#include "link.h"
+
+// The newest command for one lamp, written by the reader thread under a sequence lock; the owner copies it out and
+// retries when the sequence shows a write in progress or one which happened while copying. sequence / 2 is the number
+// of commands written to the slot so far.
+struct LampCommandSlot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> brgBits;
+    std::atomic<uint64_t> elevBits;
+    std::atomic<uint64_t> parsedNs;
+    std::atomic<uint8_t> focus;
+};
+
+// Lamp commands on their way from the reader thread to the thread which owns the requested positions. Nothing queues:
+// a command overwrites whatever its lamp had waiting, so however far behind the owner falls, it picks up the latest
+// request of every lamp.
+struct CommandInbox {
+    LampCommandSlot slots [MAX_LAMPS];
+    std::atomic<uint64_t> pending [MAX_LAMPS / 64];     // bit per lamp with a slot written since the owner last looked
+    uint32_t taken [MAX_LAMPS];                         // sequence of the slot as the owner last applied it; owner only
+    uint64_t absent [MAX_LAMPS / 64];                   // bit per lamp the fleet has room for but which is not on the bus
+    std::atomic<uint64_t> superseded;       // replaced by a newer command for the same lamp before the owner got to it
+    std::atomic<uint64_t> invalidLamps;     // well-formed, for a lamp the fleet does not have or an absent one
+    LatencyMonitor *latency;                // optional
+    uint64_t arrivedNs;                     // when the bytes being dispatched were read; set by the reader thread
+
+    CommandInbox ();
+
+    // Commands for an absent lamp are counted and dropped; before the reader starts only
+    void markAbsent (size_t lamp) { absent [lamp / 64] |= 1ull << (lamp % 64); }
+    bool isAbsent (size_t lamp) const { return (absent [lamp / 64] >> (lamp % 64)) & 1; }
+
+    // Single writer: the reader thread
+    void post (size_t lamp, const LampCommand& command, uint64_t parsedNs);
+};
+// Lamp command fields start at "first": 0 for the legacy untagged form, 1 for $PSMACC
+bool parseLampCommand (SentenceFields& fields, int first, LampCommand& command);
+
+// Hooks both command forms up to the dispatcher; commands for lamps the fleet has go to the inbox
+void registerLampCommandHandlers (SentenceDispatcher& dispatcher, const LampFleet& fleet, CommandInbox& inbox);
+
+// Applies the latest command of every lamp which has one waiting and returns how many lamps that was; owner thread only
+size_t applyPendingCommands (CommandInbox& inbox, LampFleet& fleet);
+
+// Body of the reader thread: waits for data, frames it and dispatches every sentence until the link fails or is
+// interrupted. onChunk, if given, sees every chunk as read, NUL-terminated, before it is framed.
+void runCommandReader (
+    Link& link, SentenceDispatcher& dispatcher, CommandInbox& inbox, uint32_t timeoutMs = WAIT_FOREVER,
+    const std::function<void (char *chunk, size_t size)>& onChunk = nullptr
+);
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string.h>
+#include "consolelog.h"
+
+ConsoleLog::ConsoleLog (size_t retained): pending (LOG_QUEUE_SIZE), dropped (0), appended (0), lines (retained > 0 ? retained : 1), first (0), count (0), reportedDrops (0) {}
+
+bool ConsoleLog::append (const char *text, size_t size) {
+    const char *end = text + size;
+    bool result = true;
+
+    while (text < end) {
+        const char *lineEnd = (const char *) memchr (text, '\n', (size_t) (end - text));
+
+        if (!lineEnd) lineEnd = end;
+
+        size_t lineSize = (size_t) (lineEnd - text);
+
+        if (lineSize > 0 && text [lineSize - 1] == '\r') -- lineSize;
+        if (lineSize > MAX_LOG_LINE_SIZE) lineSize = MAX_LOG_LINE_SIZE;
+
+        if (lineSize > 0) {
+            bool pushed = pending.push ([text, lineSize] (LogLine& line) {
+                memcpy (line.text, text, lineSize);
+                line.text [lineSize] = '\0';
+                line.size = (uint16_t) lineSize;
+            });
+
+            if (pushed) {
+                appended.fetch_add (1, std::memory_order_relaxed);
+            } else {
+                dropped.fetch_add (1, std::memory_order_relaxed);
+                result = false;
+            }
+        }
+
+        text = lineEnd + 1;
+    }
+
+    return result;
+}
+
+bool ConsoleLog::append (const char *text) {
+    return append (text, strlen (text));
+}
+
+void ConsoleLog::retain (const char *text, size_t size) {
+    size_t index;
+
+    if (count < lines.size ()) {
+        index = (first + count ++) % lines.size ();
+    } else {
+        index = first;
+        first = (first + 1) % lines.size ();
+    }
+
+    LogLine& line = lines [index];
+
+    memcpy (line.text, text, size);
+    line.text [size] = '\0';
+    line.size = (uint16_t) size;
+}
+
+size_t ConsoleLog::drain (size_t limit) {
+    size_t moved = 0;
+    uint64_t drops = dropped.load (std::memory_order_relaxed);
+
+    // where the lines went missing is not known, only that they did by now
+    if (drops != reportedDrops) {
+        char note [MAX_LOG_LINE_SIZE + 1];
+        int size = snprintf (note, sizeof (note), "... %llu lines dropped, the console could not keep up", (unsigned long long) (drops - reportedDrops));
+
+        reportedDrops = drops;
+        retain (note, (size_t) size);
+        ++ moved;
+    }
+
+    while (moved < limit && pending.pop ([this] (const LogLine& line) { retain (line.text, line.size); })) ++ moved;
+
+    return moved;
+}
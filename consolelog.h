@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include "mpsc.h"
+
+static size_t const MAX_LOG_LINE_SIZE = 120;            // longer lines are cut
+static size_t const LOG_QUEUE_SIZE = 4096;              // lines between the writers and the next drain
+static size_t const DEFAULT_LOG_RETAINED = 50000;       // lines kept for display, the oldest go first
+
+struct LogLine {
+    uint16_t size;
+    char text [MAX_LOG_LINE_SIZE + 1];
+};
+
+// Console contents. Any thread appends without blocking or taking a lock, a line that finds the queue full is
+// dropped and counted. The owner thread drains the queue into the retained lines, which the window shows.
+struct ConsoleLog {
+    MpscQueue<LogLine> pending;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> appended;
+
+    // owner thread only
+    std::vector<LogLine> lines;
+    size_t first;                   // oldest retained line
+    size_t count;
+    uint64_t reportedDrops;         // dropped as of the last "lines dropped" note
+
+    ConsoleLog (size_t retained = DEFAULT_LOG_RETAINED);
+
+    // Splits the text at line ends, empty lines are skipped; returns false if any line was dropped
+    bool append (const char *text, size_t size);
+    bool append (const char *text);
+
+    // Moves up to limit pending lines to the retained ones, noting any drops since the last time; returns lines moved
+    size_t drain (size_t limit = LOG_QUEUE_SIZE);
+
+    size_t size () const { return count; }
+    const LogLine& line (size_t index) const { return lines [(first + index) % lines.size ()]; }
+
+    void retain (const char *text, size_t size);
+};
@@ -0,0 +1,132 @@
+#include "conversion.h"
+
+#if defined (_M_X64) || defined (__x86_64__) || defined (__SSE2__)
+#define CONVERSION_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined (CONVERSION_SSE2)
+
+// Same operations in the same order as the scalar inline versions, two lamps at a time, so the batch and the
+// single value results are bit-identical. Compilers will not if-convert the scalar selects around a division
+// under strict IEEE rules, hence the intrinsics.
+namespace {
+    inline __m128d select2 (__m128d mask, __m128d ifTrue, __m128d ifFalse) {
+        return _mm_or_pd (_mm_and_pd (mask, ifTrue), _mm_andnot_pd (mask, ifFalse));
+    }
+
+    inline __m128d horner2 (__m128d x2, __m128d sum, double coef) {
+        return _mm_add_pd (_mm_set1_pd (coef), _mm_mul_pd (x2, sum));
+    }
+
+    inline __m128d sinPoly2 (__m128d x) {
+        __m128d x2 = _mm_mul_pd (x, x);
+        __m128d sum = _mm_set1_pd (1.0 / 362880.0);
+
+        sum = horner2 (x2, sum, -1.0 / 5040.0);
+        sum = horner2 (x2, sum, 1.0 / 120.0);
+        sum = horner2 (x2, sum, -1.0 / 6.0);
+        sum = horner2 (x2, sum, 1.0);
+
+        return _mm_mul_pd (x, sum);
+    }
+
+    inline __m128d cosPoly2 (__m128d x) {
+        __m128d x2 = _mm_mul_pd (x, x);
+        __m128d sum = _mm_set1_pd (-1.0 / 3628800.0);
+
+        sum = horner2 (x2, sum, 1.0 / 40320.0);
+        sum = horner2 (x2, sum, -1.0 / 720.0);
+        sum = horner2 (x2, sum, 1.0 / 24.0);
+        sum = horner2 (x2, sum, -0.5);
+
+        return horner2 (x2, sum, 1.0);
+    }
+
+    // x * (1 - x2 * (1/3 - x2 * (1/5 - ...))) as in atanPoly
+    inline __m128d atanPoly2 (__m128d x) {
+        __m128d x2 = _mm_mul_pd (x, x);
+        __m128d sum = _mm_set1_pd (1.0 / 13.0);
+
+        sum = _mm_sub_pd (_mm_set1_pd (1.0 / 11.0), _mm_mul_pd (x2, sum));
+        sum = _mm_sub_pd (_mm_set1_pd (1.0 / 9.0), _mm_mul_pd (x2, sum));
+        sum = _mm_sub_pd (_mm_set1_pd (1.0 / 7.0), _mm_mul_pd (x2, sum));
+        sum = _mm_sub_pd (_mm_set1_pd (1.0 / 5.0), _mm_mul_pd (x2, sum));
+        sum = _mm_sub_pd (_mm_set1_pd (1.0 / 3.0), _mm_mul_pd (x2, sum));
+
+        return _mm_mul_pd (x, _mm_sub_pd (_mm_set1_pd (1.0), _mm_mul_pd (x2, sum)));
+    }
+
+    void fastElevations2ranges (double mastHeight, const double *elevation, double *range, size_t count) {
+        const __m128d height = _mm_set1_pd (mastHeight);
+        const __m128d toRad = _mm_set1_pd (TO_RAD);
+        const __m128d quarterPi = _mm_set1_pd (conversion::QUARTER_PI), halfPi = _mm_set1_pd (conversion::HALF_PI);
+        size_t i = 0;
+
+        for (; i + 2 <= count; i += 2) {
+            __m128d x = _mm_mul_pd (_mm_loadu_pd (elevation + i), toRad);
+            __m128d steep = _mm_cmpgt_pd (x, quarterPi);
+            __m128d y = select2 (steep, _mm_sub_pd (halfPi, x), x);
+            __m128d sinY = sinPoly2 (y);
+            __m128d cosY = cosPoly2 (y);
+
+            _mm_storeu_pd (range + i, _mm_div_pd (_mm_mul_pd (height, select2 (steep, sinY, cosY)), select2 (steep, cosY, sinY)));
+        }
+
+        for (; i < count; ++ i) range [i] = fastElevation2range (mastHeight, elevation [i]);
+    }
+
+    void fastRanges2elevations (double mastHeight, const double *range, double *elevation, size_t count) {
+        const __m128d height = _mm_set1_pd (mastHeight);
+        const __m128d one = _mm_set1_pd (1.0), zero = _mm_setzero_pd ();
+        const __m128d tanTwelfthPi = _mm_set1_pd (conversion::TAN_TWELFTH_PI), invSqrt3 = _mm_set1_pd (conversion::INV_SQRT3);
+        const __m128d sixthPi = _mm_set1_pd (conversion::SIXTH_PI), halfPi = _mm_set1_pd (conversion::HALF_PI);
+        const __m128d toDeg = _mm_set1_pd (TO_DEG);
+        size_t i = 0;
+
+        for (; i + 2 <= count; i += 2) {
+            __m128d rng = _mm_loadu_pd (range + i);
+            __m128d inverted = _mm_cmpgt_pd (height, rng);
+            __m128d t = _mm_div_pd (select2 (inverted, rng, height), select2 (inverted, height, rng));
+            __m128d shifted = _mm_cmpgt_pd (t, tanTwelfthPi);
+            __m128d u = _mm_div_pd (
+                select2 (shifted, _mm_sub_pd (t, invSqrt3), t), select2 (shifted, _mm_add_pd (one, _mm_mul_pd (t, invSqrt3)), one)
+            );
+            __m128d angle = _mm_add_pd (atanPoly2 (u), select2 (shifted, sixthPi, zero));
+
+            _mm_storeu_pd (elevation + i, _mm_mul_pd (select2 (inverted, _mm_sub_pd (halfPi, angle), angle), toDeg));
+        }
+
+        for (; i < count; ++ i) elevation [i] = fastRange2elevation (mastHeight, range [i]);
+    }
+}
+
+#else
+
+namespace {
+    void fastElevations2ranges (double mastHeight, const double *elevation, double *range, size_t count) {
+        for (size_t i = 0; i < count; ++ i) range [i] = fastElevation2range (mastHeight, elevation [i]);
+    }
+
+    void fastRanges2elevations (double mastHeight, const double *range, double *elevation, size_t count) {
+        for (size_t i = 0; i < count; ++ i) elevation [i] = fastRange2elevation (mastHeight, range [i]);
+    }
+}
+
+#endif
+
+void elevations2ranges (ConversionMode mode, double mastHeight, const double *elevation, double *range, size_t count) {
+    if (mode == ConversionMode::FastConversion) {
+        fastElevations2ranges (mastHeight, elevation, range, count);
+    } else {
+        for (size_t i = 0; i < count; ++ i) range [i] = elevation2range (mastHeight, elevation [i]);
+    }
+}
+
+void ranges2elevations (ConversionMode mode, double mastHeight, const double *range, double *elevation, size_t count) {
+    if (mode == ConversionMode::FastConversion) {
+        fastRanges2elevations (mastHeight, range, elevation, count);
+    } else {
+        for (size_t i = 0; i < count; ++ i) elevation [i] = range2elevation (mastHeight, range [i]);
+    }
+}
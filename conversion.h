@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include "geometry.h"
+
+// Elevation <-> range conversions without libm. Both fast functions are built from short polynomials over a
+// reduced argument and take no branches the compiler cannot turn into selects, so the batch loops vectorise.
+//
+// Maximum error measured against libm over ranges 0.5 m .. MAX_RANGE and mast heights 1 .. 100 m
+// (every elevation between 0.015 and 89.7 degrees), checked by tests/conversion_test.cpp:
+//   fastElevation2range  relative 2.64e-9, absolute 2.64e-7 m
+//   fastRange2elevation  absolute 9.47e-9 degrees
+// Both are far below the 0.1 m / 0.01 degree the simulator displays and sends.
+
+enum ConversionMode {
+    ExactConversion = 0,    // libm tan/atan, as elevation2range/range2elevation
+    FastConversion,
+};
+
+namespace conversion {
+    // sin (x), cos (x) for |x| <= PI / 4; Taylor terms up to x^9 / x^10, truncation under 2e-9 / 2e-10 there
+    inline double sinPoly (double x) {
+        double x2 = x * x;
+
+        return x * (1.0 + x2 * (-1.0 / 6.0 + x2 * (1.0 / 120.0 + x2 * (-1.0 / 5040.0 + x2 * (1.0 / 362880.0)))));
+    }
+
+    inline double cosPoly (double x) {
+        double x2 = x * x;
+
+        return 1.0 + x2 * (-0.5 + x2 * (1.0 / 24.0 + x2 * (-1.0 / 720.0 + x2 * (1.0 / 40320.0 + x2 * (-1.0 / 3628800.0)))));
+    }
+
+    // atan (x) for |x| <= tan (PI / 12); Taylor terms up to x^13, truncation under 2e-10 there
+    inline double atanPoly (double x) {
+        double x2 = x * x;
+
+        return x * (1.0 - x2 * (1.0 / 3.0 - x2 * (1.0 / 5.0 - x2 * (1.0 / 7.0 - x2 * (1.0 / 9.0 - x2 * (1.0 / 11.0 - x2 * (1.0 / 13.0)))))));
+    }
+
+    const double HALF_PI = PI / 2.0;
+    const double QUARTER_PI = PI / 4.0;
+    const double SIXTH_PI = PI / 6.0;
+    const double TAN_TWELFTH_PI = 0.26794919243112270647;
+    const double INV_SQRT3 = 0.57735026918962576451;
+}
+
+// mastHeight / tan (elevation) for elevation in (0, 90] degrees
+inline double fastElevation2range (double mastHeight, double elevation) {
+    double x = elevation * TO_RAD;
+    bool steep = x > conversion::QUARTER_PI;
+    double y = steep ? conversion::HALF_PI - x : x;
+    double sinY = conversion::sinPoly (y);
+    double cosY = conversion::cosPoly (y);
+
+    // cot (x) is cos/sin of x itself below 45 degrees and tan of the complement above; selecting the operands
+    // rather than the quotient leaves a single division and no branch
+    return mastHeight * (steep ? sinY : cosY) / (steep ? cosY : sinY);
+}
+
+// atan (mastHeight / range) in degrees for positive mastHeight and range
+inline double fastRange2elevation (double mastHeight, double range) {
+    bool inverted = mastHeight > range;
+    double t = (inverted ? range : mastHeight) / (inverted ? mastHeight : range);
+
+    // atan (t) = PI / 6 + atan ((t - 1 / sqrt (3)) / (1 + t / sqrt (3))) brings t in [0, 1] down to |u| <= tan (PI / 12)
+    bool shifted = t > conversion::TAN_TWELFTH_PI;
+    double u = (shifted ? t - conversion::INV_SQRT3 : t) / (shifted ? 1.0 + t * conversion::INV_SQRT3 : 1.0);
+    double angle = conversion::atanPoly (u) + (shifted ? conversion::SIXTH_PI : 0.0);
+
+    return (inverted ? conversion::HALF_PI - angle : angle) * TO_DEG;
+}
+
+inline double convertElevation2range (ConversionMode mode, double mastHeight, double elevation) {
+    return mode == ConversionMode::FastConversion ? fastElevation2range (mastHeight, elevation) : elevation2range (mastHeight, elevation);
+}
+
+inline double convertRange2elevation (ConversionMode mode, double mastHeight, double range) {
+    return mode == ConversionMode::FastConversion ? fastRange2elevation (mastHeight, range) : range2elevation (mastHeight, range);
+}
+
+// Batch variants; source and destination may be the same array
+void elevations2ranges (ConversionMode mode, double mastHeight, const double *elevation, double *range, size_t count);
+void ranges2elevations (ConversionMode mode, double mastHeight, const double *range, double *elevation, size_t count);
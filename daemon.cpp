@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include "link.h"
+#include "dispatch.h"
+#include "commands.h"
+#include "fleet.h"
+#include "engine.h"
+#include "telemetry.h"
+#include "transmitter.h"
+#include "latency.h"
+#include "json_lite.h"
+
+// lampd: the simulator with no window, for servers and CI boxes. Reads commands from a port, runs the lamps
+// through the motion model and sends $PSMACK from the telemetry thread, like the window does, until SIGINT or
+// SIGTERM (Ctrl+C or Ctrl+Break on Windows). Everything is allocated at start-up for the lamps configured,
+// nothing grows while it runs.
+
+static uint32_t const DAEMON_TICK_MS = 50;             // how often commands are applied and the lamps moved
+
+struct LampSetup {
+    uint16_t id;
+    double brg;
+    double elev;
+    uint8_t focus;
+    uint32_t faults;            // LampStatus bits the lamp starts with
+};
+
+// A config file holds one object; every key is optional and command line options after -c override it:
+//   {"port": "/dev/ttyUSB0", "baud": 115200, "mastHeight": 10, "rate": 4, "heartbeat": 1, "instant": false,
+//    "brg": 0, "elev": 0.25, "faults": 0,
+//    "lamps": [1, 2, {"id": 5, "brg": 90, "elev": 0.5, "focus": 99, "faults": 16}]}
+// "lamps" may also be a plain count, lamps 1 to N. Top level brg/elev/faults are what listed lamps start with.
+struct DaemonConfig {
+    std::string port;
+    uint32_t baudRate;
+    double mastHeight;
+    double rate;
+    double heartbeat;           // s, 0 for periodic emission
+    double statsInterval;       // s, 0 for statistics at exit only
+    bool instantMode;
+    bool usePty;
+    LampSetup defaults;
+    std::vector<LampSetup> lamps;
+    bool positionGiven, faultsGiven;    // on the command line, for every lamp
+
+    DaemonConfig ():
+        baudRate (DEFAULT_BAUD_RATE),
+        mastHeight (10.0),
+        rate (DEFAULT_TELEMETRY_RATE),
+        heartbeat (0.0),
+        statsInterval (0.0),
+        instantMode (false),
+        usePty (false),
+        defaults (LampSetup { 0, 0.0, 0.25, 99, LampStatus::LampOK }),
+        positionGiven (false),
+        faultsGiven (false) {}
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+#ifdef _WIN32
+static BOOL WINAPI onConsoleEvent (DWORD) {
+    stopRequested = 1;
+
+    return TRUE;
+}
+#else
+static void onSignal (int) {
+    stopRequested = 1;
+}
+#endif
+
+static void installStopHandlers () {
+#ifdef _WIN32
+    SetConsoleCtrlHandler (onConsoleEvent, TRUE);
+#else
+    struct sigaction action;
+
+    memset (& action, 0, sizeof (action));
+    action.sa_handler = onSignal;
+    sigemptyset (& action.sa_mask);
+    sigaction (SIGINT, & action, 0);
+    sigaction (SIGTERM, & action, 0);
+    signal (SIGPIPE, SIG_IGN);
+#endif
+}
+
+static bool addLamp (DaemonConfig& config, LampSetup lamp) {
+    if (lamp.id < 1 || lamp.id > MAX_LAMPS) return false;
+
+    for (auto& existing: config.lamps) {
+        if (existing.id == lamp.id) {
+            existing = lamp; return true;
+        }
+    }
+
+    config.lamps.push_back (lamp);
+
+    return true;
+}
+
+// "1-4,7,9"
+static bool parseLampIds (const char *text, DaemonConfig& config) {
+    config.lamps.clear ();
+
+    while (*text) {
+        char *end;
+        long first = strtol (text, & end, 10), last = first;
+
+        if (end == text) return false;
+
+        if (*end == '-') {
+            text = end + 1;
+            last = strtol (text, & end, 10);
+
+            if (end == text || last < first) return false;
+        }
+
+        for (long id = first; id <= last; ++ id) {
+            LampSetup lamp = config.defaults;
+
+            lamp.id = (uint16_t) id;
+
+            if (id > (long) MAX_LAMPS || !addLamp (config, lamp)) return false;
+        }
+
+        text = *end == ',' ? end + 1 : end;
+
+        if (*end && *end != ',') return false;
+    }
+
+    return !config.lamps.empty ();
+}
+
+static double getNumber (json::hashNode *hash, const char *key, double defValue) {
+    json::node *item = (*hash) [key];
+
+    return item && item->type == json::nodeType::number ? ((json::numberNode *) item)->getValue () : defValue;
+}
+
+// 0, which addLamp rejects, unless the number is a whole lamp ID; checked before any cast so 65537 or -5 cannot wrap into range
+static uint16_t lampIdOf (double value) {
+    return value >= 1.0 && value <= (double) MAX_LAMPS && value == floor (value) ? (uint16_t) value : 0;
+}
+
+static bool loadConfig (const char *path, DaemonConfig& config) {
+    FILE *file = fopen (path, "rb");
+
+    if (!file) return false;
+
+    std::string source;
+    char buffer [4096];
+    size_t bytesRead;
+
+    while ((bytesRead = fread (buffer, 1, sizeof (buffer), file)) > 0) source.append (buffer, bytesRead);
+
+    fclose (file);
+
+    int nextChar = 0;
+    json::node *root = json::parse ((char *) source.c_str (), nextChar);
+
+    if (!root) return false;
+
+    if (root->type != json::nodeType::hash) {
+        delete root; return false;
+    }
+
+    json::hashNode *hash = (json::hashNode *) root;
+    json::node *port = (*hash) ["port"];
+    json::node *instant = (*hash) ["instant"];
+    json::node *lamps = (*hash) ["lamps"];
+    bool result = true;
+
+    if (port && port->type == json::nodeType::string) config.port = ((json::stringNode *) port)->getValue ();
+    if (instant && instant->type == json::nodeType::boolean) config.instantMode = ((json::booleanNode *) instant)->getValue ();
+
+    config.baudRate = (uint32_t) getNumber (hash, "baud", (double) config.baudRate);
+    config.mastHeight = getNumber (hash, "mastHeight", config.mastHeight);
+    config.rate = getNumber (hash, "rate", config.rate);
+    config.heartbeat = getNumber (hash, "heartbeat", config.heartbeat);
+    config.defaults.brg = getNumber (hash, "brg", config.defaults.brg);
+    config.defaults.elev = getNumber (hash, "elev", config.defaults.elev);
+    config.defaults.focus = (uint8_t) getNumber (hash, "focus", (double) config.defaults.focus);
+    config.defaults.faults = (uint32_t) getNumber (hash, "faults", (double) config.defaults.faults);
+
+    if (lamps && lamps->type == json::nodeType::number) {
+        uint16_t count = lampIdOf (((json::numberNode *) lamps)->getValue ());
+
+        config.lamps.clear ();
+
+        if (count == 0) result = false;
+
+        for (uint16_t id = 1; id <= count; ++ id) {
+            LampSetup lamp = config.defaults;
+
+            lamp.id = id;
+            addLamp (config, lamp);
+        }
+    } else if (lamps && lamps->type == json::nodeType::array) {
+        config.lamps.clear ();
+
+        for (auto item: *(json::arrayNode *) lamps) {
+            LampSetup lamp = config.defaults;
+
+            if (item && item->type == json::nodeType::number) {
+                lamp.id = lampIdOf (((json::numberNode *) item)->getValue ());
+            } else if (item && item->type == json::nodeType::hash) {
+                json::hashNode *lampHash = (json::hashNode *) item;
+
+                lamp.id = lampIdOf (getNumber (lampHash, "id", 0.0));
+                lamp.brg = getNumber (lampHash, "brg", lamp.brg);
+                lamp.elev = getNumber (lampHash, "elev", lamp.elev);
+                lamp.focus = (uint8_t) getNumber (lampHash, "focus", (double) lamp.focus);
+                lamp.faults = (uint32_t) getNumber (lampHash, "faults", (double) lamp.faults);
+            } else {
+                lamp.id = 0;
+            }
+
+            if (!addLamp (config, lamp)) result = false;
+        }
+    }
+
+    delete root;
+
+    return result;
+}
+
+static void showUsage () {
+    printf (
+        "Usage: lampd [-c config.json] [-p port | -P] [-b baud] [-m mast] [-l ids] [-a brg elev] [-f faults] [-r rate] [-h heartbeat] [-i] [-s seconds]\n"
+        "  -c  JSON config file; options after it override what it says\n"
+        "  -p  serial port, \\\\.\\COM3 or /dev/ttyUSB0\n"
+        "  -P  open a pseudo-terminal and print the name a control unit should open (not on Windows)\n"
+        "  -b  baud rate, 115200 by default\n"
+        "  -m  mast height in metres, 10 by default\n"
+        "  -l  lamp IDs, \"1-4,7\"; lamp 1 by default; nothing is sent for IDs left out and commands for them count as unknown lamp\n"
+        "  -a  bearing and elevation in degrees every lamp starts at\n"
+        "  -f  LampStatus bits every lamp starts with, e.g. 16 for daylight\n"
+        "  -r  $PSMACK rate per lamp in Hz, 4 by default\n"
+        "  -h  heartbeat interval in seconds; lamps are then only sent on change and otherwise once per heartbeat\n"
+        "  -i  instant mode, lamps jump to the requested position\n"
+        "  -s  print statistics every this many seconds, otherwise only at exit\n"
+    );
+}
+
+static void printStats (size_t numOfLamps, const Link& link, const SentenceDispatcher& dispatcher, const CommandInbox& inbox, uint64_t applied, TelemetryScheduler& telemetry, Transmitter& transmitter) {
+    uint64_t received = dispatcher.unknown.received, handled = 0, crcFailed = dispatcher.unknown.crcFailed;
+
+    for (auto& counter: dispatcher.counters) {
+        received += counter.received;
+        handled += counter.handled;
+        crcFailed += counter.crcFailed;
+    }
+
+    TelemetryStats telemetryStats = telemetry.stats ();
+    TransmitterStats transmitterStats = transmitter.stats ();
+
+    printf (
+        "lamps %zu | in %llu bytes, %llu sentences, %llu handled, %llu bad checksum, %llu applied, %llu superseded, %llu unknown lamp"
+        " | out %llu sentences, %llu dropped, %llu write errors, lateness max %.2f ms\n",
+        numOfLamps,
+        (unsigned long long) link.bytesReceived,
+        (unsigned long long) received,
+        (unsigned long long) handled,
+        (unsigned long long) crcFailed,
+        (unsigned long long) applied,
+        (unsigned long long) inbox.superseded.load (),
+        (unsigned long long) inbox.invalidLamps.load (),
+        (unsigned long long) transmitterStats.sentences,
+        (unsigned long long) transmitterStats.dropped,
+        (unsigned long long) transmitterStats.writeErrors,
+        (double) telemetryStats.maxLatenessNs / 1.0e6
+    );
+    fflush (stdout);
+}
+
+int main (int argCount, char *args []) {
+    DaemonConfig config;
+    const char *lampIds = 0;
+
+    for (int i = 1; i < argCount; ++ i) {
+        bool hasValue = i + 1 < argCount, hasPair = i + 2 < argCount;
+
+        if (strcmp (args [i], "-c") == 0 && hasValue) {
+            if (!loadConfig (args [++ i], config)) {
+                fprintf (stderr, "Unable to load config from %s\n", args [i]); return 2;
+            }
+        } else if (strcmp (args [i], "-p") == 0 && hasValue) {
+            config.port = args [++ i];
+        } else if (strcmp (args [i], "-P") == 0) {
+            config.usePty = true;
+        } else if (strcmp (args [i], "-b") == 0 && hasValue) {
+            config.baudRate = (uint32_t) atol (args [++ i]);
+        } else if (strcmp (args [i], "-m") == 0 && hasValue) {
+            config.mastHeight = atof (args [++ i]);
+        } else if (strcmp (args [i], "-l") == 0 && hasValue) {
+            lampIds = args [++ i];
+        } else if (strcmp (args [i], "-a") == 0 && hasPair) {
+            config.defaults.brg = atof (args [++ i]);
+            config.defaults.elev = atof (args [++ i]);
+            config.positionGiven = true;
+        } else if (strcmp (args [i], "-f") == 0 && hasValue) {
+            config.defaults.faults = (uint32_t) strtoul (args [++ i], 0, 0);
+            config.faultsGiven = true;
+        } else if (strcmp (args [i], "-r") == 0 && hasValue) {
+            config.rate = atof (args [++ i]);
+        } else if (strcmp (args [i], "-h") == 0 && hasValue) {
+            config.heartbeat = atof (args [++ i]);
+        } else if (strcmp (args [i], "-i") == 0) {
+            config.instantMode = true;
+        } else if (strcmp (args [i], "-s") == 0 && hasValue) {
+            config.statsInterval = atof (args [++ i]);
+        } else {
+            showUsage (); return 1;
+        }
+    }
+
+    if (lampIds && !parseLampIds (lampIds, config)) {
+        fprintf (stderr, "Bad lamp list %s\n", lampIds); return 1;
+    }
+
+    if (config.lamps.empty ()) {
+        LampSetup lamp = config.defaults;
+
+        lamp.id = 1;
+        config.lamps.push_back (lamp);
+    }
+
+    for (auto& lamp: config.lamps) {
+        if (config.positionGiven) {
+            lamp.brg = config.defaults.brg;
+            lamp.elev = config.defaults.elev;
+        }
+        if (config.faultsGiven) lamp.faults = config.defaults.faults;
+    }
+
+    if ((config.port.empty () && !config.usePty) || config.mastHeight <= 0.0 || config.rate <= 0.0) {
+        showUsage (); return 1;
+    }
+
+    // the fleet covers every ID up to the highest one, lamp N lives at index N - 1; the IDs left out are absent:
+    // the inbox drops commands for them and telemetry never sends them
+    size_t numOfLamps = 0;
+
+    for (auto& lamp: config.lamps) if (lamp.id > numOfLamps) numOfLamps = lamp.id;
+
+    LampFleet fleet (numOfLamps, config.mastHeight);
+    std::vector<bool> configured (numOfLamps, false);
+
+    for (auto& lamp: config.lamps) {
+        size_t index = fleet.indexOf (lamp.id);
+
+        fleet.actualBrg [index] = fleet.requestedBrg [index] = lamp.brg;
+        fleet.actualElev [index] = fleet.requestedElev [index] = lamp.elev;
+        fleet.actualFocus [index] = fleet.requestedFocus [index] = lamp.focus;
+        fleet.status [index] = lamp.faults;
+        configured [index] = true;
+    }
+
+    Transport *transport = 0, *peer = 0;
+
+    if (config.usePty) {
+#ifdef _WIN32
+        fprintf (stderr, "No pseudo-terminals on Windows\n"); return 2;
+#else
+        char peerName [256];
+
+        // the peer end stays open for the daemon's lifetime, or reads from ours fail whenever no control unit is attached
+        if (!openPtyPair (transport, peer, peerName, sizeof (peerName))) {
+            fprintf (stderr, "Unable to open a pseudo-terminal pair\n"); return 2;
+        }
+
+        printf ("pty %s\n", peerName);
+#endif
+    } else if (!(transport = openSerialTransport (config.port.c_str (), config.baudRate))) {
+        fprintf (stderr, "Unable to open %s\n", config.port.c_str ()); return 2;
+    }
+
+    Link link;
+    SentenceDispatcher dispatcher;
+    CommandInbox inbox;
+    LatencyMonitor latency (fleet.size ());
+    MotionEngine engine (fleet);
+    TelemetryScheduler telemetry (fleet.size (), config.rate);
+    Transmitter transmitter (config.lamps.size () < 32 ? 64 : config.lamps.size () * 2);   // room for two ticks worth of sentences
+    uint64_t applied = 0;
+
+    engine.instantMode = config.instantMode;
+    inbox.latency = & latency;
+    telemetry.latency = & latency;
+    transmitter.latency = & latency;
+
+    for (size_t i = 0; i < numOfLamps; ++ i) {
+        if (!configured [i]) {
+            fleet.status [i] = LampStatus::NoLampFound;
+            inbox.markAbsent (i);
+            telemetry.silence (i);
+        }
+    }
+
+    if (config.heartbeat > 0.0) telemetry.setEmissionMode (EmissionMode::EmitOnChange, config.heartbeat);
+
+    registerLampCommandHandlers (dispatcher, fleet, inbox);
+    installStopHandlers ();
+
+    link.attach (transport);
+    telemetry.publish (fleet);
+    transmitter.start (& link);
+    telemetry.start (& transmitter);
+
+    std::thread reader ([&link, &dispatcher, &inbox] () { runCommandReader (link, dispatcher, inbox); });
+
+    printf ("lampd: %zu lamps on %s, $PSMACK at %.1f Hz%s\n", config.lamps.size (), config.usePty ? "a pty" : config.port.c_str (), config.rate, config.heartbeat > 0.0 ? " on change" : "");
+    fflush (stdout);
+
+    // this thread owns the fleet, as the UI thread does in the window
+    auto nextStats = std::chrono::steady_clock::now () + std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> (config.statsInterval));
+
+    while (!stopRequested) {
+        std::this_thread::sleep_for (std::chrono::milliseconds (DAEMON_TICK_MS));
+
+        applied += applyPendingCommands (inbox, fleet);
+        engine.update ();
+        telemetry.publish (fleet);
+
+        if (config.statsInterval > 0.0 && std::chrono::steady_clock::now () >= nextStats) {
+            printStats (config.lamps.size (), link, dispatcher, inbox, applied, telemetry, transmitter);
+
+            nextStats += std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> (config.statsInterval));
+        }
+    }
+
+    // same order as closing the port in the window: nobody touches the transport once it goes
+    link.interrupt ();
+    reader.join ();
+    telemetry.stop ();
+    transmitter.stop ();
+
+    printStats (config.lamps.size (), link, dispatcher, inbox, applied, telemetry, transmitter);
+    latency.dump (stdout);
+
+    link.close ();
+    delete peer;
+
+    return 0;
+}
@@ -1,10 +1,21 @@
 #pragma once
 
-static double const MAX_RANGE = 2.0 * 1852.0;
-
 #include <Windows.h>
 #include <cstdint>
 #include <time.h>
+#include "link.h"
+#include "transmitter.h"
+#include "lamp.h"
+#include "fleet.h"
+#include "engine.h"
+#include "telemetry.h"
+#include "dispatch.h"
+#include "commands.h"
+#include "latency.h"
+#include "render.h"
+#include "display.h"
+#include "binding.h"
+#include "consolelog.h"
 
 enum OutputFlags {
     FAKE_MODE = 1,
@@ -20,18 +31,40 @@ enum CtlProtectFlags {
     ACT_RNG = 32,
 };
 
-enum LampStatus
-{
-    LampOK         = 0,
-    AzimuthFault   = 1,
-    ElevationFault = 2,
-    FocusFault     = 4,
-    TempSensorFail = 8,
-    Daylight       = 16,
-    PowerLoss      = 32,
-    NoLampFound    = 0x80
+// Parts of the shown lamp the controls are bound to; whatever changes one marks it with ctx->bindings.changed ()
+enum BoundSource {
+    REQUESTED_POSITION = 1,
+    ACTUAL_POSITION = 2,
+    LAMP_STATUS = 4,
 };
 
+// Off-screen copies of the lamp display: the dial, drawn once per size, and the frame the beams go onto before
+// it is copied to the window
+struct DisplayBuffers {
+    HDC dialCtx, frameCtx;
+    HBITMAP dialBitmap, frameBitmap;
+    HGDIOBJ dialDefault, frameDefault;      // bitmaps the memory contexts came with
+    GdiRenderer renderer;                   // attached to one of the two at a time
+    long width, height;
+    RECT beams;                             // what the beams covered in the last frame
+    uint64_t frames, totalPaintNs, maxPaintNs;
+
+    DisplayBuffers (): dialCtx (0), frameCtx (0), dialBitmap (0), frameBitmap (0), dialDefault (0), frameDefault (0), width (0), height (0), frames (0), totalPaintNs (0), maxPaintNs (0) {
+        SetRectEmpty (& beams);
+    }
+    ~DisplayBuffers () {
+        release ();
+    }
+
+    // Returns true when the buffers had to be (re)created, which leaves the dial to be drawn
+    bool fit (HDC target, long _width, long _height);
+    void release ();
+};
+
+struct Ctx;
+
+void closePort (Ctx *ctx);
+
 struct Ctx {
     uint8_t ctlProtectMask;
     HINSTANCE instance;
@@ -40,26 +73,22 @@ struct Ctx {
     HWND lampOk, azimuthFault, elevationFault, focusFault, tempSensorFail, daylight, powerLoss;
     RECT client;
     uint8_t outputFlags;
-    HANDLE port;
-    union {
-        HGDIOBJ objects [7];
-        struct {
-            HBRUSH displayBrush, wndBrush, beamBrush, beamBrush2;
-            HPEN borderPen, beamPen, beamPen2;
-        };
-    };
-    double actualBrg;
-    double actualElev;
-    double requestedBrg;
-    double requestedElev;
-    double mastHeight;
-    bool instantMode;
-    clock_t lastCorrection;
-    HANDLE locker, reader;
+    Link link;
+    Transmitter transmitter;
+    HBRUSH wndBrush;
+    LampFleet fleet;
+    size_t shownLamp;                           // index of the lamp the window displays and controls
+    TelemetryScheduler telemetry;               // emits $PSMACK for every lamp while the port is open
+    MotionEngine engine;
+    HANDLE reader;
     std::vector<std::string> incomingStrings;
-    bool keepRunning;
-    uint8_t requestedFocus;
-    uint8_t actualFocus;
+    SentenceDispatcher dispatcher;           // used by the reader thread only, counters readable anywhere
+    CommandInbox commands;                   // reader thread -> UI thread
+    CaptureWriter capture;                   // fed by the link while a capture runs
+    LatencyMonitor latency;                  // command latencies, one stage per thread
+    DisplayBuffers displayBuffers;
+    ConsoleLog log;                          // what the console shows; any thread appends
+    ControlBindings bindings;                // edit boxes and status toggles, refreshed from the model
 
     Ctx (
         uint8_t _ctlProtectMask,
@@ -70,48 +99,52 @@ struct Ctx {
         uint8_t _actualFocus,
         double _requestedBrg,
         double _requestedElev,
-        uint8_t _requestedFocus
+        uint8_t _requestedFocus,
+        size_t _numOfLamps = 1
     ):
     ctlProtectMask (_ctlProtectMask),
     instance (_instance),
-    actualBrg (_actualBrg),
-    actualElev (_actualElev),
-    requestedBrg (_requestedBrg),
-    requestedElev (_requestedElev),
-    mastHeight (_mastHeight),
-    lastCorrection (0),
-    port (INVALID_HANDLE_VALUE),
-    locker (CreateMutex (0, 0, "LampSimLocker")),
+    transmitter (_numOfLamps < 32 ? 64 : _numOfLamps * 2),    // room for two ticks worth of sentences
+    fleet (_numOfLamps, _mastHeight),
+    shownLamp (0),
+    telemetry (fleet.size ()),
+    engine (fleet),
     reader (0),
-    keepRunning (false),
-    requestedFocus (_requestedFocus),
-    actualFocus (_actualFocus),
+    latency (fleet.size ()),
     portCtlButton (0),
     portSelector (0),
     instantModeSwitch (0),
-    instantMode (false),
 
     outputFlags (OutputFlags::COPY_TO_CONCOLE /*| OutputFlags::FAKE_MODE*/) {
-        borderPen = CreatePen (PS_SOLID, 3, 0);
-        displayBrush = CreateSolidBrush (RGB (100, 100, 100));
-        wndBrush = CreateSolidBrush (RGB (200, 200, 200));
-        beamPen = CreatePen (PS_SOLID, 1, RGB (255, 200, 0));
-        beamPen2 = CreatePen (PS_SOLID, 1, RGB (200, 150, 0));
-        beamBrush = CreateSolidBrush (RGB (255, 200, 0));
-        beamBrush2 = CreateSolidBrush (RGB (200, 150, 0));
+        for (size_t i = 0; i < fleet.size (); ++ i) {
+            fleet.actualBrg [i] = _actualBrg;
+            fleet.actualElev [i] = _actualElev;
+            fleet.actualFocus [i] = _actualFocus;
+            fleet.requestedBrg [i] = _requestedBrg;
+            fleet.requestedElev [i] = _requestedElev;
+            fleet.requestedFocus [i] = _requestedFocus;
+        }
+
+        telemetry.publish (fleet);
+
+        link.capture = & capture;
+        commands.latency = & latency;
+        telemetry.latency = & latency;
+        transmitter.latency = & latency;
+
+        wndBrush = CreateSolidBrush (RGB (DISPLAY_BACKGROUND.red, DISPLAY_BACKGROUND.green, DISPLAY_BACKGROUND.blue));
     }
 
+    // The reader, telemetry and transmitter threads reach latency, capture and the fleet through pointers, and
+    // those members go before the thread owners do; every thread is joined before any member is torn down
     virtual ~Ctx () {
-        if (locker) {
-            unlock ();
+        closePort (this);
 
-            CloseHandle (locker);
-        }
-        if (reader) {
-            if (WaitForSingleObject (reader, 1000) != WAIT_OBJECT_0) TerminateThread (reader, 0);
-            CloseHandle (reader);
-        }
-        for (int i = 0; i < 7; DeleteObject (objects [i++]));
+        // a capture still running gets its index now, with nothing left that could append to it
+        link.capture = 0;
+        capture.stop ();
+
+        DeleteObject (wndBrush);
     }
     
     void protect (CtlProtectFlags flag) {
@@ -120,16 +153,13 @@ struct Ctx {
     void unprotect (CtlProtectFlags flag) {
         ctlProtectMask &= (~flag);
     }
-    void lock () {
-        if (locker) WaitForSingleObject (locker, INFINITE);
-    }
-    void unlock () {
-        if (locker) ReleaseMutex (locker);
-    }
 };
 
-void sendLampSentence (double brg, double elevation, uint32_t status, Ctx *ctx);
 void getSerialPortsList (std::vector<std::string>& ports);
 bool openPort (Ctx *ctx);
+bool openReplay (Ctx *ctx, const char *path, double speed);
+void registerSentenceHandlers (Ctx *ctx);
 void startReader (Ctx *ctx);
+void stopReader (Ctx *ctx);
+void applyPendingCommands (Ctx *ctx);
 void addToConsole (char *text, Ctx *ctx);
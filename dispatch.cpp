@@ -0,0 +1,76 @@
+#include <string.h>
+#include "dispatch.h"
+
+namespace {
+    struct SlotTable {
+        int8_t ids [SENTENCE_TABLE_SIZE];
+    };
+
+    constexpr SlotTable buildSlotTable () {
+        SlotTable table {};
+
+        for (size_t i = 0; i < SENTENCE_TABLE_SIZE; ++ i) table.ids [i] = (int8_t) SentenceId::UnknownSentence;
+
+        for (int id = LegacyLampCommand + 1; id < NUM_OF_SENTENCE_IDS; ++ id) {
+            table.ids [sentenceIdHash (SENTENCE_NAMES [id], sentenceNameSize (SENTENCE_NAMES [id]), SENTENCE_HASH_SEED)] = (int8_t) id;
+        }
+
+        return table;
+    }
+
+    constexpr SlotTable SLOTS = buildSlotTable ();
+
+    void resetCounters (SentenceCounters& counters) {
+        counters.received = 0;
+        counters.crcFailed = 0;
+        counters.handled = 0;
+    }
+}
+
+SentenceDispatcher::SentenceDispatcher () {
+    for (auto& item: counters) resetCounters (item);
+
+    resetCounters (unknown);
+}
+
+void SentenceDispatcher::on (SentenceId id, SentenceHandler handler) {
+    if (id > SentenceId::UnknownSentence && id < NUM_OF_SENTENCE_IDS) handlers [id] = handler;
+}
+
+SentenceId SentenceDispatcher::identify (const FieldView& name) {
+    if (name.empty () || name.size > MAX_SENTENCE_ID_SIZE) return SentenceId::UnknownSentence;
+
+    if (name.data [0] >= '0' && name.data [0] <= '9') return SentenceId::LegacyLampCommand;
+
+    int id = SLOTS.ids [sentenceIdHash (name.data, name.size, SENTENCE_HASH_SEED)];
+
+    if (id == SentenceId::UnknownSentence) return SentenceId::UnknownSentence;
+
+    const char *known = SENTENCE_NAMES [id];
+
+    // the slot only says which known name it could be; confirm it
+    return strncmp (known, name.data, name.size) == 0 && known [name.size] == '\0' ? (SentenceId) id : SentenceId::UnknownSentence;
+}
+
+const char *SentenceDispatcher::sentenceName (SentenceId id) {
+    if (id == SentenceId::LegacyLampCommand) return "lamp";
+
+    return id > SentenceId::UnknownSentence && id < NUM_OF_SENTENCE_IDS ? SENTENCE_NAMES [id] : "unknown";
+}
+
+SentenceId SentenceDispatcher::dispatch (const char *source, size_t size, const SentenceScan *scan) {
+    SentenceFields fields;
+    int numOfFields = scan ? tokenizeScannedSentence (source, size, * scan, fields) : tokenizeSentence (source, size, fields);
+    SentenceId id = fields.count > 0 ? identify (fields [0]) : SentenceId::UnknownSentence;
+    SentenceCounters& counter = id == SentenceId::UnknownSentence ? unknown : counters [id];
+
+    counter.received.fetch_add (1, std::memory_order_relaxed);
+
+    if (fields.crcFailed) {
+        counter.crcFailed.fetch_add (1, std::memory_order_relaxed);
+    } else if (numOfFields > 0 && id != SentenceId::UnknownSentence && handlers [id] && handlers [id] (fields)) {
+        counter.handled.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    return id;
+}
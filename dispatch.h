@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include "nmea.h"
+
+// Sentences the simulator knows by name. LegacyLampCommand is the control unit's original untagged form,
+// "$<lamp>,<brg>,<elev>,<focus>,...", recognised by a numeric first field rather than by name.
+enum SentenceId {
+    UnknownSentence = -1,
+    LegacyLampCommand = 0,
+    PsmaccSentence,         // $PSMACC,<lamp>,<brg>,<elev>,<focus>: lamp command, tagged form
+    PsmackSentence,         // $PSMACK: lamp status, from other lamps on a shared bus
+    GpggaSentence,
+    GprmcSentence,
+    GpvtgSentence,
+    GpzdaSentence,
+    GphdtSentence,
+    HehdtSentence,
+    NUM_OF_SENTENCE_IDS,
+};
+
+static size_t const MAX_SENTENCE_ID_SIZE = 8;
+static size_t const SENTENCE_TABLE_SIZE = 16;
+
+static constexpr const char *SENTENCE_NAMES [NUM_OF_SENTENCE_IDS] = {
+    "", "PSMACC", "PSMACK", "GPGGA", "GPRMC", "GPVTG", "GPZDA", "GPHDT", "HEHDT"
+};
+
+// FNV-1a over the sentence name, mixed with a seed chosen at compile time so that every known name lands in its own slot
+constexpr uint32_t sentenceIdHash (const char *name, size_t size, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < size; ++ i) hash = (hash ^ (uint8_t) name [i]) * 16777619u;
+
+    return (hash ^ (hash >> 15)) & (SENTENCE_TABLE_SIZE - 1);
+}
+
+constexpr size_t sentenceNameSize (const char *name) {
+    size_t size = 0;
+
+    while (name [size]) ++ size;
+
+    return size;
+}
+
+constexpr bool isPerfectSeed (uint32_t seed) {
+    bool used [SENTENCE_TABLE_SIZE] {};
+
+    for (int id = LegacyLampCommand + 1; id < NUM_OF_SENTENCE_IDS; ++ id) {
+        uint32_t slot = sentenceIdHash (SENTENCE_NAMES [id], sentenceNameSize (SENTENCE_NAMES [id]), seed);
+
+        if (used [slot]) return false;
+
+        used [slot] = true;
+    }
+
+    return true;
+}
+
+constexpr uint32_t findPerfectSeed () {
+    for (uint32_t seed = 1; seed < 100000; ++ seed) {
+        if (isPerfectSeed (seed)) return seed;
+    }
+
+    return 0;
+}
+
+static constexpr uint32_t SENTENCE_HASH_SEED = findPerfectSeed ();
+
+static_assert (SENTENCE_HASH_SEED != 0, "no collision-free seed for the known sentence names, grow SENTENCE_TABLE_SIZE");
+
+struct SentenceCounters {
+    std::atomic<uint64_t> received;
+    std::atomic<uint64_t> crcFailed;
+    std::atomic<uint64_t> handled;      // a handler was registered and accepted the sentence
+};
+
+typedef std::function<bool (SentenceFields& fields)> SentenceHandler;
+
+// Routes each incoming sentence to the handler registered for its name. Identification is one hash of at most
+// MAX_SENTENCE_ID_SIZE characters, one table slot and one compare, so unknown traffic costs the same whatever it is.
+// Counters are bumped on the reader thread and may be read from any other.
+struct SentenceDispatcher {
+    SentenceHandler handlers [NUM_OF_SENTENCE_IDS];
+    SentenceCounters counters [NUM_OF_SENTENCE_IDS];
+    SentenceCounters unknown;
+
+    SentenceDispatcher ();
+
+    void on (SentenceId id, SentenceHandler handler);
+
+    static SentenceId identify (const FieldView& name);
+    static const char *sentenceName (SentenceId id);
+
+    // Tokenizes, identifies, counts and hands the sentence over; returns what it was identified as. With the framer's
+    // scan of the sentence the fields are taken from that rather than looked for again.
+    SentenceId dispatch (const char *source, size_t size, const SentenceScan *scan = 0);
+};
@@ -0,0 +1,99 @@
+#include <math.h>
+#include "display.h"
+#include "geometry.h"
+#include "lamp.h"
+
+void DialGeometry::project (double angle, double radius, long& x, long& y) const {
+    double angleRad = toRad (angle);
+    if (angleRad < 0.0) angleRad += TWO_PI;
+    if (angleRad >= TWO_PI) angleRad -= TWO_PI;
+    x = centerX + (long) (radius * sin (angleRad));
+    y = centerY - (long) (radius * cos (angleRad));
+}
+
+void beamShape (const LampFleet& fleet, const DialGeometry& dial, double elevation, double brg, RenderPoint *vertices, RenderRect& spot) {
+    auto range = convertElevation2range (fleet.conversion, fleet.mastHeight, elevation);
+    auto radius = range / MAX_RANGE * dial.zone * 4.0;
+    // the range grows without bound towards the horizon (inf at 0); a beam that long is off any display anyway
+    if (!isfinite (radius) || fabs (radius) > MAX_BEAM_RADIUS) radius = radius < 0.0 ? - MAX_BEAM_RADIUS : MAX_BEAM_RADIUS;
+    long spotX, spotY;
+    long spotRadius = (long) (radius * sin (5.0 * TO_RAD));
+    dial.project (brg - 5, radius, vertices [0].x, vertices [0].y);
+    dial.project (brg + 5, radius, vertices [1].x, vertices [1].y);
+    dial.project (brg, radius, spotX, spotY);
+    vertices [2].x = dial.centerX;
+    vertices [2].y = dial.centerY;
+    vertices [3].x = vertices [0].x;
+    vertices [3].y = vertices [0].y;
+    spot = RenderRect { spotX - spotRadius, spotY - spotRadius, spotX + spotRadius, spotY + spotRadius };
+}
+
+RenderRect beamBounds (const LampFleet& fleet, size_t lamp, const DialGeometry& dial) {
+    RenderRect bounds { dial.centerX, dial.centerY, dial.centerX + 1, dial.centerY + 1 };
+    RenderPoint vertices [4];
+    RenderRect spot;
+
+    auto include = [& bounds] (long left, long top, long right, long bottom) {
+        if (left < bounds.left) bounds.left = left;
+        if (top < bounds.top) bounds.top = top;
+        if (right > bounds.right) bounds.right = right;
+        if (bottom > bounds.bottom) bounds.bottom = bottom;
+    };
+
+    for (int beam = 0; beam < 2; ++ beam) {
+        if (beam == 0) {
+            beamShape (fleet, dial, fleet.actualElev [lamp], fleet.actualBrg [lamp], vertices, spot);
+        } else {
+            beamShape (fleet, dial, fleet.requestedElev [lamp], fleet.requestedBrg [lamp], vertices, spot);
+        }
+
+        for (int i = 0; i < 3; ++ i) include (vertices [i].x, vertices [i].y, vertices [i].x + 1, vertices [i].y + 1);
+
+        include (spot.left, spot.top, spot.right, spot.bottom);
+    }
+
+    // room for the outline however the backend centers it
+    return RenderRect { bounds.left - 2, bounds.top - 2, bounds.right + 2, bounds.bottom + 2 };
+}
+
+void drawDial (Renderer& renderer) {
+    DialGeometry dial (renderer.width (), renderer.height ());
+    RenderPaint const border { DISPLAY_MARKS, 3, DISPLAY_FACE };
+    RenderPaint const marks { DISPLAY_MARKS, 1, DISPLAY_MARKS };
+    RenderPaint const rings { DISPLAY_MARKS, 1, DISPLAY_FACE };
+    auto drawTick = [& dial, & renderer, & marks] (double angle) {
+        RenderPoint tick [4];
+        dial.project (angle, dial.centerX - 20, tick [0].x, tick [0].y);
+        dial.project (angle - 1.0, dial.centerX - 10, tick [1].x, tick [1].y);
+        dial.project (angle + 1.0, dial.centerX - 10, tick [2].x, tick [2].y);
+        tick [3].x = tick [0].x;
+        tick [3].y = tick [0].y;
+        renderer.polygon (tick, 4, marks);
+    };
+
+    renderer.fillRect (RenderRect { 0, 0, dial.width, dial.height }, DISPLAY_BACKGROUND);
+    renderer.ellipse (RenderRect { 2, 2, dial.width - 2, dial.height - 2 }, border);
+    for (auto i = 0; i < 360; i += 10) {
+        drawTick ((double) (i));
+    }
+
+    for (auto i = 4; i >= 1; -- i) {
+        auto radius = dial.zone * i;
+        renderer.ellipse (RenderRect { dial.centerX - radius, dial.centerY - radius, dial.centerX + radius, dial.centerY + radius }, rings);
+    }
+}
+
+void drawBeams (Renderer& renderer, const LampFleet& fleet, size_t lamp) {
+    DialGeometry dial (renderer.width (), renderer.height ());
+    auto drawBeam = [& renderer, & fleet, & dial] (double elevation, double brg, RenderColor color) {
+        RenderPoint beamVertices [4];
+        RenderRect spot;
+        RenderPaint paint { color, 1, color };
+        beamShape (fleet, dial, elevation, brg, beamVertices, spot);
+        renderer.polygon (beamVertices, 4, paint);
+        renderer.ellipse (spot, paint);
+    };
+
+    drawBeam (fleet.actualElev [lamp], fleet.actualBrg [lamp], DISPLAY_ACTUAL_BEAM);
+    drawBeam (fleet.requestedElev [lamp], fleet.requestedBrg [lamp], DISPLAY_REQUESTED_BEAM);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include "render.h"
+#include "fleet.h"
+
+static RenderColor const DISPLAY_BACKGROUND = { 200, 200, 200 };
+static RenderColor const DISPLAY_FACE = { 100, 100, 100 };
+static RenderColor const DISPLAY_MARKS = { 0, 0, 0 };
+static RenderColor const DISPLAY_ACTUAL_BEAM = { 255, 200, 0 };
+static RenderColor const DISPLAY_REQUESTED_BEAM = { 200, 150, 0 };
+
+static double const MAX_BEAM_RADIUS = 1048576.0;     // pixels; beams are cut to this, far inside GDI's 2^27 limit
+
+// Where things go on a display of the given size
+struct DialGeometry {
+    long width, height;
+    long centerX, centerY, zone;
+
+    DialGeometry (long _width, long _height): width (_width), height (_height), centerX (_width >> 1), centerY (_height >> 1), zone (((_width >> 1) - 30) / 4) {}
+
+    void project (double angle, double radius, long& x, long& y) const;
+};
+
+// Beam polygon (closed, so 4 points) and the rectangle of the spot at its end
+void beamShape (const LampFleet& fleet, const DialGeometry& dial, double elevation, double brg, RenderPoint *vertices, RenderRect& spot);
+
+// Everything both beams of the lamp touch, outlines included
+RenderRect beamBounds (const LampFleet& fleet, size_t lamp, const DialGeometry& dial);
+
+// The face, ticks and range rings; nothing there depends on the lamps, so it only changes with the size
+void drawDial (Renderer& renderer);
+
+// Actual and requested beams of the lamp on top of the dial
+void drawBeams (Renderer& renderer, const LampFleet& fleet, size_t lamp);
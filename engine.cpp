@@ -0,0 +1,63 @@
+#include <math.h>
+#include <chrono>
+#include "engine.h"
+
+uint64_t SteadyClock::now () {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+MotionEngine::MotionEngine (LampFleet& _fleet, Clock *_clock, uint64_t _slewInterval):
+    fleet (_fleet),
+    clock (_clock ? _clock : & defaultClock),
+    slewInterval (_slewInterval > 0 ? _slewInterval : DEFAULT_SLEW_INTERVAL_NS),
+    instantMode (false) {
+    reset ();
+}
+
+void MotionEngine::setClock (Clock *_clock) {
+    clock = _clock ? _clock : & defaultClock;
+    started = false;
+}
+
+void MotionEngine::reset () {
+    pending = simTime = lastUpdate = steps = 0;
+    started = false;
+}
+
+size_t MotionEngine::step (uint64_t dtNs) {
+    size_t moved = 0;
+
+    simTime += dtNs;
+
+    if (instantMode) {
+        pending = 0;
+
+        return fleet.snapToRequested ();
+    }
+
+    for (pending += dtNs; pending >= slewInterval; pending -= slewInterval) {
+        moved += fleet.step ();
+        ++ steps;
+    }
+
+    return moved;
+}
+
+size_t MotionEngine::step (double dtSec) {
+    return dtSec > 0.0 ? step ((uint64_t) llround (dtSec * (double) NS_PER_SEC)) : 0;
+}
+
+size_t MotionEngine::update () {
+    uint64_t now = clock->now ();
+
+    if (!started) {
+        started = true;
+        lastUpdate = now;
+    }
+
+    uint64_t elapsed = now > lastUpdate ? now - lastUpdate : 0;
+
+    lastUpdate = now;
+
+    return step (elapsed);
+}
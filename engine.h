@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "fleet.h"
+
+static uint64_t const NS_PER_SEC = 1000000000ull;
+static uint64_t const DEFAULT_SLEW_INTERVAL_NS = NS_PER_SEC / 4;
+
+// Monotonic time source, nanoseconds from an arbitrary origin
+struct Clock {
+    virtual ~Clock () {}
+    virtual uint64_t now () = 0;
+};
+
+struct SteadyClock: Clock {
+    virtual uint64_t now ();
+};
+
+// Time only moves when told to; lets tests and batch runs go faster than real time
+struct ManualClock: Clock {
+    uint64_t time;
+
+    ManualClock (uint64_t start = 0): time (start) {}
+
+    virtual uint64_t now () { return time; }
+    void advance (uint64_t ns) { time += ns; }
+};
+
+// Lamp dynamics with a fixed timestep: one slew step of the fleet per slewInterval of simulated time,
+// whoever drives it (window timer, daemon loop, batch runner) and however irregularly.
+struct MotionEngine {
+    LampFleet& fleet;
+    SteadyClock defaultClock;
+    Clock *clock;
+    uint64_t slewInterval;      // ns of simulated time per slew step
+    uint64_t pending;           // simulated time not consumed by a slew step yet
+    uint64_t simTime;
+    uint64_t lastUpdate;
+    uint64_t steps;
+    bool instantMode;
+    bool started;
+
+    MotionEngine (LampFleet& _fleet, Clock *_clock = 0, uint64_t _slewInterval = DEFAULT_SLEW_INTERVAL_NS);
+
+    void setClock (Clock *_clock);
+    void reset ();
+
+    // Advances simulated time by dt; returns number of lamp moves made (a lamp moving in two steps counts twice)
+    size_t step (uint64_t dtNs);
+    size_t step (double dtSec);
+
+    // Advances simulated time by whatever the clock says has passed since the previous call
+    size_t update ();
+};
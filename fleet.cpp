@@ -0,0 +1,106 @@
+#include <math.h>
+#include "fleet.h"
+#include "geometry.h"
+#include "conversion.h"
+
+LampFleet::LampFleet (size_t count, double _mastHeight):
+    mastHeight (_mastHeight), kernel (detectMotionKernel ()), conversion (ConversionMode::FastConversion) {
+    resize (count);
+}
+
+void LampFleet::resize (size_t count, double brg, double elev, uint8_t focus) {
+    if (count < 1) count = 1;
+    if (count > MAX_LAMPS) count = MAX_LAMPS;
+
+    actualBrg.assign (count, brg);
+    actualElev.assign (count, elev);
+    requestedBrg.assign (count, brg);
+    requestedElev.assign (count, elev);
+    actualFocus.assign (count, focus);
+    requestedFocus.assign (count, focus);
+    status.assign (count, LampStatus::LampOK);
+}
+
+void LampFleet::apply (const LampCommand& command) {
+    if (!hasLamp (command.lampID)) return;
+
+    size_t index = indexOf (command.lampID);
+
+    requestedBrg [index] = command.brg;
+    requestedElev [index] = command.elev;
+    requestedFocus [index] = command.focus;
+}
+
+size_t LampFleet::snapToRequested () {
+    size_t moved = 0;
+
+    for (size_t i = 0; i < size (); ++ i) {
+        if (requestedBrg [i] != actualBrg [i] || requestedElev [i] != actualElev [i]) {
+            actualBrg [i] = requestedBrg [i];
+            actualElev [i] = requestedElev [i];
+            ++ moved;
+        }
+    }
+
+    return moved;
+}
+
+size_t LampFleet::step () {
+    return stepLamps (kernel, conversion, mastHeight, actualBrg.data (), actualElev.data (), requestedBrg.data (), requestedElev.data (), size ());
+}
+
+bool stepLamp (double mastHeight, double& actualBrg, double& actualElev, double requestedBrg, double requestedElev, ConversionMode conversion) {
+    bool changed = false;
+
+    if (requestedBrg != actualBrg) {
+        changed = true;
+        auto delta1 = requestedBrg - actualBrg;
+
+        if (delta1 < 0.0) delta1 += 360.0;
+
+        auto delta2 = 360.0 - delta1;
+
+        double delta, sign;
+
+        if (delta1 > delta2) {
+            delta = delta2;
+            sign = -1.0;
+        } else {
+            delta = delta1;
+            sign = 1.0;
+        }
+
+        if (delta > 50.0) {
+            delta = 10.0;
+        } else if (delta > 25.0) {
+            delta = 5.0;
+        } else if (delta > 5.0) {
+            delta = 1.0;
+        }
+
+        actualBrg += delta * sign;
+        if (actualBrg < 0.0) actualBrg += 360.0;
+        if (actualBrg > 360.0) actualBrg -= 360.0;
+    }
+    if (requestedElev != actualElev) {
+        changed = true;
+        double requestedRng = convertElevation2range (conversion, mastHeight, requestedElev);
+        double actualRng = convertElevation2range (conversion, mastHeight, actualElev);
+        auto delta = requestedRng - actualRng;
+        auto absDelta = fabs (delta);
+        auto sign = delta >= 0 ? 1.0 : -1.0;
+
+        if (absDelta > 500.0) {
+            absDelta = 100.0;
+        } else if (absDelta > 100.0) {
+            absDelta = 10.0;
+        } else if (absDelta > 20.0) {
+            absDelta = 2.0;
+        }
+
+        actualRng += absDelta * sign;
+        actualElev = landedOnRange (requestedRng, actualRng) ? requestedElev : convertRange2elevation (conversion, mastHeight, actualRng);
+    }
+
+    return changed;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <math.h>
+#include "lamp.h"
+#include "motion.h"
+
+static size_t const MAX_LAMPS = 1024;
+
+// State of every simulated lamp on the bus, stored as structure-of-arrays so that a tick walks contiguous
+// memory. Lamp IDs are 1-based on the wire; lamp N lives at index N - 1 in every array.
+struct LampFleet {
+    double mastHeight;
+    MotionKernel kernel;
+    ConversionMode conversion;
+    std::vector<double> actualBrg;
+    std::vector<double> actualElev;
+    std::vector<double> requestedBrg;
+    std::vector<double> requestedElev;
+    std::vector<uint8_t> actualFocus;
+    std::vector<uint8_t> requestedFocus;
+    std::vector<uint32_t> status;
+
+    LampFleet (size_t count = 1, double _mastHeight = 10.0);
+
+    // Resets every lamp to the given position, existing state is lost
+    void resize (size_t count, double brg = 0.0, double elev = 0.25, uint8_t focus = 99);
+
+    inline size_t size () const { return actualBrg.size (); }
+    inline bool hasLamp (int lampID) const { return lampID >= 1 && (size_t) lampID <= size (); }
+    inline size_t indexOf (int lampID) const { return (size_t) (lampID - 1); }
+
+    void apply (const LampCommand& command);
+
+    // Jumps every lamp straight to its requested position; returns number of lamps which moved
+    size_t snapToRequested ();
+
+    // Makes one slew step for every lamp; returns number of lamps which moved
+    size_t step ();
+};
+
+// Range error under which a lamp is taken to have arrived; far below the smallest 2 m slew step, so only the final jump
+// lands inside it. Arriving lamps get the requested elevation as is, since converting the range back to elevation
+// may miss it by an ulp and leave the lamp "moving" for ever.
+static double const RANGE_LANDING_DISTANCE = 0.001;
+
+inline bool landedOnRange (double requestedRng, double actualRng) {
+    return fabs (requestedRng - actualRng) < RANGE_LANDING_DISTANCE;
+}
+
+// Single step of the slew rules for one lamp; returns true if the lamp moved. The exact default keeps callers
+// outside the fleet on libm; the fleet passes its own conversion mode.
+bool stepLamp (
+    double mastHeight, double& actualBrg, double& actualElev, double requestedBrg, double requestedElev, ConversionMode conversion = ConversionMode::ExactConversion
+);
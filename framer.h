@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string.h>
+#include "nmeascan.h"
+
+static size_t const FRAMER_RING_SIZE = 4096;    // must be a power of two
+static size_t const MAX_SENTENCE_SIZE = 256;
+static size_t const FRAMER_SCAN_WINDOW = 512;   // bytes run through the delimiter scan at a time
+
+// Cuts a raw serial byte stream into "$...\r\n" sentences. Bytes are kept in a ring buffer between reads,
+// so a sentence split across several reads is reassembled, and several sentences in one read are all delivered.
+// The delimiter scan which finds the sentences keeps its masks and running XOR next to the ring, block for block,
+// and hands them over with each sentence so that the tokenizer does not go over the bytes again.
+struct SentenceFramer {
+    char ring [FRAMER_RING_SIZE];
+    char scratch [MAX_SENTENCE_SIZE];
+    ScanBlock blocks [FRAMER_RING_SIZE / SCAN_BLOCK_SIZE];
+    uint8_t prefixXor [FRAMER_RING_SIZE];   // running XOR from the start of the ring
+    uint64_t head;          // total bytes written into the ring
+    uint64_t tail;          // first byte not consumed yet
+    uint64_t scan;          // next byte to examine
+    bool inSentence;
+    bool discarding;
+    uint64_t sentences;
+    uint64_t droppedBytes;
+    uint64_t resyncs;
+    ScanKernel kernel;
+
+    SentenceFramer (): kernel (defaultScanKernel ()) {
+        reset ();
+    }
+
+    void reset () {
+        head = tail = scan = 0;
+        inSentence = discarding = false;
+        sentences = droppedBytes = resyncs = 0;
+    }
+
+    // cb (const char *sentence, size_t size, const SentenceScan *scan) is called for every complete sentence, CR/LF
+    // stripped; scan is 0 for a sentence which wraps around the end of the ring and had to be put together
+    template<typename Cb> void feed (const char *data, size_t size, Cb cb) {
+        while (size > 0) {
+            // the block tail is in gets scanned again as a whole, so none of it may be overwritten yet
+            size_t space = FRAMER_RING_SIZE - (size_t) (head - (tail & ~(uint64_t) (SCAN_BLOCK_SIZE - 1)));
+            size_t chunk = size < space ? size : space;
+            size_t start = (size_t) (head & (FRAMER_RING_SIZE - 1));
+            size_t firstPart = FRAMER_RING_SIZE - start;
+
+            if (firstPart > chunk) firstPart = chunk;
+
+            memcpy (ring + start, data, firstPart);
+            memcpy (ring, data + firstPart, chunk - firstPart);
+
+            head += chunk;
+            data += chunk;
+            size -= chunk;
+
+            process (cb);
+        }
+    }
+
+    void discard (uint64_t upTo) {
+        if (upTo > tail) {
+            droppedBytes += upTo - tail;
+
+            if (!discarding) {
+                discarding = true;
+                ++ resyncs;
+            }
+        }
+
+        tail = upTo;
+    }
+
+    template<typename Cb> void deliver (Cb cb) {
+        size_t size = (size_t) (scan - tail);
+        size_t start = (size_t) (tail & (FRAMER_RING_SIZE - 1));
+
+        if (size > 0 && ring [(start + size - 1) & (FRAMER_RING_SIZE - 1)] == '\r') -- size;
+
+        ++ sentences;
+
+        if (start + size <= FRAMER_RING_SIZE) {
+            SentenceScan const scanned { ring, blocks, prefixXor };
+
+            cb ((const char *) ring + start, size, & scanned);
+        } else {
+            size_t firstPart = FRAMER_RING_SIZE - start;
+
+            memcpy (scratch, ring + start, firstPart);
+            memcpy (scratch + firstPart, ring, size - firstPart);
+            cb ((const char *) scratch, size, (const SentenceScan *) 0);
+        }
+    }
+
+    // Takes the bytes before upTo, none of them '$' or LF: dropped outside a sentence, and a sentence running past
+    // MAX_SENTENCE_SIZE is dropped at the byte which makes it too long
+    void skipTo (uint64_t upTo) {
+        if (inSentence && upTo >= tail + MAX_SENTENCE_SIZE) {
+            inSentence = false;
+            discard (tail + MAX_SENTENCE_SIZE);
+        }
+
+        if (!inSentence && upTo > tail) discard (upTo);
+
+        scan = upTo;
+    }
+
+    template<typename Cb> void process (Cb cb) {
+        // only the '$' and LF positions matter, so the scan lets us jump straight from one to the next
+        while (scan < head) {
+            // whole blocks, so that masks and XOR line up with the ring; bytes before scan are only looked at again
+            uint64_t windowStart = scan & ~(uint64_t) (SCAN_BLOCK_SIZE - 1);
+            size_t start = (size_t) (windowStart & (FRAMER_RING_SIZE - 1));
+            size_t size = (size_t) (head - windowStart);
+
+            if (size > FRAMER_RING_SIZE - start) size = FRAMER_RING_SIZE - start;
+            if (size > FRAMER_SCAN_WINDOW) size = FRAMER_SCAN_WINDOW;
+
+            scanNmea (kernel, ring + start, size, blocks + start / SCAN_BLOCK_SIZE, prefixXor + start, start > 0 ? prefixXor [start - 1] : 0);
+
+            for (size_t blockStart = 0, i = start / SCAN_BLOCK_SIZE; blockStart < size; blockStart += SCAN_BLOCK_SIZE, ++ i) {
+                uint64_t events = blocks [i].dollars | blocks [i].lfs;
+
+                if (blockStart == 0) events &= ~0ull << (scan - windowStart);
+
+                for (; events; events &= events - 1) {
+                    uint64_t pos = windowStart + blockStart + lowestSetBit (events);
+
+                    skipTo (pos);
+
+                    if (ring [start + (size_t) (pos - windowStart)] == '$') {
+                        // either the start we were waiting for, or a new start before the previous sentence was terminated
+                        discard (pos);
+                        discarding = false;
+                        inSentence = true;
+                    } else if (inSentence) {
+                        deliver (cb);
+                        tail = pos + 1;
+                        inSentence = false;
+                    } else {
+                        discard (pos + 1);
+                    }
+
+                    scan = pos + 1;
+                }
+            }
+
+            skipTo (windowStart + size);
+        }
+    }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <math.h>
+
+const double PI = 3.1415926535897932384626433832795;
+const double TWO_PI = PI + PI;
+const double TO_RAD = PI / 180.0;
+const double TO_DEG = 180.0 / PI;
+
+inline double toDeg (double val) { return val * TO_DEG; }
+inline double toRad (double val) { return val * TO_RAD; }
+
+inline double elevation2range (double mastHeight, double elevation) {
+    return mastHeight / tan (elevation * TO_RAD);
+}
+
+inline double range2elevation (double mastHeight, double range) {
+    return atan (mastHeight / range) * TO_DEG;
+}
@@ -0,0 +1,47 @@
+#include "histogram.h"
+
+LatencyHistogram::LatencyHistogram (): counts (new std::atomic<uint64_t> [HISTOGRAM_NUM_OF_BUCKETS]), total (0), sum (0), min (UINT64_MAX), max (0) {
+    for (size_t i = 0; i < HISTOGRAM_NUM_OF_BUCKETS; ++ i) counts [i].store (0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketLimit (size_t bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return (uint64_t) bucket;
+
+    size_t offset = bucket - HISTOGRAM_SUB_BUCKETS;
+    unsigned shift = (unsigned) (offset / HISTOGRAM_HALF_BUCKETS) + 1;
+    uint64_t subBucket = HISTOGRAM_HALF_BUCKETS + offset % HISTOGRAM_HALF_BUCKETS;
+
+    return ((subBucket + 1) << shift) - 1;
+}
+
+double LatencyHistogram::mean () const {
+    uint64_t numOfValues = count ();
+
+    return numOfValues > 0 ? (double) sum.load (std::memory_order_relaxed) / (double) numOfValues : 0.0;
+}
+
+uint64_t LatencyHistogram::percentile (double fraction) const {
+    uint64_t numOfValues = count ();
+
+    if (numOfValues == 0) return 0;
+
+    // rank of the value wanted, counting from 1
+    uint64_t rank = (uint64_t) (fraction * (double) numOfValues + 0.5);
+    uint64_t seen = 0;
+
+    if (rank < 1) rank = 1;
+    if (rank > numOfValues) rank = numOfValues;
+
+    for (size_t i = 0; i < HISTOGRAM_NUM_OF_BUCKETS; ++ i) {
+        seen += counts [i].load (std::memory_order_relaxed);
+
+        if (seen >= rank) {
+            uint64_t limit = bucketLimit (i);
+            uint64_t largest = max.load (std::memory_order_relaxed);
+
+            return limit < largest ? limit : largest;
+        }
+    }
+
+    return max.load (std::memory_order_relaxed);
+}
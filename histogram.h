@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Log-linear (HDR) histogram of nanosecond values: exact below 256 ns, then 128 buckets per power of two,
+// so any value is known to within 0.8% up to HISTOGRAM_MAX_VALUE (about 18 minutes); larger ones are clamped.
+static uint32_t const HISTOGRAM_SUB_BUCKET_BITS = 8;
+static uint32_t const HISTOGRAM_SUB_BUCKETS = 1u << HISTOGRAM_SUB_BUCKET_BITS;
+static uint32_t const HISTOGRAM_HALF_BUCKETS = HISTOGRAM_SUB_BUCKETS / 2;
+static uint32_t const HISTOGRAM_MAX_BITS = 40;
+static uint64_t const HISTOGRAM_MAX_VALUE = (1ull << HISTOGRAM_MAX_BITS) - 1;
+static size_t const HISTOGRAM_NUM_OF_BUCKETS = HISTOGRAM_SUB_BUCKETS + (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_HALF_BUCKETS;
+
+inline unsigned highestSetBit (uint64_t value) {
+#if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_ARM64))
+    unsigned long index;
+
+    _BitScanReverse64 (& index, value);
+
+    return (unsigned) index;
+#elif defined (_MSC_VER)
+    unsigned long index;
+
+    if (_BitScanReverse (& index, (unsigned long) (value >> 32))) return (unsigned) index + 32;
+
+    _BitScanReverse (& index, (unsigned long) value);
+
+    return (unsigned) index;
+#else
+    return 63u - (unsigned) __builtin_clzll (value);
+#endif
+}
+
+// One thread records, any thread may read; recording is a handful of relaxed loads and stores, no lock and no
+// read-modify-write. A reader running alongside may see a count or two not yet reflected in the total.
+struct LatencyHistogram {
+    std::unique_ptr<std::atomic<uint64_t> []> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+
+    LatencyHistogram ();
+
+    static size_t bucketOf (uint64_t value) {
+        if (value < HISTOGRAM_SUB_BUCKETS) return (size_t) value;
+        if (value > HISTOGRAM_MAX_VALUE) value = HISTOGRAM_MAX_VALUE;
+
+        unsigned shift = highestSetBit (value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+
+        return HISTOGRAM_SUB_BUCKETS + (shift - 1) * HISTOGRAM_HALF_BUCKETS + (size_t) ((value >> shift) - HISTOGRAM_HALF_BUCKETS);
+    }
+
+    // Largest value which falls into the bucket
+    static uint64_t bucketLimit (size_t bucket);
+
+    void record (uint64_t value) {
+        auto& count = counts [bucketOf (value)];
+
+        count.store (count.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum.store (sum.load (std::memory_order_relaxed) + value, std::memory_order_relaxed);
+
+        if (value < min.load (std::memory_order_relaxed)) min.store (value, std::memory_order_relaxed);
+        if (value > max.load (std::memory_order_relaxed)) max.store (value, std::memory_order_relaxed);
+
+        total.store (total.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint64_t count () const { return total.load (std::memory_order_acquire); }
+    double mean () const;
+
+    // Value below which the given fraction (0.5, 0.99, 0.999...) of the recorded ones lie; 0 when empty
+    uint64_t percentile (double fraction) const;
+};
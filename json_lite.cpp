@@ -68,28 +68,19 @@ json::node *json::extractLiteral (char *stream, int& offset) {
 json::node *json::extractNumber (char *stream, int& offset) {
     if (!isdigit (stream [offset]) && stream [offset] != '-') return 0;
 
-    std::string extraction;
-    bool dotPassed = false;
-    auto start= offset;
+    const char *begin = stream + offset;
+    const char *end = begin;
 
-    if (stream [offset] == '-') {
-        extraction += '-';
-        start ++;
-    }
+    while (isdigit (*end) || *end == '-' || *end == '+' || *end == '.' || *end == 'e' || *end == 'E') ++ end;
 
-    for (auto i = start; isdigit (stream [i]) || stream [i] == '.'; ++ i) {
-        if (stream [i] == '.') {
-            if (dotPassed) return 0;
+    double value;
+    const char *numberEnd = parseDouble (begin, end, value);
 
-            dotPassed = true;
-        }
-
-        extraction += stream [i];
-    }
+    if (numberEnd == begin) return 0;
 
-    offset += (int) extraction.length ();
+    offset += (int) (numberEnd - begin);
 
-    return new numberNode (extraction.c_str ());
+    return new numberNode (value);
 }
 
 json::node *json::extractBoolean (char *stream, int& offset) {
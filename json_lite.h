@@ -1,9 +1,14 @@
 #pragma once
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
 #include <string>
 #include <vector>
 #include <map>
+#include "numparse.h"
 #include <string>
 
 #ifdef __linux__
@@ -82,38 +87,9 @@ namespace json {
     struct numberNode: node {
         double value;
 
-        // redone atof version independent on the locale settings
+        // locale independent atof; a comma is taken as the decimal point too
         static double char2dbl (const char *src) {
-            uint32_t integral = 0;
-            uint32_t fractal = 0;
-            uint32_t fractalDivider = 1;
-            bool negative = false;
-            bool sepFound = false;
-            bool nonBlankFound = false;
-            for (; *src; ++ src) {
-                if (*src == '-') {
-                    if (negative) break; // second minus found
-                    nonBlankFound = true;
-                    negative = true;
-                } else if (*src == ' ' || *src == '\t') {
-                    if (nonBlankFound) break; // an unexpected char found
-                    continue;
-                } else if (*src == ',' || *src == '.') {
-                    if (sepFound) break; // second decimal point or comma found
-                    sepFound = true;
-                } else if (isdigit (*src)) {
-                    if (sepFound) {
-                        fractal = fractal * 10 + *src - '0';
-                        fractalDivider *= 10;
-                    } else {
-                        integral = integral * 10 + *src - '0';
-                    }
-                } else {
-                    break; // non-number char found (neither minus nor dot, comma or digit)
-                }
-            }
-            double result = (double) integral + (double) fractal / (double) fractalDivider;
-            return negative ? - result : result;
+            return toDouble (src, src + strlen (src), NumberFlags::NumberSkipBlanks | NumberFlags::NumberAcceptComma);
         }
 
         numberNode (): node (nodeType::number) {}
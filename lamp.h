@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+static double const MAX_RANGE = 2.0 * 1852.0;
+
+enum LampStatus
+{
+    LampOK         = 0,
+    AzimuthFault   = 1,
+    ElevationFault = 2,
+    FocusFault     = 4,
+    TempSensorFail = 8,
+    Daylight       = 16,
+    PowerLoss      = 32,
+    NoLampFound    = 0x80
+};
+
+// Position/focus request received from a control unit for one lamp
+struct LampCommand {
+    uint16_t lampID;
+    uint8_t focus;
+    double brg;
+    double elev;
+};
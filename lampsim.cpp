@@ -9,27 +9,137 @@
 #include "resource.h"
 #include "editbox.h"
 #include "defs.h"
+#include "geometry.h"
+#include "numparse.h"
+#include "display.h"
 
-const double PI = 3.1415926535897932384626433832795;
-const double TWO_PI = PI + PI;
-const double TO_RAD = PI / 180.0;
-const double TO_DEG = 180.0 / PI;
 char const *CLS_NAME = "lampSimWin";
 char const *DISPLAY_CLS_NAME = "lampSimDispWin";
 
-inline double toDeg (double val) { return val * TO_DEG; }
-inline double toRad (double val) { return val * TO_RAD; }
+bool queryExit (HWND wnd) {
+    return MessageBox (wnd, "Do you want to quit the application?", "Confirmation", MB_YESNO | MB_ICONQUESTION) == IDYES;
+}
+
+bool chooseCaptureFile (HWND wnd, bool forSaving, char *path, size_t size) {
+    OPENFILENAME info;
 
-double elevation2range (double mastHeight, double elevation) {
-    return mastHeight / tan (elevation * TO_RAD);
+    memset (& info, 0, sizeof (info));
+    memset (path, 0, size);
+
+    info.lStructSize = sizeof (info);
+    info.hwndOwner = wnd;
+    info.lpstrFilter = "Captures (*.cap)\0*.cap\0All files\0*.*\0";
+    info.lpstrFile = path;
+    info.nMaxFile = (DWORD) size;
+    info.lpstrDefExt = "cap";
+    info.Flags = forSaving ? OFN_OVERWRITEPROMPT | OFN_PATHMUSTEXIST : OFN_FILEMUSTEXIST;
+
+    return forSaving ? GetSaveFileName (& info) != 0 : GetOpenFileName (& info) != 0;
 }
 
-double range2elevation (double mastHeight, double range) {
-    return atan (mastHeight / range) * TO_DEG;
+void toggleCapture (HWND wnd, Ctx *ctx) {
+    HMENU menu = GetMenu (wnd);
+    char path [MAX_PATH], message [MAX_PATH + 50];
+
+    if (ctx->capture.isActive ()) {
+        sprintf (message, "Capture stopped, %llu chunks", (unsigned long long) ctx->capture.records.load ());
+        ctx->capture.stop ();
+        ModifyMenu (menu, ID_CAPTURE, MF_BYCOMMAND | MF_STRING, ID_CAPTURE, "Start &capture...");
+        addToConsole (message, ctx);
+    } else if (chooseCaptureFile (wnd, true, path, sizeof (path))) {
+        if (ctx->capture.start (path)) {
+            sprintf (message, "Capturing to %s", path);
+            ModifyMenu (menu, ID_CAPTURE, MF_BYCOMMAND | MF_STRING, ID_CAPTURE, "Stop &capture");
+        } else {
+            sprintf (message, "Unable to create %s", path);
+        }
+
+        addToConsole (message, ctx);
+    }
 }
 
-bool queryExit (HWND wnd) {
-    return MessageBox (wnd, "Do you want to quit the application?", "Confirmation", MB_YESNO | MB_ICONQUESTION) == IDYES;
+void dumpLatency (Ctx *ctx) {
+    char line [200];
+
+    for (int i = 0; i < LatencyStage::NUM_OF_LATENCY_STAGES; ++ i) {
+        ctx->latency.format ((LatencyStage) i, line, sizeof (line));
+        addToConsole (line, ctx);
+    }
+
+    DisplayBuffers& buffers = ctx->displayBuffers;
+
+    sprintf (
+        line,
+        "%-16s %llu lines, %llu dropped, %zu retained",
+        "console",
+        (unsigned long long) ctx->log.appended.load (),
+        (unsigned long long) ctx->log.dropped.load (),
+        ctx->log.size ()
+    );
+    addToConsole (line, ctx);
+
+    if (buffers.frames > 0) {
+        sprintf (
+            line,
+            "%-16s n=%llu mean=%.1f max=%.1f us",
+            "paint",
+            (unsigned long long) buffers.frames,
+            (double) buffers.totalPaintNs / (double) buffers.frames / 1000.0,
+            (double) buffers.maxPaintNs / 1000.0
+        );
+        addToConsole (line, ctx);
+    }
+}
+
+// A window app has no stdout, so the report on exit goes to lampsim-latency.txt beside the executable,
+// and to the debugger output as well
+void writeLatencyReport (Ctx *ctx) {
+    char path [MAX_PATH + 20], line [200];
+    DWORD size = GetModuleFileName (0, path, MAX_PATH);
+
+    if (size == 0 || size >= MAX_PATH) return;
+
+    char *extension = strrchr (path, '.');
+
+    strcpy (extension && !strchr (extension, '\\') ? extension : path + size, "-latency.txt");
+
+    FILE *report = fopen (path, "w");
+
+    if (report) {
+        ctx->latency.dump (report);
+        fclose (report);
+    }
+
+    for (int i = 0; i < LatencyStage::NUM_OF_LATENCY_STAGES; ++ i) {
+        ctx->latency.format ((LatencyStage) i, line, sizeof (line));
+        strcat (line, "\n");
+        OutputDebugString (line);
+    }
+}
+
+void startReplay (HWND wnd, Ctx *ctx) {
+    char path [MAX_PATH], speedText [50], message [MAX_PATH + 50];
+
+    if (!chooseCaptureFile (wnd, false, path, sizeof (path))) return;
+    if (!editText (wnd, ctx->instance, (char *) "Replay", (char *) "Speed: 1 real time, 10 ten times faster, 0 as fast as possible", speedText, sizeof (speedText), (char *) "1")) return;
+
+    double speed = toDouble (speedText, speedText + strlen (speedText), NumberFlags::NumberSkipBlanks | NumberFlags::NumberAcceptComma);
+
+    if (ctx->link.isOpen ()) closePort (ctx);
+
+    if (openReplay (ctx, path, speed)) {
+        sprintf (message, "Replaying %s", path);
+        SetWindowText (ctx->portCtlButton, "Close");
+        SendMessage (ctx->portCtlButton, BM_SETCHECK, BST_CHECKED, 0);
+        EnableWindow (ctx->portSelector, 0);
+    } else {
+        sprintf (message, "%s is not a capture", path);
+        SetWindowText (ctx->portCtlButton, "Open");
+        SendMessage (ctx->portCtlButton, BM_SETCHECK, BST_UNCHECKED, 0);
+        EnableWindow (ctx->portSelector, 1);
+    }
+
+    addToConsole (message, ctx);
 }
 
 void initDisplay (HWND wnd, void *data) {
@@ -40,14 +150,53 @@ void initDisplay (HWND wnd, void *data) {
 
 double getDoubleValue (HWND wnd) {
     char buffer [100];
-    GetWindowText (wnd, buffer, sizeof (buffer));
-    return atof (buffer);
+    int size = GetWindowText (wnd, buffer, sizeof (buffer));
+    return toDouble (buffer, buffer + size, NumberFlags::NumberSkipBlanks | NumberFlags::NumberAcceptComma);
 }
 
-char *ftoa (double val, const char *fmt = "%05.1f") {
-    static char buffer [100];
-    sprintf (buffer, fmt, val);
-    return buffer;
+void bindControls (Ctx *ctx) {
+    ControlBindings& bindings = ctx->bindings;
+    LampFleet& fleet = ctx->fleet;
+    auto protect = [ctx] (CtlProtectFlags flag) {
+        return [ctx, flag] () { ctx->protect (flag); };
+    };
+    auto hasStatus = [ctx] (uint32_t mask) {
+        return [ctx, mask] () { return (ctx->fleet.status [ctx->shownLamp] & mask) != 0; };
+    };
+
+    bindings.bindText (ctx->reqBrgValue, BoundSource::REQUESTED_POSITION, "%05.1f", [ctx] () { return ctx->fleet.requestedBrg [ctx->shownLamp]; }, protect (CtlProtectFlags::REQ_BRG));
+    bindings.bindText (ctx->reqElevValue, BoundSource::REQUESTED_POSITION, "%.3f", [ctx] () { return ctx->fleet.requestedElev [ctx->shownLamp]; }, protect (CtlProtectFlags::REQ_ELEV));
+    bindings.bindText (ctx->actBrgValue, BoundSource::ACTUAL_POSITION, "%05.1f", [ctx] () { return ctx->fleet.actualBrg [ctx->shownLamp]; }, protect (CtlProtectFlags::ACT_BRG));
+    bindings.bindText (ctx->actElevValue, BoundSource::ACTUAL_POSITION, "%.3f", [ctx] () { return ctx->fleet.actualElev [ctx->shownLamp]; }, protect (CtlProtectFlags::ACT_ELEV));
+    bindings.bindText (ctx->reqRngValue, BoundSource::REQUESTED_POSITION, "%.1f", [ctx, &fleet] () {
+        return convertElevation2range (fleet.conversion, fleet.mastHeight, fleet.requestedElev [ctx->shownLamp]);
+    }, protect (CtlProtectFlags::REQ_RNG));
+    bindings.bindText (ctx->actRngValue, BoundSource::ACTUAL_POSITION, "%.1f", [ctx, &fleet] () {
+        return convertElevation2range (fleet.conversion, fleet.mastHeight, fleet.actualElev [ctx->shownLamp]);
+    }, protect (CtlProtectFlags::ACT_RNG));
+
+    // "Lamp Ok" stands for no fault; daylight is a condition, not a fault
+    bindings.bindCheck (ctx->lampOk, BoundSource::LAMP_STATUS, [ctx] () { return (ctx->fleet.status [ctx->shownLamp] & ~LampStatus::Daylight) == 0; });
+    bindings.bindCheck (ctx->azimuthFault, BoundSource::LAMP_STATUS, hasStatus (LampStatus::AzimuthFault));
+    bindings.bindCheck (ctx->elevationFault, BoundSource::LAMP_STATUS, hasStatus (LampStatus::ElevationFault));
+    bindings.bindCheck (ctx->focusFault, BoundSource::LAMP_STATUS, hasStatus (LampStatus::FocusFault));
+    bindings.bindCheck (ctx->tempSensorFail, BoundSource::LAMP_STATUS, hasStatus (LampStatus::TempSensorFail));
+    bindings.bindCheck (ctx->daylight, BoundSource::LAMP_STATUS, hasStatus (LampStatus::Daylight));
+    bindings.bindCheck (ctx->powerLoss, BoundSource::LAMP_STATUS, hasStatus (LampStatus::PowerLoss));
+}
+
+// A status toggle was clicked; the model changes here, the check boxes follow at the next refresh
+void toggleStatus (Ctx *ctx, HWND control, uint32_t mask) {
+    uint32_t& status = ctx->fleet.status [ctx->shownLamp];
+
+    if (SendMessage (control, BM_GETCHECK, 0, 0) == BST_CHECKED) {
+        status |= mask;
+    } else {
+        status &= ~mask;
+    }
+
+    ctx->bindings.changed (BoundSource::LAMP_STATUS);
+    ctx->bindings.refresh ();
 }
 
 void initWindow (HWND wnd, void *data) {
@@ -81,15 +230,15 @@ void initWindow (HWND wnd, void *data) {
     ctx->reqElevValueLbl = createControl ("STATIC", "Requested elevation", SS_SIMPLE, true, minSize + 30, 85, 150, 20, IDC_STATIC);
     ctx->actBrgValueLbl = createControl ("STATIC", "Actual bearing", SS_SIMPLE, true, minSize + 30, 125, 150, 20, IDC_STATIC);
     ctx->actElevValueLbl = createControl ("STATIC", "Actual elevation", SS_SIMPLE, true, minSize + 30, 155, 150, 20, IDC_STATIC);
-    ctx->reqBrgValue = createControl ("EDIT", ftoa (ctx->requestedBrg), WS_BORDER, true, minSize + 200, 40, 50, 20, IDC_REQ_BEARING);
-    ctx->reqElevValue = createControl ("EDIT", ftoa (ctx->requestedElev, "%.3f"), WS_BORDER, true, minSize + 200, 90, 50, 20, IDC_REQ_ELEVATION);
-    ctx->actBrgValue = createControl ("EDIT", ftoa (ctx->actualBrg), WS_BORDER | ES_READONLY, true, minSize + 200, 120, 50, 20, IDC_ACT_BEARING);
-    ctx->actElevValue = createControl ("EDIT", ftoa (ctx->actualElev, "%.3f"), WS_BORDER | ES_READONLY, true, minSize + 200, 150, 50, 20, IDC_ACT_ELEVATION);
-    ctx->actRngValue = createControl ("EDIT", ftoa (elevation2range (ctx->mastHeight, ctx->actualElev), "%.1f"), WS_BORDER | ES_READONLY, true, minSize + 200, 200, 50, 20, IDC_ACT_RANGE);
+    ctx->reqBrgValue = createControl ("EDIT", "", WS_BORDER, true, minSize + 200, 40, 50, 20, IDC_REQ_BEARING);
+    ctx->reqElevValue = createControl ("EDIT", "", WS_BORDER, true, minSize + 200, 90, 50, 20, IDC_REQ_ELEVATION);
+    ctx->actBrgValue = createControl ("EDIT", "", WS_BORDER | ES_READONLY, true, minSize + 200, 120, 50, 20, IDC_ACT_BEARING);
+    ctx->actElevValue = createControl ("EDIT", "", WS_BORDER | ES_READONLY, true, minSize + 200, 150, 50, 20, IDC_ACT_ELEVATION);
+    ctx->actRngValue = createControl ("EDIT", "", WS_BORDER | ES_READONLY, true, minSize + 200, 200, 50, 20, IDC_ACT_RANGE);
     ctx->actRngValueLbl = createControl ("STATIC", "Actual range, m", SS_SIMPLE, true, minSize + 30, 205, 150, 20, IDC_STATIC);
-    ctx->reqRngValue = createControl ("EDIT", ftoa (elevation2range (ctx->mastHeight, ctx->requestedElev), "%.1f"), WS_BORDER, true, minSize + 200, 240, 50, 20, IDC_REQ_RANGE);
+    ctx->reqRngValue = createControl ("EDIT", "", WS_BORDER, true, minSize + 200, 240, 50, 20, IDC_REQ_RANGE);
     ctx->reqRngValueLbl = createControl ("STATIC", "Requested range, m", SS_SIMPLE, true, minSize + 30, 245, 150, 20, IDC_STATIC);
-    ctx->console = createControl ("LISTBOX", "", WS_VSCROLL | WS_BORDER, true, minSize + 30, 270, client.right - minSize - 40, client.bottom - 270, IDC_CONSOLE);
+    ctx->console = createControl (WC_LISTVIEW, "", LVS_REPORT | LVS_OWNERDATA | LVS_NOCOLUMNHEADER | LVS_SINGLESEL | WS_BORDER, true, minSize + 30, 270, client.right - minSize - 40, client.bottom - 270, IDC_CONSOLE);
     ctx->portCtlButton = createControl ("BUTTON", "Open", BS_AUTOCHECKBOX | BS_PUSHLIKE, true, minSize + 30, 5, 100, 20, IDC_TOGGLE_PORT);
     ctx->portSelector = createControl ("COMBOBOX", "Open", CBS_DROPDOWNLIST | CBS_AUTOHSCROLL, true, minSize + 160, 5, 100, 100, IDC_PORT);
     ctx->instantModeSwitch = createControl ("BUTTON", "Instant", BS_AUTOCHECKBOX | BS_PUSHLIKE, true, minSize + 270, 5, 80, 20, IDC_TOGGLE_INSTANT_MODE);
@@ -101,6 +250,13 @@ void initWindow (HWND wnd, void *data) {
     ctx->daylight = createControl ("BUTTON", "Daylight", BS_AUTOCHECKBOX | BS_PUSHLIKE, true, minSize + 230, 190, 120, 20, IDC_TOGGLE_DAYLIGHT);
     ctx->powerLoss = createControl ("BUTTON", "Power loss", BS_AUTOCHECKBOX | BS_PUSHLIKE, true, minSize + 230, 220, 120, 20, IDC_TOGGLE_POWER_LOSS);
 
+    LVCOLUMN column;
+    memset (& column, 0, sizeof (column));
+    column.mask = LVCF_WIDTH;
+    column.cx = client.right - minSize - 40;
+    SendMessage (ctx->console, LVM_INSERTCOLUMN, 0, (LPARAM) & column);
+    SendMessage (ctx->console, LVM_SETEXTENDEDLISTVIEWSTYLE, LVS_EX_FULLROWSELECT, LVS_EX_FULLROWSELECT);
+
     for (auto& port: ports) {
         auto item = SendMessage (ctx->portSelector, CB_ADDSTRING, 0, (LPARAM) port.c_str ());
         SendMessage (ctx->portSelector, CB_SETITEMDATA, item, std::atoi (port.c_str () + 3));
@@ -110,7 +266,8 @@ void initWindow (HWND wnd, void *data) {
         SendMessage (ctx->portSelector, CB_SETCURSEL, 0, 0);
     }
 
-    SendMessage(ctx->lampOk, BM_SETCHECK, BST_CHECKED, 0);
+    bindControls (ctx);
+    ctx->bindings.refresh ();
     SetTimer (wnd, 200, 250, 0);
 }
 
@@ -123,80 +280,103 @@ void doCommand (HWND wnd, uint16_t command, uint16_t notification) {
                 if (ctx->ctlProtectMask & CtlProtectFlags::REQ_BRG) {
                     ctx->unprotect (CtlProtectFlags::REQ_BRG);
                 } else if (GetWindowTextLength (ctx->reqBrgValue) > 0) {
-                    ctx->requestedBrg = getDoubleValue (ctx->reqBrgValue);
+                    ctx->fleet.requestedBrg [ctx->shownLamp] = getDoubleValue (ctx->reqBrgValue);
+                    ctx->bindings.accepted (ctx->reqBrgValue, ctx->fleet.requestedBrg [ctx->shownLamp]);
+                    ctx->bindings.changed (BoundSource::REQUESTED_POSITION);
                 }
                 break;
             case IDC_ACT_BEARING:
                 if (ctx->ctlProtectMask & CtlProtectFlags::ACT_BRG) {
                     ctx->unprotect (CtlProtectFlags::ACT_BRG);
                 } else if (GetWindowTextLength (ctx->actBrgValue) > 0) {
-                    ctx->actualBrg = getDoubleValue (ctx->actBrgValue);
+                    ctx->fleet.actualBrg [ctx->shownLamp] = getDoubleValue (ctx->actBrgValue);
+                    ctx->bindings.accepted (ctx->actBrgValue, ctx->fleet.actualBrg [ctx->shownLamp]);
+                    ctx->bindings.changed (BoundSource::ACTUAL_POSITION);
                 }
                 break;
             case IDC_REQ_ELEVATION:
                 if (ctx->ctlProtectMask & CtlProtectFlags::REQ_ELEV) {
                     ctx->unprotect (CtlProtectFlags::REQ_ELEV);
                 } else if (GetWindowTextLength (ctx->reqElevValue) > 0) {
-                    ctx->requestedElev = getDoubleValue (ctx->reqElevValue);
+                    ctx->fleet.requestedElev [ctx->shownLamp] = getDoubleValue (ctx->reqElevValue);
+                    ctx->bindings.accepted (ctx->reqElevValue, ctx->fleet.requestedElev [ctx->shownLamp]);
+                    ctx->bindings.changed (BoundSource::REQUESTED_POSITION);
                 }
                 break;
             case IDC_ACT_ELEVATION:
                 if (ctx->ctlProtectMask & CtlProtectFlags::ACT_ELEV) {
                     ctx->unprotect (CtlProtectFlags::ACT_ELEV);
                 } else if (GetWindowTextLength (ctx->actElevValue) > 0) {
-                    ctx->actualElev = getDoubleValue (ctx->actElevValue);
+                    ctx->fleet.actualElev [ctx->shownLamp] = getDoubleValue (ctx->actElevValue);
+                    ctx->bindings.accepted (ctx->actElevValue, ctx->fleet.actualElev [ctx->shownLamp]);
+                    ctx->bindings.changed (BoundSource::ACTUAL_POSITION);
                 }
                 break;
             case IDC_REQ_RANGE:
                 if (ctx->ctlProtectMask & CtlProtectFlags::REQ_RNG) {
                     ctx->unprotect (CtlProtectFlags::REQ_RNG);
                 } else if (GetWindowTextLength (ctx->reqRngValue) > 0) {
-                    ctx->requestedElev = range2elevation (ctx->mastHeight, getDoubleValue (ctx->reqRngValue));
+                    double range = getDoubleValue (ctx->reqRngValue);
+                    ctx->fleet.requestedElev [ctx->shownLamp] = convertRange2elevation (ctx->fleet.conversion, ctx->fleet.mastHeight, range);
+                    ctx->bindings.accepted (ctx->reqRngValue, range);
+                    ctx->bindings.changed (BoundSource::REQUESTED_POSITION);
                 }
                 break;
             case IDC_ACT_RANGE:
                 if (ctx->ctlProtectMask & CtlProtectFlags::ACT_RNG) {
                     ctx->unprotect (CtlProtectFlags::ACT_RNG);
                 } else if (GetWindowTextLength (ctx->reqRngValue) > 0) {
-                    ctx->actualElev = range2elevation (ctx->mastHeight, getDoubleValue (ctx->actRngValue));
+                    double range = getDoubleValue (ctx->actRngValue);
+                    ctx->fleet.actualElev [ctx->shownLamp] = convertRange2elevation (ctx->fleet.conversion, ctx->fleet.mastHeight, range);
+                    ctx->bindings.accepted (ctx->actRngValue, range);
+                    ctx->bindings.changed (BoundSource::ACTUAL_POSITION);
                 }
                 break;
         }
     } else {
         switch (command) {
             case IDC_TOGGLE_LAMP_OK:
-                SendMessage(ctx->azimuthFault, BM_SETCHECK, BST_UNCHECKED, 0);
-                SendMessage(ctx->elevationFault, BM_SETCHECK, BST_UNCHECKED, 0);
-                SendMessage(ctx->focusFault, BM_SETCHECK, BST_UNCHECKED, 0);
-                SendMessage(ctx->tempSensorFail, BM_SETCHECK, BST_UNCHECKED, 0);
-                SendMessage(ctx->powerLoss, BM_SETCHECK, BST_UNCHECKED, 0);
+                ctx->fleet.status [ctx->shownLamp] &= LampStatus::Daylight;
+                ctx->bindings.changed (BoundSource::LAMP_STATUS);
+                ctx->bindings.refresh ();
                 break;
             case IDC_TOGGLE_AZIMUTH_FAULT:
+                toggleStatus (ctx, ctx->azimuthFault, LampStatus::AzimuthFault); break;
             case IDC_TOGGLE_ELEVATION_FAULT:
+                toggleStatus (ctx, ctx->elevationFault, LampStatus::ElevationFault); break;
             case IDC_TOGGLE_FOCUS_FAULT:
+                toggleStatus (ctx, ctx->focusFault, LampStatus::FocusFault); break;
             case IDC_TOGGLE_TEMP_SENSOR_FAULT:
+                toggleStatus (ctx, ctx->tempSensorFail, LampStatus::TempSensorFail); break;
             case IDC_TOGGLE_DAYLIGHT:
+                toggleStatus (ctx, ctx->daylight, LampStatus::Daylight); break;
             case IDC_TOGGLE_POWER_LOSS:
-                SendMessage(ctx->lampOk, BM_SETCHECK, BST_UNCHECKED, 0); break;
+                toggleStatus (ctx, ctx->powerLoss, LampStatus::PowerLoss); break;
             case IDC_TOGGLE_INSTANT_MODE: {
-                ctx->instantMode = IsDlgButtonChecked (wnd, IDC_TOGGLE_INSTANT_MODE) == BST_CHECKED; break;
+                ctx->engine.instantMode = IsDlgButtonChecked (wnd, IDC_TOGGLE_INSTANT_MODE) == BST_CHECKED; break;
             }
             case IDC_TOGGLE_PORT: {
-                if (ctx->port == INVALID_HANDLE_VALUE) {
+                if (!ctx->link.isOpen ()) {
                     if (openPort (ctx)) {
                         SetWindowText (ctx->portCtlButton, "Close");
                         EnableWindow (ctx->portSelector, 0);
                     }
                 } else {
-                    if (ctx->locker) ctx->lock ();
                     SetWindowText (ctx->portCtlButton, "Open");
                     EnableWindow (ctx->portSelector, 1);
-                    CloseHandle (ctx->port);
-                    ctx->port = INVALID_HANDLE_VALUE;
-                    if (ctx->locker) ctx->unlock ();
+                    closePort (ctx);
                 }
                 break;
             }
+            case ID_CAPTURE: {
+                toggleCapture (wnd, ctx); break;
+            }
+            case ID_REPLAY: {
+                startReplay (wnd, ctx); break;
+            }
+            case ID_DUMP_LATENCY: {
+                dumpLatency (ctx); break;
+            }
             case ID_EXIT: {
                 if (queryExit (wnd)) DestroyWindow (wnd);
                 break;
@@ -205,73 +385,88 @@ void doCommand (HWND wnd, uint16_t command, uint16_t notification) {
     }
 }
 
+bool DisplayBuffers::fit (HDC target, long _width, long _height) {
+    if (dialCtx && width == _width && height == _height) return false;
+
+    release ();
+
+    width = _width;
+    height = _height;
+    dialCtx = CreateCompatibleDC (target);
+    frameCtx = CreateCompatibleDC (target);
+    dialBitmap = CreateCompatibleBitmap (target, width, height);
+    frameBitmap = CreateCompatibleBitmap (target, width, height);
+    dialDefault = SelectObject (dialCtx, dialBitmap);
+    frameDefault = SelectObject (frameCtx, frameBitmap);
+
+    return true;
+}
+
+void DisplayBuffers::release () {
+    if (dialCtx) {
+        SelectObject (dialCtx, dialDefault);
+        DeleteDC (dialCtx);
+    }
+    if (frameCtx) {
+        SelectObject (frameCtx, frameDefault);
+        DeleteDC (frameCtx);
+    }
+    if (dialBitmap) DeleteObject (dialBitmap);
+    if (frameBitmap) DeleteObject (frameBitmap);
+
+    dialCtx = frameCtx = 0;
+    dialBitmap = frameBitmap = 0;
+    width = height = 0;
+    SetRectEmpty (& beams);
+}
+
+RECT toRect (const RenderRect& rect) {
+    RECT result { rect.left, rect.top, rect.right, rect.bottom };
+
+    return result;
+}
+
+// Repaints only where the beams were and where they are now
+void invalidateBeams (Ctx *ctx) {
+    RECT client, area;
+    GetClientRect (ctx->display, & client);
+    RECT bounds = toRect (beamBounds (ctx->fleet, ctx->shownLamp, DialGeometry (client.right, client.bottom)));
+
+    UnionRect (& area, & bounds, & ctx->displayBuffers.beams);
+    InvalidateRect (ctx->display, & area, 0);
+}
+
 void paintDisplay (HWND wnd) {
     PAINTSTRUCT data;
     Ctx *ctx = (Ctx *) GetWindowLongPtr (wnd, GWLP_USERDATA);
     HDC paintCtx = BeginPaint (wnd, & data);
+    uint64_t startedAt = latencyNow ();
+    DisplayBuffers& buffers = ctx->displayBuffers;
     RECT client;
     GetClientRect (wnd, & client);
-    auto width = client.right + 1;
-    auto height = client.bottom + 1;
-    auto centerX = client.right >> 1;
-    auto centerY = client.bottom >> 1;
-    auto zone = (centerX - 30) / 4;
-    auto project = [centerX, centerY] (double angle, double radius, long& x, long &y) {
-        double angleRad = toRad (angle);
-        if (angleRad < 0.0) angleRad += TWO_PI;
-        if (angleRad >= TWO_PI) angleRad -= TWO_PI;
-        x = centerX + (long) (radius * sin (angleRad));
-        y = centerY - (long) (radius * cos (angleRad));
-    };
-    auto drawTick = [centerX, centerY, project, paintCtx] (double angle) {
-        POINT tick [4];
-        project (angle, centerX - 20, tick [0].x, tick [0].y);
-        project (angle - 1.0, centerX - 10, tick [1].x, tick [1].y);
-        project (angle + 1.0, centerX - 10, tick [2].x, tick [2].y);
-        tick [3].x = tick [0].x;
-        tick [3].y = tick [0].y;
-        Polygon (paintCtx, tick, 4);
-    };
+    const RECT& area = data.rcPaint;
+    auto areaWidth = area.right - area.left;
+    auto areaHeight = area.bottom - area.top;
 
-    FillRect (paintCtx, & client, ctx->wndBrush);
-    SelectObject (paintCtx, ctx->displayBrush);
-    SelectObject (paintCtx, ctx->borderPen);
-    Ellipse (paintCtx, client.left + 2, client.top + 2, client.right - 2, client.bottom - 2);
-    SelectObject (paintCtx, GetStockObject (BLACK_PEN));
-    SelectObject (paintCtx, GetStockObject (BLACK_BRUSH));
-    for (auto i = 0; i < 360; i += 10) {
-        drawTick ((double) (i));
+    if (buffers.fit (paintCtx, client.right, client.bottom)) {
+        buffers.renderer.attach (buffers.dialCtx, client.right, client.bottom);
+        drawDial (buffers.renderer);
     }
-    //Ellipse (paintCtx, centerX - 10, centerY - 10, centerX + 10, centerY + 10);
 
-    SelectObject (paintCtx, ctx->displayBrush);
-    for (auto i = 4; i >= 1; -- i) {
-        auto radius = zone * i;
-        Ellipse (paintCtx, centerX - radius, centerY - radius, centerX + radius, centerY + radius);
-    }
+    // the dial under the invalid area, then both beams (GDI clips them to the bitmap), then the area to the window
+    BitBlt (buffers.frameCtx, area.left, area.top, areaWidth, areaHeight, buffers.dialCtx, area.left, area.top, SRCCOPY);
+    buffers.renderer.attach (buffers.frameCtx, client.right, client.bottom);
+    drawBeams (buffers.renderer, ctx->fleet, ctx->shownLamp);
+    BitBlt (paintCtx, area.left, area.top, areaWidth, areaHeight, buffers.frameCtx, area.left, area.top, SRCCOPY);
+    EndPaint (wnd, & data);
 
-    auto drawBeam = [ctx, paintCtx, zone, centerX, centerY, project] (double elevation, double brg, HPEN pen, HBRUSH brush) {
-        POINT beamVertices [4];
-        auto range = elevation2range (ctx->mastHeight, elevation);
-        auto radius = range / MAX_RANGE * zone * 4.0;
-        long spotX, spotY;
-        long spotRadius = (long) (radius * sin (5.0 * TO_RAD));
-        project (brg - 5, radius, beamVertices [0].x, beamVertices [0].y);
-        project (brg + 5, radius, beamVertices [1].x, beamVertices [1].y);
-        project (brg, radius, spotX, spotY);
-        beamVertices [2].x = centerX;
-        beamVertices [2].y = centerY;
-        beamVertices [3].x = beamVertices [0].x;
-        beamVertices [3].y = beamVertices [0].y;
-        SelectObject (paintCtx, pen);
-        SelectObject (paintCtx, brush);
-        Polygon (paintCtx, beamVertices, 4);
-        Ellipse (paintCtx, spotX - spotRadius, spotY - spotRadius, spotX + spotRadius, spotY + spotRadius);
-    };
+    uint64_t paintNs = latencyNow () - startedAt;
 
-    drawBeam (ctx->actualElev, ctx->actualBrg, ctx->beamPen, ctx->beamBrush);
-    drawBeam (ctx->requestedElev, ctx->requestedBrg, ctx->beamPen2, ctx->beamBrush2);
-    EndPaint (wnd, & data);
+    buffers.beams = toRect (beamBounds (ctx->fleet, ctx->shownLamp, DialGeometry (client.right, client.bottom)));
+    buffers.totalPaintNs += paintNs;
+    ++ buffers.frames;
+
+    if (paintNs > buffers.maxPaintNs) buffers.maxPaintNs = paintNs;
 }
 
 void onSize (HWND wnd, int width, int height) {
@@ -296,6 +491,7 @@ void onSize (HWND wnd, int width, int height) {
     MoveWindow (ctx->portCtlButton, x1, 5, 100, 20, true);
     MoveWindow (ctx->portSelector, minSize + 160, 5, 100, 20, true);
     MoveWindow (ctx->console, x1, 270, width - minSize - 40, height - 270, true);
+    SendMessage (ctx->console, LVM_SETCOLUMNWIDTH, 0, LVSCW_AUTOSIZE_USEHEADER);
     MoveWindow (ctx->lampOk, x3, 40, 120, 20, true);
     MoveWindow (ctx->azimuthFault, x3, 70, 120, 20, true);
     MoveWindow (ctx->elevationFault, x3, 100, 120, 20, true);
@@ -305,113 +501,64 @@ void onSize (HWND wnd, int width, int height) {
     MoveWindow (ctx->powerLoss, x3, 220, 120, 20, true);
 }
 
-void updateWatchdog (HWND wnd) {
-    Ctx *ctx = (Ctx *) GetWindowLongPtr (wnd, GWLP_USERDATA);
-    clock_t now = clock ();
-    bool changed = false;
+// Moves what the threads logged since the last tick into the list; the list only learns the new line count
+// and asks for the text of the rows it actually shows
+void drainConsole (Ctx *ctx) {
+    size_t before = ctx->log.size ();
+    auto top = SendMessage (ctx->console, LVM_GETTOPINDEX, 0, 0);
+    auto perPage = SendMessage (ctx->console, LVM_GETCOUNTPERPAGE, 0, 0);
+    bool following = (size_t) (top + perPage) >= before;
 
-    if (ctx->instantMode) {
-        if (ctx->requestedBrg != ctx->actualBrg) {
-            ctx->actualBrg = ctx->requestedBrg;
-            changed = true;
-        }
-        if (ctx->requestedElev != ctx->actualElev) {
-            ctx->actualElev = ctx->requestedElev;
-            changed = true;
-        }
-    } else {
-        if ((now - ctx->lastCorrection) > (CLOCKS_PER_SEC / 4)) {
-            if (ctx->requestedBrg != ctx->actualBrg) {
-                changed = true;
-                auto delta1 = ctx->requestedBrg - ctx->actualBrg;
+    if (ctx->log.drain () == 0) return;
 
-                if (delta1 < 0.0) delta1 += 360.0;
+    SendMessage (ctx->console, LVM_SETITEMCOUNT, ctx->log.size (), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
 
-                auto delta2 = 360.0 - delta1;
+    // once the log is full every row holds another line than before
+    if (ctx->log.size () == before) InvalidateRect (ctx->console, 0, 0);
 
-                double delta, sign;
-                
-                if (delta1 > delta2) {
-                    delta = delta2;
-                    sign = -1.0;
-                } else {
-                    delta = delta1;
-                    sign = 1.0;
-                }
+    // stay at the end unless the user scrolled back to read
+    if (following) SendMessage (ctx->console, LVM_ENSUREVISIBLE, ctx->log.size () - 1, 0);
+}
 
-                if (delta > 50.0) {
-                    delta = 10.0;
-                } else if (delta > 25.0) {
-                    delta = 5.0;
-                } else if (delta > 5.0) {
-                    delta = 1.0;
-                }
+LRESULT onNotify (HWND wnd, NMHDR *header) {
+    Ctx *ctx = (Ctx *) GetWindowLongPtr (wnd, GWLP_USERDATA);
 
-                ctx->actualBrg += delta * sign;
-                if (ctx->actualBrg < 0.0) ctx->actualBrg += 360.0;
-                if (ctx->actualBrg > 360.0) ctx->actualBrg -= 360.0;
-            }
-            if (ctx->requestedElev != ctx->actualElev) {
-                changed = true;
-                double requestedRng = elevation2range (ctx->mastHeight, ctx->requestedElev);
-                double actualRng = elevation2range (ctx->mastHeight, ctx->actualElev);
-                auto delta = requestedRng - actualRng;
-                auto absDelta = fabs (delta);
-                auto sign = delta >= 0 ? 1.0 : -1.0;
-
-                if (absDelta > 500.0) {
-                    absDelta = 100.0;
-                } else if (absDelta > 100.0) {
-                    absDelta = 10.0;
-                } else if (absDelta > 20.0) {
-                    absDelta = 2.0;
-                }
+    if (header->hwndFrom == ctx->console && header->code == LVN_GETDISPINFO) {
+        LVITEM& item = ((NMLVDISPINFO *) header)->item;
+
+        if ((item.mask & LVIF_TEXT) && item.cchTextMax > 0) {
+            if (item.iItem >= 0 && (size_t) item.iItem < ctx->log.size ()) {
+                const LogLine& line = ctx->log.line ((size_t) item.iItem);
+                size_t size = (size_t) item.cchTextMax - 1 < line.size ? (size_t) item.cchTextMax - 1 : line.size;
 
-                actualRng += absDelta * sign;
-                ctx->actualElev = range2elevation (ctx->mastHeight, actualRng);
+                memcpy (item.pszText, line.text, size);
+                item.pszText [size] = '\0';
+            } else {
+                item.pszText [0] = '\0';
             }
         }
     }
 
-    if (changed) {
-        ctx->lastCorrection = now;
-        InvalidateRect (ctx->display, 0, 1);
-    }
-    
-    auto setWindowTextIfChanged = [ctx] (HWND wnd, char *text, CtlProtectFlags flag) {
-        char buffer [256];
-        GetWindowText (wnd, buffer, sizeof (buffer));
+    return 0;
+}
 
-        if (strcmp (buffer, text) != 0) {
-            SetWindowText (wnd, text);
-            ctx->protect (flag);
-        }
-    };
+void updateWatchdog (HWND wnd) {
+    Ctx *ctx = (Ctx *) GetWindowLongPtr (wnd, GWLP_USERDATA);
 
-    uint32_t status = LampStatus::LampOK;
-    if (SendMessage(ctx->azimuthFault, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::AzimuthFault;
-    if (SendMessage(ctx->elevationFault, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::ElevationFault;
-    if (SendMessage(ctx->focusFault, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::FocusFault;
-    if (SendMessage(ctx->tempSensorFail, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::TempSensorFail;
-    if (SendMessage(ctx->daylight, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::Daylight;
-    if (SendMessage(ctx->powerLoss, BM_GETCHECK, 0, 0) == BST_CHECKED) status |= LampStatus::PowerLoss;
-
-    setWindowTextIfChanged (ctx->reqBrgValue, ftoa (ctx->requestedBrg), CtlProtectFlags::REQ_BRG);
-    setWindowTextIfChanged (ctx->reqElevValue, ftoa (ctx->requestedElev, "%.3f"), CtlProtectFlags::REQ_ELEV);
-    setWindowTextIfChanged (ctx->actBrgValue, ftoa (ctx->actualBrg), CtlProtectFlags::ACT_BRG);
-    setWindowTextIfChanged (ctx->actElevValue, ftoa (ctx->actualElev, "%.3f"), CtlProtectFlags::ACT_ELEV);
-    setWindowTextIfChanged (ctx->reqRngValue, ftoa (elevation2range (ctx->mastHeight, ctx->requestedElev), "%.1f"), CtlProtectFlags::REQ_RNG);
-    setWindowTextIfChanged (ctx->actRngValue, ftoa (elevation2range (ctx->mastHeight, ctx->actualElev), "%.1f"), CtlProtectFlags::ACT_RNG);
-
-    sendLampSentence (ctx->actualBrg, ctx->actualElev, status, ctx);
-
-    /*f (ctx->locker) ctx->lock ();
-    for (auto& sentence: ctx->incomingStrings) {
-        addToConsole ((char *) sentence.c_str (), ctx);
+    applyPendingCommands (ctx);
+    drainConsole (ctx);
+
+    // the timer only decides how often we look; how far lamps move depends on the engine's clock alone
+    if (ctx->engine.update () > 0) {
+        ctx->bindings.changed (BoundSource::ACTUAL_POSITION);
+        invalidateBeams (ctx);
     }
+    
+    // controls follow the model; only those whose value changed are touched
+    ctx->bindings.refresh ();
 
-    ctx->incomingStrings.clear ();
-    if (ctx->locker) ctx->unlock ();*/
+    // sentences go out from the telemetry thread at their own rate; this only hands over the new state
+    ctx->telemetry.publish (ctx->fleet);
 }
 
 LRESULT wndProc (HWND wnd, UINT msg, WPARAM param1, LPARAM param2) {
@@ -422,6 +569,8 @@ LRESULT wndProc (HWND wnd, UINT msg, WPARAM param1, LPARAM param2) {
             updateWatchdog (wnd); break;
         case WM_COMMAND:
             doCommand (wnd, LOWORD (param1), HIWORD (param1)); break;
+        case WM_NOTIFY:
+            result = onNotify (wnd, (NMHDR *) param2); break;
         case WM_SIZE:
             onSize (wnd, LOWORD (param2), HIWORD (param2)); break;
         case WM_CREATE:
@@ -457,26 +606,27 @@ void onRightButtonDown (HWND wnd, int x, int y) {
     double range;
 
     if (dx == 0 && dy == 0) {
-        ctx->requestedBrg = 0.0;
+        ctx->fleet.requestedBrg [ctx->shownLamp] = 0.0;
         range = 0.0;
     } else {
         if (dx == 0) {
-            ctx->requestedBrg = y < centerY ? 0.0 : PI;
+            ctx->fleet.requestedBrg [ctx->shownLamp] = y < centerY ? 0.0 : PI;
         } else if (dy == 0) {
-            ctx->requestedBrg = x > centerX ? PI * 0.5 : PI * 1.5;
+            ctx->fleet.requestedBrg [ctx->shownLamp] = x > centerX ? PI * 0.5 : PI * 1.5;
         } else {
-            ctx->requestedBrg = asin (dx / hypo);
+            ctx->fleet.requestedBrg [ctx->shownLamp] = asin (dx / hypo);
             if (dy > 0) {
-                ctx->requestedBrg = PI - ctx->requestedBrg;
+                ctx->fleet.requestedBrg [ctx->shownLamp] = PI - ctx->fleet.requestedBrg [ctx->shownLamp];
             }
-            if (ctx->requestedBrg < 0.0) ctx->requestedBrg += TWO_PI;
-            if (ctx->requestedBrg >= TWO_PI) ctx->requestedBrg -= TWO_PI;
+            if (ctx->fleet.requestedBrg [ctx->shownLamp] < 0.0) ctx->fleet.requestedBrg [ctx->shownLamp] += TWO_PI;
+            if (ctx->fleet.requestedBrg [ctx->shownLamp] >= TWO_PI) ctx->fleet.requestedBrg [ctx->shownLamp] -= TWO_PI;
         }
         range = (hypo / zone) * 1852.0 * 0.5;
     }
-    ctx->requestedElev = range2elevation (ctx->mastHeight, range);
-    ctx->requestedBrg *= TO_DEG;
-    InvalidateRect (wnd, 0, 1);
+    ctx->fleet.requestedElev [ctx->shownLamp] = convertRange2elevation (ctx->fleet.conversion, ctx->fleet.mastHeight, range);
+    ctx->fleet.requestedBrg [ctx->shownLamp] *= TO_DEG;
+    ctx->bindings.changed (BoundSource::REQUESTED_POSITION);
+    invalidateBeams (ctx);
     //TrackPopupMenu (GetSubMenu (ctx->contextMenu, 0), TPM_LEFTALIGN | TPM_TOPALIGN, ctx->clickX, ctx->clickY, 0, GetParent (wnd), 0);
 }
 
@@ -490,6 +640,8 @@ LRESULT displayWndProc (HWND wnd, UINT msg, WPARAM param1, LPARAM param2) {
             onMouseMove (wnd, LOWORD (param2), HIWORD (param2)); break;
         case WM_PAINT:
             paintDisplay (wnd); break;
+        case WM_ERASEBKGND:
+            result = 1; break;      // the dial bitmap covers every pixel
         case WM_CREATE:
             initDisplay (wnd, ((CREATESTRUCT *) param2)->lpCreateParams); break;
         default:
@@ -530,10 +682,21 @@ void initCommonControls () {
 }
 
 int APIENTRY WinMain (HINSTANCE instance, HINSTANCE prev, char *cmdLine, int showCmd) {
-    Ctx ctx (0, instance, 10.0, 0.0, 0.25, 99, 0.0, 0.25, 99);
+    // optional command line arguments are the number of lamps on the bus (lamp 1 is shown in the window),
+    // the $PSMACK rate per lamp in Hz and a heartbeat interval in seconds; a heartbeat means lamps are only
+    // sent on change and otherwise once per heartbeat
+    char *rateArg = 0, *heartbeatArg = 0;
+    int numOfLamps = cmdLine && *cmdLine ? (int) strtol (cmdLine, & rateArg, 10) : 1;
+    double telemetryRate = rateArg && *rateArg ? strtod (rateArg, & heartbeatArg) : DEFAULT_TELEMETRY_RATE;
+    double heartbeat = heartbeatArg && *heartbeatArg ? atof (heartbeatArg) : 0.0;
+    Ctx ctx (0, instance, 10.0, 0.0, 0.25, 99, 0.0, 0.25, 99, numOfLamps > 0 ? (size_t) numOfLamps : 1);
+
+    if (telemetryRate > 0.0) ctx.telemetry.setRate (telemetryRate);
+    if (heartbeat > 0.0) ctx.telemetry.setEmissionMode (EmissionMode::EmitOnChange, heartbeat);
 
     CoInitialize (0);
     initCommonControls ();
+    registerSentenceHandlers (& ctx);
     registerClass (instance, ctx);
     
     auto mainWnd = CreateWindow (
@@ -553,27 +716,20 @@ int APIENTRY WinMain (HINSTANCE instance, HINSTANCE prev, char *cmdLine, int sho
     ShowWindow (mainWnd, SW_SHOW);
     UpdateWindow (mainWnd);
 
-    ctx.keepRunning = true;
-
-    startReader (& ctx);
-
     MSG msg;
 
     while (GetMessage (&msg, 0, 0, 0)) {
         TranslateMessage (&msg);
         DispatchMessage (&msg);
     }
+
+    // the port threads still stamp latencies until they are joined
+    closePort (& ctx);
+    writeLatencyReport (& ctx);
 }
 
+// Any thread; never waits for the window
 void addToConsole (char *text, Ctx *ctx) {
-    auto item = SendMessage (ctx->console, LB_ADDSTRING, 0, (LPARAM) text);
-
-    if (item > 100) {
-        SendMessage (ctx->console, LB_RESETCONTENT, item, 0);
-        
-        item = SendMessage (ctx->console, LB_ADDSTRING, 0, (LPARAM) text);
-    }
-
-    SendMessage (ctx->console, LB_SETCURSEL, item, 0);
+    ctx->log.append (text);
 }
 
@@ -0,0 +1,47 @@
+#include <chrono>
+#include "latency.h"
+
+uint64_t latencyNow () {
+    uint64_t now = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+
+    return now != 0 ? now : 1;
+}
+
+const char *latencyStageName (LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::ArrivalToParse: return "arrival->parse";
+        case LatencyStage::ParseToApply: return "parse->apply";
+        case LatencyStage::ApplyToTransmit: return "apply->transmit";
+        default: return "?";
+    }
+}
+
+void LatencyMonitor::format (LatencyStage stage, char *buffer, size_t size) const {
+    const LatencyHistogram& histogram = stages [stage];
+    uint64_t count = histogram.count ();
+
+    if (count == 0) {
+        snprintf (buffer, size, "%-16s no samples", latencyStageName (stage)); return;
+    }
+
+    snprintf (
+        buffer,
+        size,
+        "%-16s n=%llu p50=%.1f p99=%.1f p999=%.1f max=%.1f us",
+        latencyStageName (stage),
+        (unsigned long long) count,
+        (double) histogram.percentile (0.5) / 1000.0,
+        (double) histogram.percentile (0.99) / 1000.0,
+        (double) histogram.percentile (0.999) / 1000.0,
+        (double) histogram.max.load (std::memory_order_relaxed) / 1000.0
+    );
+}
+
+void LatencyMonitor::dump (FILE *output) const {
+    char line [200];
+
+    for (int i = 0; i < LatencyStage::NUM_OF_LATENCY_STAGES; ++ i) {
+        format ((LatencyStage) i, line, sizeof (line));
+        fprintf (output, "%s\n", line);
+    }
+}
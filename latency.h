@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "histogram.h"
+
+// Stages of a lamp command on its way through the simulator; each one is recorded by a single thread
+enum LatencyStage {
+    ArrivalToParse = 0,     // bytes read from the link -> command parsed and queued (reader thread)
+    ParseToApply,           // queued -> applied to the fleet (owner thread)
+    ApplyToTransmit,        // applied -> first $PSMACK of the lamp written to the link (transmitter thread)
+    NUM_OF_LATENCY_STAGES,
+};
+
+// Monotonic nanoseconds, the same clock the telemetry scheduler runs on; never 0, which stands for "no stamp"
+uint64_t latencyNow ();
+
+const char *latencyStageName (LatencyStage stage);
+
+struct LatencyMonitor {
+    LatencyHistogram stages [NUM_OF_LATENCY_STAGES];
+    std::vector<uint64_t> unpublished;      // per lamp, when a command was last applied to it; owner thread only
+
+    LatencyMonitor (size_t numOfLamps): unpublished (numOfLamps, 0) {}
+
+    void record (LatencyStage stage, uint64_t from, uint64_t to) {
+        if (from != 0 && to >= from) stages [stage].record (to - from);
+    }
+
+    void applied (size_t lamp, uint64_t time) {
+        if (lamp < unpublished.size ()) unpublished [lamp] = time;
+    }
+
+    // Stamp of the last command applied to the lamp since the previous call, 0 when there was none
+    uint64_t takeApplied (size_t lamp) {
+        if (lamp >= unpublished.size ()) return 0;
+
+        uint64_t time = unpublished [lamp];
+
+        unpublished [lamp] = 0;
+
+        return time;
+    }
+
+    // One line per stage: count, p50/p99/p999 and max, in microseconds
+    void format (LatencyStage stage, char *buffer, size_t size) const;
+    void dump (FILE *output) const;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "framer.h"
+#include "transport.h"
+#include "capture.h"
+
+// Receive/transmit path of one port: transport underneath, sentence framing on top. Has no UI dependencies
+// so it runs the same way against a real COM port and against a pty on Linux.
+struct Link {
+    Transport *transport;
+    SentenceFramer framer;
+    CaptureWriter *capture;     // optional, records every chunk in both directions
+    uint64_t bytesReceived;
+    uint64_t bytesSent;
+    uint64_t readErrors;
+    uint64_t writeErrors;
+
+    Link (): transport (0), capture (0), bytesReceived (0), bytesSent (0), readErrors (0), writeErrors (0) {}
+    ~Link () {
+        close ();
+    }
+
+    bool isOpen () {
+        return transport && transport->isOpen ();
+    }
+
+    void attach (Transport *_transport) {
+        close ();
+        framer.reset ();
+
+        transport = _transport;
+        bytesReceived = bytesSent = readErrors = writeErrors = 0;
+    }
+
+    void close () {
+        if (transport) {
+            delete transport;
+
+            transport = 0;
+        }
+    }
+
+    bool send (const char *data, size_t size) {
+        if (!isOpen ()) return false;
+
+        long result = transport->write (data, size);
+
+        if (result < 0) {
+            ++ writeErrors; return false;
+        }
+
+        bytesSent += (uint64_t) result;
+
+        if (capture) capture->append (CaptureDirection::CaptureTransmitted, data, (size_t) result);
+
+        return (size_t) result == size;
+    }
+
+    WaitResult waitForData (uint32_t timeoutMs = WAIT_FOREVER) {
+        return isOpen () ? transport->waitForData (timeoutMs) : WaitResult::WaitFailed;
+    }
+
+    void interrupt () {
+        if (transport) transport->interrupt ();
+    }
+
+    // Never blocks; returns number of bytes read, 0 when nothing is pending or -1 on error
+    long receive (char *buffer, size_t size) {
+        if (!isOpen ()) return -1;
+
+        long bytesRead = transport->read (buffer, size);
+
+        if (bytesRead < 0) {
+            ++ readErrors;
+        } else {
+            bytesReceived += (uint64_t) bytesRead;
+
+            if (capture) capture->append (CaptureDirection::CaptureReceived, buffer, (size_t) bytesRead);
+        }
+
+        return bytesRead;
+    }
+
+    // Drains everything the transport has got right now and dispatches every complete sentence
+    // to onSentence (const char *sentence, size_t size, const SentenceScan *scan), as SentenceFramer::feed does
+    template<typename SentenceCb> size_t poll (SentenceCb onSentence) {
+        char buffer [5000];
+        size_t total = 0;
+        long bytesRead;
+
+        while ((bytesRead = receive (buffer, sizeof (buffer))) > 0) {
+            total += (size_t) bytesRead;
+
+            framer.feed (buffer, (size_t) bytesRead, onSentence);
+        }
+
+        return total;
+    }
+};
@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+#include "link.h"
+#include "dispatch.h"
+#include "commands.h"
+#include "fleet.h"
+#include "psmack.h"
+
+// lampload: stress test of the receive path with no hardware. A generated control unit writes lamp commands,
+// well-formed and broken on purpose, into the simulator's own framer, dispatcher, command handlers and command
+// queue over an in-process loopback or a pty, then checks that every sentence ended up where it should have.
+
+enum LoadKind {
+    ValidCommand = 0,
+    BadChecksum,
+    TruncatedCommand,
+    OversizedCommand,
+    WrongLamp,
+    NUM_OF_LOAD_KINDS,
+};
+
+static const char *LOAD_KIND_NAMES [NUM_OF_LOAD_KINDS] = { "valid", "bad checksum", "truncated", "oversized", "wrong lamp" };
+
+static size_t const OVERSIZED_PAYLOAD = MAX_SENTENCE_SIZE + 64;
+static size_t const MAX_GENERATED_SIZE = OVERSIZED_PAYLOAD + 32;
+static size_t const WRITE_BATCH_SIZE = 4096;
+
+struct LoadOptions {
+    size_t numOfLamps;
+    double rate;                // sentences per second, 0 for as fast as the line takes them
+    double seconds;
+    double malformedShare;
+    uint32_t applyIntervalMs;   // how often the owner thread picks up waiting commands, as the UI timer does
+    bool usePty;
+    uint32_t seed;
+
+    LoadOptions (): numOfLamps (16), rate (0.0), seconds (5.0), malformedShare (0.2), applyIntervalMs (250), usePty (false), seed (1) {}
+};
+
+struct LoadGenerator {
+    std::mt19937 random;
+    size_t numOfLamps;
+    double malformedShare;
+    uint64_t generated [NUM_OF_LOAD_KINDS];
+    uint64_t bytes;
+    std::vector<LampCommand> latest;        // last valid command sent to each lamp, lampID 0 while there was none
+
+    LoadGenerator (const LoadOptions& options):
+        random (options.seed), numOfLamps (options.numOfLamps), malformedShare (options.malformedShare), bytes (0), latest (options.numOfLamps, LampCommand {}) {
+        memset (generated, 0, sizeof (generated));
+    }
+
+    double uniform () {
+        return (double) random () / ((double) std::mt19937::max () + 1.0);
+    }
+
+    // Both command forms, "$PSMACC,<lamp>,<brg>,<elev>,<focus>*hh" and the legacy "$<lamp>,<brg>,<elev>,<focus>,0*hh"
+    size_t command (char *buffer, int lampID, LampCommand *sent = 0) {
+        static SentenceLiteral<9> const PSMACC_PREFIX ("$PSMACC,");
+        SentenceWriter writer (buffer);
+        bool legacy = (random () & 1) != 0;
+        int32_t brg = (int32_t) (random () % 36000), elev = (int32_t) (random () % 9000), focus = (int32_t) (random () % 100);
+
+        // '$' is not part of the checksum
+        if (legacy) {
+            *writer.pos ++ = '$';
+        } else {
+            writer.literal (PSMACC_PREFIX);
+        }
+
+        writer.integer (lampID);
+        writer.put (',');
+        writer.fixed2 (brg);
+        writer.put (',');
+        writer.fixed2 (elev);
+        writer.put (',');
+        writer.integer (focus);
+
+        if (sent) *sent = LampCommand { (uint16_t) lampID, (uint8_t) focus, (double) brg / 100.0, (double) elev / 100.0 };
+
+        if (legacy) {
+            writer.put (',');
+            writer.put ('0');
+        }
+
+        return writer.finish (buffer);
+    }
+
+    size_t next (char *buffer) {
+        LoadKind kind = uniform () >= malformedShare ? LoadKind::ValidCommand : (LoadKind) (1 + random () % (NUM_OF_LOAD_KINDS - 1));
+        size_t size;
+
+        switch (kind) {
+            case LoadKind::BadChecksum:
+                size = command (buffer, 1 + (int) (random () % numOfLamps));
+                buffer [size - 3] = buffer [size - 3] == '0' ? '1' : '0';
+                break;
+            case LoadKind::TruncatedCommand:
+                // cut anywhere before the '*', still terminated; the last field then goes missing
+                size = command (buffer, 1 + (int) (random () % numOfLamps));
+                size = 1 + random () % (size - 5);
+                buffer [size ++] = '\r';
+                buffer [size ++] = '\n';
+                break;
+            case LoadKind::OversizedCommand:
+                memcpy (buffer, "$PSMACC,", 8);
+
+                for (size = 8; size < 8 + OVERSIZED_PAYLOAD; ++ size) buffer [size] = (char) ('0' + random () % 10);
+
+                buffer [size ++] = '\r';
+                buffer [size ++] = '\n';
+                break;
+            case LoadKind::WrongLamp:
+                size = command (buffer, random () & 1 ? 0 : (int) (numOfLamps + 1 + random () % 100));
+                break;
+            default: {
+                int lampID = 1 + (int) (random () % numOfLamps);
+
+                size = command (buffer, lampID, & latest [lampID - 1]);
+            }
+        }
+
+        ++ generated [kind];
+        bytes += size;
+
+        return size;
+    }
+
+    uint64_t total () {
+        uint64_t result = 0;
+
+        for (auto count: generated) result += count;
+
+        return result;
+    }
+};
+
+static double processCpuSeconds () {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+
+    if (!GetProcessTimes (GetCurrentProcess (), & created, & exited, & kernel, & user)) return 0.0;
+
+    return ((double) (((uint64_t) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) + (double) (((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime)) * 1e-7;
+#else
+    rusage usage;
+
+    getrusage (RUSAGE_SELF, & usage);
+
+    return (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+static double threadCpuSeconds () {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+
+    if (!GetThreadTimes (GetCurrentThread (), & created, & exited, & kernel, & user)) return 0.0;
+
+    return ((double) (((uint64_t) kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) + (double) (((uint64_t) user.dwHighDateTime << 32) | user.dwLowDateTime)) * 1e-7;
+#else
+    timespec now;
+
+    clock_gettime (CLOCK_THREAD_CPUTIME_ID, & now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+#endif
+}
+
+void showUsage () {
+    printf (
+        "Usage: lampload [-n lamps] [-r rate] [-t seconds] [-m malformed%%] [-u ms] [-s seed] [-p]\n"
+        "  -n  lamps the simulator has, 16 by default\n"
+        "  -r  sentences per second, 0 (default) for as many as the line takes\n"
+        "  -t  test duration, 5 s by default\n"
+        "  -m  share of malformed sentences in percent, 20 by default\n"
+        "  -u  interval waiting commands are picked up at, 250 ms (the UI timer) by default, 0 for continuously\n"
+        "  -s  random seed\n"
+        "  -p  go through a pseudo-terminal instead of the in-process loopback (not on Windows)\n"
+    );
+}
+
+int main (int argCount, char *args []) {
+    LoadOptions options;
+
+    for (int i = 1; i < argCount; ++ i) {
+        bool hasValue = i + 1 < argCount;
+
+        if (strcmp (args [i], "-n") == 0 && hasValue) {
+            options.numOfLamps = (size_t) atoi (args [++ i]);
+        } else if (strcmp (args [i], "-r") == 0 && hasValue) {
+            options.rate = atof (args [++ i]);
+        } else if (strcmp (args [i], "-t") == 0 && hasValue) {
+            options.seconds = atof (args [++ i]);
+        } else if (strcmp (args [i], "-m") == 0 && hasValue) {
+            options.malformedShare = atof (args [++ i]) * 0.01;
+        } else if (strcmp (args [i], "-u") == 0 && hasValue) {
+            options.applyIntervalMs = (uint32_t) atoi (args [++ i]);
+        } else if (strcmp (args [i], "-s") == 0 && hasValue) {
+            options.seed = (uint32_t) atoi (args [++ i]);
+        } else if (strcmp (args [i], "-p") == 0) {
+            options.usePty = true;
+        } else {
+            showUsage (); return 1;
+        }
+    }
+
+    if (options.numOfLamps < 1 || options.seconds <= 0.0) {
+        showUsage (); return 1;
+    }
+
+    Transport *controlUnit = 0, *simulatorSide = 0;
+
+    if (options.usePty) {
+#ifdef _WIN32
+        fprintf (stderr, "No pseudo-terminals on Windows\n"); return 2;
+#else
+        if (!openPtyPair (controlUnit, simulatorSide)) {
+            fprintf (stderr, "Unable to open a pseudo-terminal pair\n"); return 2;
+        }
+#endif
+    } else {
+        openLoopbackPair (controlUnit, simulatorSide);
+    }
+
+    // the simulator's side, wired the way the application wires it
+    Link link;
+    SentenceDispatcher dispatcher;
+    LampFleet fleet (options.numOfLamps, 0.0);
+    CommandInbox inbox;
+    LatencyMonitor latency (fleet.size ());
+    std::atomic<bool> running (true);
+    std::atomic<uint64_t> applied (0);
+    double readerCpu = 0.0;
+
+    link.attach (simulatorSide);
+    registerLampCommandHandlers (dispatcher, fleet, inbox);
+
+    inbox.latency = & latency;
+
+    std::thread reader ([&link, &dispatcher, &inbox, &readerCpu] () {
+        runCommandReader (link, dispatcher, inbox, 100);
+        readerCpu = threadCpuSeconds ();
+    });
+
+    std::thread owner ([&inbox, &fleet, &running, &applied, &options] () {
+        while (running.load ()) {
+            if (options.applyIntervalMs > 0) {
+                std::this_thread::sleep_for (std::chrono::milliseconds (options.applyIntervalMs));
+            } else {
+                std::this_thread::yield ();
+            }
+
+            applied += applyPendingCommands (inbox, fleet);
+        }
+    });
+
+    // the control unit
+    LoadGenerator generator (options);
+    char batch [WRITE_BATCH_SIZE + MAX_GENERATED_SIZE];
+    double cpuAtStart = processCpuSeconds ();
+    auto started = std::chrono::steady_clock::now ();
+    auto finish = started + std::chrono::duration_cast<std::chrono::steady_clock::duration> (std::chrono::duration<double> (options.seconds));
+    uint64_t bytesWritten = 0;
+
+    for (auto now = started; now < finish; now = std::chrono::steady_clock::now ()) {
+        uint64_t due = options.rate > 0.0 ? (uint64_t) (std::chrono::duration<double> (now - started).count () * options.rate) - generator.total () : UINT64_MAX;
+        size_t size = 0;
+
+        if (due == 0) {
+            std::this_thread::sleep_for (std::chrono::milliseconds (1)); continue;
+        }
+
+        for (; due > 0 && size < WRITE_BATCH_SIZE; -- due) size += generator.next (batch + size);
+
+        long result = controlUnit->write (batch, size);
+
+        if (result < 0) {
+            fprintf (stderr, "Write failed\n"); break;
+        }
+
+        bytesWritten += (uint64_t) result;
+    }
+
+    double sendSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - started).count ();
+
+    // let the receive side catch up with what is already on the line
+    for (int i = 0; i < 200 && link.bytesReceived < bytesWritten; ++ i) std::this_thread::sleep_for (std::chrono::milliseconds (10));
+
+    link.interrupt ();
+    reader.join ();
+
+    running = false;
+    owner.join ();
+    applied += applyPendingCommands (inbox, fleet);
+
+    double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - started).count ();
+    double cpu = processCpuSeconds () - cpuAtStart;
+
+    uint64_t received = dispatcher.unknown.received, handled = 0, crcFailed = dispatcher.unknown.crcFailed;
+
+    for (auto& counter: dispatcher.counters) {
+        received += counter.received;
+        handled += counter.handled;
+        crcFailed += counter.crcFailed;
+    }
+
+    uint64_t rejected = received - handled;
+    uint64_t expectedRejected = generator.generated [LoadKind::BadChecksum] + generator.generated [LoadKind::TruncatedCommand] + generator.generated [LoadKind::WrongLamp];
+    uint64_t expectedDropped = generator.generated [LoadKind::OversizedCommand];
+    size_t staleLamps = 0;
+
+    // however far behind the owner fell, every lamp has to end up on the last target it was sent
+    for (const LampCommand& sent: generator.latest) {
+        if (sent.lampID == 0) continue;
+
+        size_t index = fleet.indexOf (sent.lampID);
+
+        if (fleet.requestedBrg [index] != sent.brg || fleet.requestedElev [index] != sent.elev || fleet.requestedFocus [index] != sent.focus) ++ staleLamps;
+    }
+
+    bool consistent =
+        applied + inbox.superseded == generator.generated [LoadKind::ValidCommand] &&
+        rejected == expectedRejected &&
+        link.framer.resyncs == expectedDropped &&
+        inbox.invalidLamps == generator.generated [LoadKind::WrongLamp] &&
+        staleLamps == 0;
+
+    printf ("transport        %s\n", options.usePty ? "pty" : "loopback");
+    printf ("sent             %llu sentences, %llu bytes in %.2f s: %.0f sentences/s, %.2f MB/s\n",
+        (unsigned long long) generator.total (), (unsigned long long) bytesWritten, sendSeconds,
+        (double) generator.total () / sendSeconds, (double) bytesWritten / sendSeconds * 1e-6);
+
+    for (int kind = 0; kind < NUM_OF_LOAD_KINDS; ++ kind) {
+        printf ("  %-14s %llu\n", LOAD_KIND_NAMES [kind], (unsigned long long) generator.generated [kind]);
+    }
+
+    printf ("received         %llu bytes, %llu sentences framed\n", (unsigned long long) link.bytesReceived, (unsigned long long) link.framer.sentences);
+    printf ("applied          %llu\n", (unsigned long long) applied.load ());
+    printf ("superseded       %llu by a newer command for the same lamp before they were applied\n", (unsigned long long) inbox.superseded.load ());
+    printf ("stale lamps      %zu not on the last target sent to them\n", staleLamps);
+    printf ("dropped          %llu oversized by the framer (%llu bytes)\n", (unsigned long long) link.framer.resyncs, (unsigned long long) link.framer.droppedBytes);
+    printf ("rejected         %llu: %llu checksum, %llu unknown lamp, %llu other\n",
+        (unsigned long long) rejected, (unsigned long long) crcFailed, (unsigned long long) inbox.invalidLamps.load (),
+        (unsigned long long) (rejected - crcFailed - inbox.invalidLamps));
+    printf ("cpu              %.0f%% of one core overall, receive thread %.2f s (%.2f us per sentence)\n",
+        cpu / elapsed * 100.0, readerCpu, received > 0 ? readerCpu / (double) received * 1e6 : 0.0);
+    printf ("accounting       %s\n", consistent ? "consistent" : "MISMATCH");
+
+    char line [200];
+
+    // nothing is transmitted here, so apply->transmit stays empty
+    for (int stage = LatencyStage::ArrivalToParse; stage <= LatencyStage::ParseToApply; ++ stage) {
+        latency.format ((LatencyStage) stage, line, sizeof (line));
+        printf ("latency          %s\n", line);
+    }
+
+    delete controlUnit;
+
+    return consistent ? 0 : 3;
+}
@@ -0,0 +1,316 @@
+#include <math.h>
+#include "motion.h"
+#include "fleet.h"
+#include "geometry.h"
+#include "conversion.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+#define MOTION_X86
+#include <immintrin.h>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined (__GNUC__) || defined (__clang__)
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// Lamps whose elevation is processed in one go; ranges are converted around the vector part with the same
+// conversion functions stepLamp uses (libm per lamp, or the fast batch kernels which match the fast scalar ones bit for bit)
+static size_t const ELEV_CHUNK = 64;
+
+MotionKernel detectMotionKernel () {
+#if defined (MOTION_X86)
+#if defined (_MSC_VER)
+    int info [4];
+
+    __cpuid (info, 0);
+
+    if (info [0] >= 7) {
+        __cpuid (info, 1);
+
+        bool osSavesAvx = (info [2] & (1 << 27)) && (info [2] & (1 << 28)) && (_xgetbv (0) & 6) == 6;
+
+        __cpuidex (info, 7, 0);
+
+        if (osSavesAvx && (info [1] & (1 << 5))) return MotionKernel::Avx2Kernel;
+    }
+
+    return MotionKernel::Sse2Kernel;
+#else
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("avx2")) return MotionKernel::Avx2Kernel;
+    if (__builtin_cpu_supports ("sse2")) return MotionKernel::Sse2Kernel;
+#endif
+#endif
+    return MotionKernel::ScalarKernel;
+}
+
+const char *motionKernelName (MotionKernel kernel) {
+    switch (kernel) {
+        case MotionKernel::Sse2Kernel: return "sse2";
+        case MotionKernel::Avx2Kernel: return "avx2";
+        default: return "scalar";
+    }
+}
+
+static size_t stepScalar (ConversionMode conversion, double mastHeight, double *actualBrg, double *actualElev, const double *requestedBrg, const double *requestedElev, size_t count) {
+    size_t moved = 0;
+
+    for (size_t i = 0; i < count; ++ i) {
+        if (stepLamp (mastHeight, actualBrg [i], actualElev [i], requestedBrg [i], requestedElev [i], conversion)) ++ moved;
+    }
+
+    return moved;
+}
+
+// Lamps in the chunk which need their elevation moved
+static size_t countElevMoves (const double *actualElev, const double *requestedElev, size_t count) {
+    size_t moving = 0;
+
+    for (size_t i = 0; i < count; ++ i) moving += requestedElev [i] != actualElev [i] ? 1 : 0;
+
+    return moving;
+}
+
+// Fast conversions go through the batch kernels unless most of the chunk stands still; both give the same bits
+static bool convertWholeChunk (ConversionMode conversion, const double *actualElev, const double *requestedElev, size_t count) {
+    return conversion == ConversionMode::FastConversion && countElevMoves (actualElev, requestedElev, count) * 4 >= count;
+}
+
+// Range conversions around the vector tier selection; requested/actual ranges are left at 0 for lamps
+// with nothing to do so the vector part never sees inf/nan from an unused lane
+static void prepareRanges (
+    ConversionMode conversion, double mastHeight, const double *actualElev, const double *requestedElev, double *actualRng, double *requestedRng, size_t count
+) {
+    if (convertWholeChunk (conversion, actualElev, requestedElev, count)) {
+        elevations2ranges (conversion, mastHeight, requestedElev, requestedRng, count);
+        elevations2ranges (conversion, mastHeight, actualElev, actualRng, count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            if (requestedElev [i] == actualElev [i]) requestedRng [i] = actualRng [i] = 0.0;
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++ i) {
+        if (requestedElev [i] != actualElev [i]) {
+            requestedRng [i] = convertElevation2range (conversion, mastHeight, requestedElev [i]);
+            actualRng [i] = convertElevation2range (conversion, mastHeight, actualElev [i]);
+        } else {
+            requestedRng [i] = actualRng [i] = 0.0;
+        }
+    }
+}
+
+static void finishRanges (
+    ConversionMode conversion, double mastHeight, double *actualElev, const double *requestedElev, const double *actualRng, const double *requestedRng, size_t count
+) {
+    if (convertWholeChunk (conversion, actualElev, requestedElev, count)) {
+        double newElev [ELEV_CHUNK];
+
+        ranges2elevations (conversion, mastHeight, actualRng, newElev, count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            if (requestedElev [i] != actualElev [i]) actualElev [i] = landedOnRange (requestedRng [i], actualRng [i]) ? requestedElev [i] : newElev [i];
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++ i) {
+        if (requestedElev [i] != actualElev [i]) {
+            actualElev [i] = landedOnRange (requestedRng [i], actualRng [i]) ? requestedElev [i] : convertRange2elevation (conversion, mastHeight, actualRng [i]);
+        }
+    }
+}
+
+#if defined (MOTION_X86)
+
+static inline __m128d select2 (__m128d mask, __m128d ifTrue, __m128d ifFalse) {
+    return _mm_or_pd (_mm_and_pd (mask, ifTrue), _mm_andnot_pd (mask, ifFalse));
+}
+
+static size_t stepSse2 (ConversionMode conversion, double mastHeight, double *actualBrg, double *actualElev, const double *requestedBrg, const double *requestedElev, size_t count) {
+    const __m128d zero = _mm_setzero_pd ();
+    const __m128d one = _mm_set1_pd (1.0), minusOne = _mm_set1_pd (-1.0);
+    const __m128d full = _mm_set1_pd (360.0);
+    const __m128d brgTier1 = _mm_set1_pd (50.0), brgTier2 = _mm_set1_pd (25.0), brgTier3 = _mm_set1_pd (5.0);
+    const __m128d brgStep1 = _mm_set1_pd (10.0), brgStep2 = _mm_set1_pd (5.0), brgStep3 = _mm_set1_pd (1.0);
+    const __m128d rngTier1 = _mm_set1_pd (500.0), rngTier2 = _mm_set1_pd (100.0), rngTier3 = _mm_set1_pd (20.0);
+    const __m128d rngStep1 = _mm_set1_pd (100.0), rngStep2 = _mm_set1_pd (10.0), rngStep3 = _mm_set1_pd (2.0);
+    const __m128d absMask = _mm_castsi128_pd (_mm_set1_epi64x (0x7FFFFFFFFFFFFFFFLL));
+    double actualRng [ELEV_CHUNK], requestedRng [ELEV_CHUNK];
+    size_t moved = 0, vectorCount = count & ~(size_t) 1;
+
+    for (size_t chunk = 0; chunk < vectorCount; chunk += ELEV_CHUNK) {
+        size_t chunkSize = vectorCount - chunk < ELEV_CHUNK ? vectorCount - chunk : ELEV_CHUNK;
+
+        prepareRanges (conversion, mastHeight, actualElev + chunk, requestedElev + chunk, actualRng, requestedRng, chunkSize);
+
+        for (size_t j = 0; j < chunkSize; j += 2) {
+            size_t i = chunk + j;
+
+            // bearing: shortest way round, then 10/5/1 degree steps
+            __m128d reqBrg = _mm_loadu_pd (requestedBrg + i);
+            __m128d actBrg = _mm_loadu_pd (actualBrg + i);
+            __m128d brgMoves = _mm_cmpneq_pd (reqBrg, actBrg);
+            __m128d delta1 = _mm_sub_pd (reqBrg, actBrg);
+
+            delta1 = select2 (_mm_cmplt_pd (delta1, zero), _mm_add_pd (delta1, full), delta1);
+
+            __m128d delta2 = _mm_sub_pd (full, delta1);
+            __m128d backwards = _mm_cmpgt_pd (delta1, delta2);
+            __m128d delta = select2 (backwards, delta2, delta1);
+            __m128d sign = select2 (backwards, minusOne, one);
+
+            // tiers are tested against the original delta, the widest one wins
+            __m128d tier1 = _mm_cmpgt_pd (delta, brgTier1), tier2 = _mm_cmpgt_pd (delta, brgTier2), tier3 = _mm_cmpgt_pd (delta, brgTier3);
+
+            delta = select2 (tier3, brgStep3, delta);
+            delta = select2 (tier2, brgStep2, delta);
+            delta = select2 (tier1, brgStep1, delta);
+
+            __m128d newBrg = _mm_add_pd (actBrg, _mm_mul_pd (delta, sign));
+
+            newBrg = select2 (_mm_cmplt_pd (newBrg, zero), _mm_add_pd (newBrg, full), newBrg);
+            newBrg = select2 (_mm_cmpgt_pd (newBrg, full), _mm_sub_pd (newBrg, full), newBrg);
+
+            _mm_storeu_pd (actualBrg + i, select2 (brgMoves, newBrg, actBrg));
+
+            // range: 100/10/2 m steps towards the requested range
+            __m128d elevMoves = _mm_cmpneq_pd (_mm_loadu_pd (requestedElev + i), _mm_loadu_pd (actualElev + i));
+            __m128d reqRng = _mm_loadu_pd (requestedRng + j);
+            __m128d actRng = _mm_loadu_pd (actualRng + j);
+            __m128d rngDelta = _mm_sub_pd (reqRng, actRng);
+            __m128d absDelta = _mm_and_pd (rngDelta, absMask);
+            __m128d rngSign = select2 (_mm_cmpge_pd (rngDelta, zero), one, minusOne);
+
+            tier1 = _mm_cmpgt_pd (absDelta, rngTier1);
+            tier2 = _mm_cmpgt_pd (absDelta, rngTier2);
+            tier3 = _mm_cmpgt_pd (absDelta, rngTier3);
+
+            absDelta = select2 (tier3, rngStep3, absDelta);
+            absDelta = select2 (tier2, rngStep2, absDelta);
+            absDelta = select2 (tier1, rngStep1, absDelta);
+
+            _mm_storeu_pd (actualRng + j, _mm_add_pd (actRng, _mm_mul_pd (absDelta, rngSign)));
+
+            int movedMask = _mm_movemask_pd (_mm_or_pd (brgMoves, elevMoves));
+
+            moved += (movedMask & 1) + ((movedMask >> 1) & 1);
+        }
+
+        finishRanges (conversion, mastHeight, actualElev + chunk, requestedElev + chunk, actualRng, requestedRng, chunkSize);
+    }
+
+    return moved + stepScalar (
+        conversion, mastHeight, actualBrg + vectorCount, actualElev + vectorCount, requestedBrg + vectorCount, requestedElev + vectorCount, count - vectorCount
+    );
+}
+
+TARGET_AVX2 static size_t stepAvx2 (ConversionMode conversion, double mastHeight, double *actualBrg, double *actualElev, const double *requestedBrg, const double *requestedElev, size_t count) {
+    const __m256d zero = _mm256_setzero_pd ();
+    const __m256d one = _mm256_set1_pd (1.0), minusOne = _mm256_set1_pd (-1.0);
+    const __m256d full = _mm256_set1_pd (360.0);
+    const __m256d brgTier1 = _mm256_set1_pd (50.0), brgTier2 = _mm256_set1_pd (25.0), brgTier3 = _mm256_set1_pd (5.0);
+    const __m256d brgStep1 = _mm256_set1_pd (10.0), brgStep2 = _mm256_set1_pd (5.0), brgStep3 = _mm256_set1_pd (1.0);
+    const __m256d rngTier1 = _mm256_set1_pd (500.0), rngTier2 = _mm256_set1_pd (100.0), rngTier3 = _mm256_set1_pd (20.0);
+    const __m256d rngStep1 = _mm256_set1_pd (100.0), rngStep2 = _mm256_set1_pd (10.0), rngStep3 = _mm256_set1_pd (2.0);
+    const __m256d absMask = _mm256_castsi256_pd (_mm256_set1_epi64x (0x7FFFFFFFFFFFFFFFLL));
+    double actualRng [ELEV_CHUNK], requestedRng [ELEV_CHUNK];
+    size_t moved = 0, vectorCount = count & ~(size_t) 3;
+
+    for (size_t chunk = 0; chunk < vectorCount; chunk += ELEV_CHUNK) {
+        size_t chunkSize = vectorCount - chunk < ELEV_CHUNK ? vectorCount - chunk : ELEV_CHUNK;
+
+        prepareRanges (conversion, mastHeight, actualElev + chunk, requestedElev + chunk, actualRng, requestedRng, chunkSize);
+
+        for (size_t j = 0; j < chunkSize; j += 4) {
+            size_t i = chunk + j;
+
+            __m256d reqBrg = _mm256_loadu_pd (requestedBrg + i);
+            __m256d actBrg = _mm256_loadu_pd (actualBrg + i);
+            __m256d brgMoves = _mm256_cmp_pd (reqBrg, actBrg, _CMP_NEQ_UQ);
+            __m256d delta1 = _mm256_sub_pd (reqBrg, actBrg);
+
+            delta1 = _mm256_blendv_pd (delta1, _mm256_add_pd (delta1, full), _mm256_cmp_pd (delta1, zero, _CMP_LT_OQ));
+
+            __m256d delta2 = _mm256_sub_pd (full, delta1);
+            __m256d backwards = _mm256_cmp_pd (delta1, delta2, _CMP_GT_OQ);
+            __m256d delta = _mm256_blendv_pd (delta1, delta2, backwards);
+            __m256d sign = _mm256_blendv_pd (one, minusOne, backwards);
+
+            __m256d tier1 = _mm256_cmp_pd (delta, brgTier1, _CMP_GT_OQ);
+            __m256d tier2 = _mm256_cmp_pd (delta, brgTier2, _CMP_GT_OQ);
+            __m256d tier3 = _mm256_cmp_pd (delta, brgTier3, _CMP_GT_OQ);
+
+            delta = _mm256_blendv_pd (delta, brgStep3, tier3);
+            delta = _mm256_blendv_pd (delta, brgStep2, tier2);
+            delta = _mm256_blendv_pd (delta, brgStep1, tier1);
+
+            __m256d newBrg = _mm256_add_pd (actBrg, _mm256_mul_pd (delta, sign));
+
+            newBrg = _mm256_blendv_pd (newBrg, _mm256_add_pd (newBrg, full), _mm256_cmp_pd (newBrg, zero, _CMP_LT_OQ));
+            newBrg = _mm256_blendv_pd (newBrg, _mm256_sub_pd (newBrg, full), _mm256_cmp_pd (newBrg, full, _CMP_GT_OQ));
+
+            _mm256_storeu_pd (actualBrg + i, _mm256_blendv_pd (actBrg, newBrg, brgMoves));
+
+            __m256d elevMoves = _mm256_cmp_pd (_mm256_loadu_pd (requestedElev + i), _mm256_loadu_pd (actualElev + i), _CMP_NEQ_UQ);
+            __m256d reqRng = _mm256_loadu_pd (requestedRng + j);
+            __m256d actRng = _mm256_loadu_pd (actualRng + j);
+            __m256d rngDelta = _mm256_sub_pd (reqRng, actRng);
+            __m256d absDelta = _mm256_and_pd (rngDelta, absMask);
+            __m256d rngSign = _mm256_blendv_pd (minusOne, one, _mm256_cmp_pd (rngDelta, zero, _CMP_GE_OQ));
+
+            tier1 = _mm256_cmp_pd (absDelta, rngTier1, _CMP_GT_OQ);
+            tier2 = _mm256_cmp_pd (absDelta, rngTier2, _CMP_GT_OQ);
+            tier3 = _mm256_cmp_pd (absDelta, rngTier3, _CMP_GT_OQ);
+
+            absDelta = _mm256_blendv_pd (absDelta, rngStep3, tier3);
+            absDelta = _mm256_blendv_pd (absDelta, rngStep2, tier2);
+            absDelta = _mm256_blendv_pd (absDelta, rngStep1, tier1);
+
+            _mm256_storeu_pd (actualRng + j, _mm256_add_pd (actRng, _mm256_mul_pd (absDelta, rngSign)));
+
+            int movedMask = _mm256_movemask_pd (_mm256_or_pd (brgMoves, elevMoves));
+
+            moved += (movedMask & 1) + ((movedMask >> 1) & 1) + ((movedMask >> 2) & 1) + ((movedMask >> 3) & 1);
+        }
+
+        finishRanges (conversion, mastHeight, actualElev + chunk, requestedElev + chunk, actualRng, requestedRng, chunkSize);
+    }
+
+    return moved + stepScalar (
+        conversion, mastHeight, actualBrg + vectorCount, actualElev + vectorCount, requestedBrg + vectorCount, requestedElev + vectorCount, count - vectorCount
+    );
+}
+
+#endif
+
+size_t stepLamps (
+    MotionKernel kernel,
+    ConversionMode conversion,
+    double mastHeight,
+    double *actualBrg,
+    double *actualElev,
+    const double *requestedBrg,
+    const double *requestedElev,
+    size_t count
+) {
+    switch (kernel) {
+#if defined (MOTION_X86)
+        case MotionKernel::Avx2Kernel:
+            return stepAvx2 (conversion, mastHeight, actualBrg, actualElev, requestedBrg, requestedElev, count);
+        case MotionKernel::Sse2Kernel:
+            return stepSse2 (conversion, mastHeight, actualBrg, actualElev, requestedBrg, requestedElev, count);
+#endif
+        default:
+            return stepScalar (conversion, mastHeight, actualBrg, actualElev, requestedBrg, requestedElev, count);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "conversion.h"
+
+enum MotionKernel {
+    ScalarKernel = 0,
+    Sse2Kernel,
+    Avx2Kernel,
+};
+
+// Best kernel the CPU we run on supports
+MotionKernel detectMotionKernel ();
+const char *motionKernelName (MotionKernel kernel);
+
+// Makes one slew step for count lamps with the same tiered rules as stepLamp; every kernel gives
+// bit-identical results. Returns number of lamps which moved.
+size_t stepLamps (
+    MotionKernel kernel,
+    ConversionMode conversion,
+    double mastHeight,
+    double *actualBrg,
+    double *actualElev,
+    const double *requestedBrg,
+    const double *requestedElev,
+    size_t count
+);
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include "spsc.h"
+
+// Bounded multi-producer/single-consumer queue; every slot carries a sequence number which says whose turn it is.
+// Producers claim a slot with one compare-and-swap and never wait for each other or for the consumer: push fails
+// when the queue is full and pop fails when it is empty. Slots live on the heap, so the queue may be large.
+template<typename T> struct MpscQueue {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    size_t mask;
+    std::unique_ptr<Slot []> slots;
+    alignas (CACHE_LINE_SIZE) std::atomic<size_t> head;     // next slot to claim, shared by the producers
+    alignas (CACHE_LINE_SIZE) std::atomic<size_t> tail;     // written by the consumer only
+
+    // Capacity is rounded up to a power of two
+    MpscQueue (size_t capacity): head (0), tail (0) {
+        size_t size = 1;
+
+        while (size < capacity) size <<= 1;
+
+        mask = size - 1;
+        slots.reset (new Slot [size]);
+
+        for (size_t i = 0; i < size; ++ i) slots [i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    // The item is built in place by fill (T&), so a large one is never copied twice
+    template<typename Fill> bool push (Fill fill) {
+        size_t pos = head.load (std::memory_order_relaxed);
+        Slot *slot;
+
+        while (true) {
+            slot = & slots [pos & mask];
+
+            intptr_t lag = (intptr_t) slot->sequence.load (std::memory_order_acquire) - (intptr_t) pos;
+
+            if (lag == 0) {
+                if (head.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (lag < 0) {
+                return false;
+            } else {
+                pos = head.load (std::memory_order_relaxed);
+            }
+        }
+
+        fill (slot->item);
+        slot->sequence.store (pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Hands the oldest item to use (const T&) and frees its slot afterwards
+    template<typename Use> bool pop (Use use) {
+        size_t pos = tail.load (std::memory_order_relaxed);
+        Slot& slot = slots [pos & mask];
+
+        if (slot.sequence.load (std::memory_order_acquire) != pos + 1) return false;
+
+        use ((const T&) slot.item);
+        slot.sequence.store (pos + mask + 1, std::memory_order_release);
+        tail.store (pos + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    size_t capacity () const { return mask + 1; }
+};
@@ -0,0 +1,139 @@
+#include <stdlib.h>
+#include <string.h>
+#include "nmea.h"
+#include "numparse.h"
+#include "nmeascan.h"
+
+// Longest sentence tokenized from the delimiter masks, anything longer takes the byte by byte path
+static size_t const MAX_SCANNED_SENTENCE_SIZE = 256;
+
+uint8_t htodec (char chr) {
+    if (chr >= '0' && chr <= '9') return chr - '0';
+    if (chr >= 'A' && chr <= 'F') return chr - 'A' + 10;
+    if (chr >= 'a' && chr <= 'f') return chr - 'a' + 10;
+    return 0;
+}
+
+int tokenizeSentenceScalar (const char *source, size_t size, SentenceFields& fields) {
+    const char *end = source + size;
+    const char *fieldStart = source + 1;
+    uint8_t actualCrc = 0;
+
+    fields.count = 0;
+    fields.crcPresent = false;
+    fields.crcFailed = false;
+
+    for (const char *chr = fieldStart; chr < end && *chr; ++ chr) {
+        if (*chr == ',' || *chr == '*') {
+            if (fields.count >= (int) MAX_NMEA_FIELDS) return 0;
+
+            auto& field = fields.items [fields.count ++];
+
+            field.data = fieldStart;
+            field.size = (uint16_t) (chr - fieldStart);
+            fieldStart = chr + 1;
+
+            if (*chr == '*') {
+                if (chr + 2 >= end) return 0;
+
+                uint8_t crc = htodec (chr [1]) * 16 + htodec (chr [2]);
+
+                if (crc != actualCrc) {
+                    fields.crcFailed = true; return 0;
+                }
+
+                fields.crcPresent = true;
+                break;
+            }
+        }
+
+        actualCrc ^= *chr;
+    }
+
+    return fields.count;
+}
+
+// Fields from the comma and star masks of the body [first, last) relative to scan.origin, which has the '$' at first - 1
+static int tokenizeFromMasks (const char *end, size_t first, size_t last, const SentenceScan& scan, SentenceFields& fields) {
+    size_t fieldStart = first;
+
+    fields.count = 0;
+    fields.crcPresent = false;
+    fields.crcFailed = false;
+
+    for (size_t i = first / SCAN_BLOCK_SIZE; i * SCAN_BLOCK_SIZE < last; ++ i) {
+        uint64_t delimiters = scan.blocks [i].commas | scan.blocks [i].stars;
+        size_t blockStart = i * SCAN_BLOCK_SIZE;
+
+        if (blockStart < first) delimiters &= ~0ull << (first - blockStart);
+        if (last - blockStart < SCAN_BLOCK_SIZE) delimiters &= (1ull << (last - blockStart)) - 1;
+
+        for (; delimiters; delimiters &= delimiters - 1) {
+            size_t pos = blockStart + lowestSetBit (delimiters);
+            const char *chr = scan.origin + pos;
+
+            if (fields.count >= (int) MAX_NMEA_FIELDS) return 0;
+
+            auto& field = fields.items [fields.count ++];
+
+            field.data = scan.origin + fieldStart;
+            field.size = (uint16_t) (pos - fieldStart);
+            fieldStart = pos + 1;
+
+            if (*chr == '*') {
+                if (chr + 2 >= end) return 0;
+
+                uint8_t crc = htodec (chr [1]) * 16 + htodec (chr [2]);
+
+                // everything between '$' and '*'; first - 1 is the '$'
+                uint8_t actualCrc = scan.prefixXor [pos - 1] ^ scan.prefixXor [first - 1];
+
+                if (crc != actualCrc) {
+                    fields.crcFailed = true; return 0;
+                }
+
+                fields.crcPresent = true;
+
+                return fields.count;
+            }
+        }
+    }
+
+    return fields.count;
+}
+
+// Where the byte by byte loop stops: the end, or a NUL before it
+static const char *bodyEnd (const char *source, size_t size) {
+    const char *terminator = (const char *) memchr (source + 1, '\0', size - 1);
+
+    return terminator ? terminator : source + size;
+}
+
+int tokenizeSentence (const char *source, size_t size, SentenceFields& fields) {
+    if (size <= MAX_NMEA_SENTENCE_SIZE || size > MAX_SCANNED_SENTENCE_SIZE) return tokenizeSentenceScalar (source, size, fields);
+
+    ScanBlock blocks [MAX_SCANNED_SENTENCE_SIZE / SCAN_BLOCK_SIZE];
+    uint8_t prefixXor [MAX_SCANNED_SENTENCE_SIZE];
+    SentenceScan const scan { source, blocks, prefixXor };
+    size_t last = (size_t) (bodyEnd (source, size) - source);
+
+    scanNmea (defaultScanKernel (), source, last, blocks, prefixXor);
+
+    return tokenizeFromMasks (source + size, 1, last, scan, fields);
+}
+
+int tokenizeScannedSentence (const char *source, size_t size, const SentenceScan& scan, SentenceFields& fields) {
+    if (size < 1) return tokenizeSentenceScalar (source, size, fields);
+
+    size_t first = (size_t) (source - scan.origin);
+
+    return tokenizeFromMasks (source + size, first + 1, first + (size_t) (bodyEnd (source, size) - source), scan, fields);
+}
+
+int fieldToInt (FieldView& field) {
+    return toInt (field.data, field.data + field.size);
+}
+
+double fieldToDouble (FieldView& field) {
+    return toDouble (field.data, field.data + field.size);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "nmeascan.h"
+
+static size_t const MAX_NMEA_FIELDS = 32;
+static size_t const MAX_NMEA_SENTENCE_SIZE = 82;    // what the standard allows, "$" to LF
+
+// Non-owning view of a single sentence field; points straight into the receive buffer
+struct FieldView {
+    const char *data;
+    uint16_t size;
+
+    bool empty () const { return size == 0; }
+};
+
+struct SentenceFields {
+    FieldView items [MAX_NMEA_FIELDS];
+    int count;
+    bool crcPresent;
+    bool crcFailed;         // fields up to the '*' are still filled in, so the sentence can be told apart
+
+    SentenceFields (): count (0), crcPresent (false), crcFailed (false) {}
+
+    FieldView& operator [] (int index) { return items [index]; }
+};
+
+uint8_t htodec (char chr);
+
+// Splits "$f0,f1,...*hh" into fields without copying anything and validates the checksum in the same pass.
+// Returns number of fields found, or 0 when the checksum does not match or the sentence has too many fields.
+// Sentences of standard size go byte by byte, where setting up the vector delimiter scan costs more than it saves;
+// longer ones are scanned.
+int tokenizeSentence (const char *source, size_t size, SentenceFields& fields);
+
+// Byte by byte reference of the above
+int tokenizeSentenceScalar (const char *source, size_t size, SentenceFields& fields);
+
+// Same result, taken from the masks and XOR of a scan which has already been over the sentence (the framer's)
+int tokenizeScannedSentence (const char *source, size_t size, const SentenceScan& scan, SentenceFields& fields);
+
+int fieldToInt (FieldView& field);
+double fieldToDouble (FieldView& field);
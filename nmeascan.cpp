@@ -0,0 +1,237 @@
+#include <string.h>
+#include "nmeascan.h"
+#include "motion.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+#define SCAN_X86
+#include <immintrin.h>
+#elif defined (__aarch64__) || defined (_M_ARM64)
+#define SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined (__GNUC__) || defined (__clang__)
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+    typedef uint8_t (*BlockScanner) (const uint8_t *source, ScanBlock& block, uint8_t *prefixXor, uint8_t carry);
+
+    uint8_t scanBlockScalar (const uint8_t *source, ScanBlock& block, uint8_t *prefixXor, uint8_t carry) {
+        block = ScanBlock {};
+
+        for (size_t i = 0; i < SCAN_BLOCK_SIZE; ++ i) {
+            uint64_t bit = 1ull << i;
+
+            switch (source [i]) {
+                case '$': block.dollars |= bit; break;
+                case ',': block.commas |= bit; break;
+                case '*': block.stars |= bit; break;
+                case '\r': block.crs |= bit; break;
+                case '\n': block.lfs |= bit; break;
+            }
+
+            if (prefixXor) prefixXor [i] = carry ^= source [i];
+        }
+
+        return carry;
+    }
+
+#if defined (SCAN_X86)
+    uint8_t scanBlockSse2 (const uint8_t *source, ScanBlock& block, uint8_t *prefixXor, uint8_t carry) {
+        __m128i const dollar = _mm_set1_epi8 ('$');
+        __m128i const comma = _mm_set1_epi8 (',');
+        __m128i const star = _mm_set1_epi8 ('*');
+        __m128i const cr = _mm_set1_epi8 ('\r');
+        __m128i const lf = _mm_set1_epi8 ('\n');
+
+        block = ScanBlock {};
+
+        for (size_t i = 0; i < SCAN_BLOCK_SIZE; i += 16) {
+            __m128i bytes = _mm_loadu_si128 ((const __m128i *) (source + i));
+
+            block.dollars |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, dollar)) << i;
+            block.commas |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, comma)) << i;
+            block.stars |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, star)) << i;
+            block.crs |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, cr)) << i;
+            block.lfs |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, lf)) << i;
+
+            if (prefixXor) {
+                // log-step prefix within the vector, then the running value of everything before it
+                bytes = _mm_xor_si128 (bytes, _mm_slli_si128 (bytes, 1));
+                bytes = _mm_xor_si128 (bytes, _mm_slli_si128 (bytes, 2));
+                bytes = _mm_xor_si128 (bytes, _mm_slli_si128 (bytes, 4));
+                bytes = _mm_xor_si128 (bytes, _mm_slli_si128 (bytes, 8));
+                bytes = _mm_xor_si128 (bytes, _mm_set1_epi8 ((char) carry));
+
+                _mm_storeu_si128 ((__m128i *) (prefixXor + i), bytes);
+
+                carry = (uint8_t) (_mm_extract_epi16 (bytes, 7) >> 8);
+            }
+        }
+
+        return carry;
+    }
+
+    TARGET_AVX2 uint8_t scanBlockAvx2 (const uint8_t *source, ScanBlock& block, uint8_t *prefixXor, uint8_t carry) {
+        __m256i const dollar = _mm256_set1_epi8 ('$');
+        __m256i const comma = _mm256_set1_epi8 (',');
+        __m256i const star = _mm256_set1_epi8 ('*');
+        __m256i const cr = _mm256_set1_epi8 ('\r');
+        __m256i const lf = _mm256_set1_epi8 ('\n');
+        __m256i const lastByte = _mm256_set1_epi8 (15);
+
+        block = ScanBlock {};
+
+        for (size_t i = 0; i < SCAN_BLOCK_SIZE; i += 32) {
+            __m256i bytes = _mm256_loadu_si256 ((const __m256i *) (source + i));
+
+            block.dollars |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (bytes, dollar)) << i;
+            block.commas |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (bytes, comma)) << i;
+            block.stars |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (bytes, star)) << i;
+            block.crs |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (bytes, cr)) << i;
+            block.lfs |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (bytes, lf)) << i;
+
+            if (prefixXor) {
+                // byte shifts stay within 128 bit lanes, so the upper lane also takes the last byte of the lower one
+                bytes = _mm256_xor_si256 (bytes, _mm256_slli_si256 (bytes, 1));
+                bytes = _mm256_xor_si256 (bytes, _mm256_slli_si256 (bytes, 2));
+                bytes = _mm256_xor_si256 (bytes, _mm256_slli_si256 (bytes, 4));
+                bytes = _mm256_xor_si256 (bytes, _mm256_slli_si256 (bytes, 8));
+
+                __m256i laneTotals = _mm256_shuffle_epi8 (bytes, lastByte);
+
+                bytes = _mm256_xor_si256 (bytes, _mm256_permute2x128_si256 (laneTotals, laneTotals, 0x08));
+                bytes = _mm256_xor_si256 (bytes, _mm256_set1_epi8 ((char) carry));
+
+                _mm256_storeu_si256 ((__m256i *) (prefixXor + i), bytes);
+
+                carry = (uint8_t) _mm256_extract_epi8 (bytes, 31);
+            }
+        }
+
+        return carry;
+    }
+#endif
+
+#if defined (SCAN_NEON)
+    // NEON has no movemask; weight each lane by its bit and add pairwise down to 64 bits
+    uint64_t neonMask (uint8x16_t m0, uint8x16_t m1, uint8x16_t m2, uint8x16_t m3) {
+        static uint8_t const BIT_WEIGHTS [16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        uint8x16_t const weights = vld1q_u8 (BIT_WEIGHTS);
+        uint8x16_t sum0 = vpaddq_u8 (vandq_u8 (m0, weights), vandq_u8 (m1, weights));
+        uint8x16_t sum1 = vpaddq_u8 (vandq_u8 (m2, weights), vandq_u8 (m3, weights));
+
+        sum0 = vpaddq_u8 (sum0, sum1);
+        sum0 = vpaddq_u8 (sum0, sum0);
+
+        return vgetq_lane_u64 (vreinterpretq_u64_u8 (sum0), 0);
+    }
+
+    uint64_t neonMatch (const uint8x16_t *bytes, uint8_t chr) {
+        uint8x16_t const pattern = vdupq_n_u8 (chr);
+
+        return neonMask (
+            vceqq_u8 (bytes [0], pattern), vceqq_u8 (bytes [1], pattern), vceqq_u8 (bytes [2], pattern), vceqq_u8 (bytes [3], pattern)
+        );
+    }
+
+    uint8_t scanBlockNeon (const uint8_t *source, ScanBlock& block, uint8_t *prefixXor, uint8_t carry) {
+        uint8x16_t bytes [4];
+
+        for (size_t i = 0; i < 4; ++ i) bytes [i] = vld1q_u8 (source + i * 16);
+
+        block.dollars = neonMatch (bytes, '$');
+        block.commas = neonMatch (bytes, ',');
+        block.stars = neonMatch (bytes, '*');
+        block.crs = neonMatch (bytes, '\r');
+        block.lfs = neonMatch (bytes, '\n');
+
+        if (prefixXor) {
+            uint8x16_t const zero = vdupq_n_u8 (0);
+
+            for (size_t i = 0; i < 4; ++ i) {
+                uint8x16_t prefix = bytes [i];
+
+                prefix = veorq_u8 (prefix, vextq_u8 (zero, prefix, 15));
+                prefix = veorq_u8 (prefix, vextq_u8 (zero, prefix, 14));
+                prefix = veorq_u8 (prefix, vextq_u8 (zero, prefix, 12));
+                prefix = veorq_u8 (prefix, vextq_u8 (zero, prefix, 8));
+                prefix = veorq_u8 (prefix, vdupq_n_u8 (carry));
+
+                vst1q_u8 (prefixXor + i * 16, prefix);
+
+                carry = vgetq_lane_u8 (prefix, 15);
+            }
+        }
+
+        return carry;
+    }
+#endif
+
+    BlockScanner blockScanner (ScanKernel kernel) {
+        switch (kernel) {
+#if defined (SCAN_X86)
+            case ScanKernel::Sse2Scan: return scanBlockSse2;
+            case ScanKernel::Avx2Scan: return scanBlockAvx2;
+#endif
+#if defined (SCAN_NEON)
+            case ScanKernel::NeonScan: return scanBlockNeon;
+#endif
+            default: return scanBlockScalar;
+        }
+    }
+}
+
+ScanKernel detectScanKernel () {
+#if defined (SCAN_X86)
+    // same question the motion kernels ask the CPU
+    switch (detectMotionKernel ()) {
+        case MotionKernel::Avx2Kernel: return ScanKernel::Avx2Scan;
+        case MotionKernel::Sse2Kernel: return ScanKernel::Sse2Scan;
+        default: return ScanKernel::ScalarScan;
+    }
+#elif defined (SCAN_NEON)
+    return ScanKernel::NeonScan;
+#else
+    return ScanKernel::ScalarScan;
+#endif
+}
+
+ScanKernel defaultScanKernel () {
+    static ScanKernel const kernel = detectScanKernel ();
+
+    return kernel;
+}
+
+const char *scanKernelName (ScanKernel kernel) {
+    switch (kernel) {
+        case ScanKernel::Sse2Scan: return "sse2";
+        case ScanKernel::Avx2Scan: return "avx2";
+        case ScanKernel::NeonScan: return "neon";
+        default: return "scalar";
+    }
+}
+
+void scanNmea (ScanKernel kernel, const char *data, size_t size, ScanBlock *blocks, uint8_t *prefixXor, uint8_t carry) {
+    BlockScanner scanBlock = blockScanner (kernel);
+    const uint8_t *source = (const uint8_t *) data;
+    size_t fullSize = size & ~(SCAN_BLOCK_SIZE - 1);
+
+    for (size_t offset = 0; offset < fullSize; offset += SCAN_BLOCK_SIZE) {
+        carry = scanBlock (source + offset, * blocks ++, prefixXor ? prefixXor + offset : 0, carry);
+    }
+
+    if (fullSize < size) {
+        // zero padding matches no delimiter, so the masks of the tail come out clear past size by themselves
+        uint8_t tail [SCAN_BLOCK_SIZE] = {};
+        uint8_t tailXor [SCAN_BLOCK_SIZE];
+
+        memcpy (tail, source + fullSize, size - fullSize);
+        scanBlock (tail, * blocks, prefixXor ? tailXor : 0, carry);
+
+        if (prefixXor) memcpy (prefixXor + fullSize, tailXor, size - fullSize);
+    }
+}
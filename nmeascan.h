@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#if defined (_MSC_VER)
+#include <intrin.h>
+#endif
+
+enum ScanKernel {
+    ScalarScan = 0,
+    Sse2Scan,
+    Avx2Scan,
+    NeonScan,
+};
+
+static size_t const SCAN_BLOCK_SIZE = 64;
+
+// Where the NMEA delimiters are within one 64 byte block; bit i stands for byte i of the block
+struct ScanBlock {
+    uint64_t dollars;
+    uint64_t commas;
+    uint64_t stars;
+    uint64_t crs;
+    uint64_t lfs;
+};
+
+// Index of the lowest set bit; mask must not be 0
+inline unsigned lowestSetBit (uint64_t mask) {
+#if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_ARM64))
+    unsigned long index;
+
+    _BitScanForward64 (& index, mask);
+
+    return (unsigned) index;
+#elif defined (_MSC_VER)
+    unsigned long index;
+
+    if (_BitScanForward (& index, (unsigned long) mask)) return (unsigned) index;
+
+    _BitScanForward (& index, (unsigned long) (mask >> 32));
+
+    return (unsigned) index + 32;
+#else
+    return (unsigned) __builtin_ctzll (mask);
+#endif
+}
+
+// Best kernel the CPU we run on supports; defaultScanKernel detects it once and remembers
+ScanKernel detectScanKernel ();
+ScanKernel defaultScanKernel ();
+const char *scanKernelName (ScanKernel kernel);
+
+// One pass over data: blocks [(size + 63) / 64] get the delimiter masks (bits past size stay clear) and, unless
+// prefixXor is 0, prefixXor [i] gets carry ^ data [0] ^ ... ^ data [i], so the checksum of any span takes two lookups;
+// carry continues the XOR of bytes scanned earlier. Every kernel gives identical results; one this build has no
+// code for falls back to the scalar one.
+void scanNmea (ScanKernel kernel, const char *data, size_t size, ScanBlock *blocks, uint8_t *prefixXor, uint8_t carry = 0);
+
+// What a scan which has already been over a sentence knows about it: bit i of blocks [i / 64] and prefixXor [i]
+// stand for origin [i], for every byte of the sentence
+struct SentenceScan {
+    const char *origin;
+    const ScanBlock *blocks;
+    const uint8_t *prefixXor;
+};
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <locale.h>
+#if defined (__APPLE__)
+#include <xlocale.h>
+#endif
+#include "numparse.h"
+
+namespace {
+    // Significant digits kept for the slow path; strtod needs at most 767 to round any double correctly,
+    // anything past this only matters for inputs sitting exactly on a rounding boundary
+    size_t const MAX_SLOW_DIGITS = 800;
+
+    // 10^0 .. 10^22 are all exact in a double
+    double const EXACT_POWERS_OF_TEN [] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    uint64_t const MAX_EXACT_MANTISSA = 1ull << 53;
+
+    const char *skipBlanks (const char *chr, const char *end, int flags) {
+        if (flags & NumberFlags::NumberSkipBlanks) {
+            while (chr < end && (*chr == ' ' || *chr == '\t')) ++ chr;
+        }
+
+        return chr;
+    }
+
+    bool isDigit (char chr) {
+        return chr >= '0' && chr <= '9';
+    }
+
+#ifdef _WIN32
+    _locale_t cLocale () {
+        static _locale_t locale = _create_locale (LC_NUMERIC, "C");
+
+        return locale;
+    }
+
+    double strtodC (const char *source) {
+        return _strtod_l (source, 0, cLocale ());
+    }
+#else
+    locale_t cLocale () {
+        static locale_t locale = newlocale (LC_NUMERIC_MASK, "C", (locale_t) 0);
+
+        return locale;
+    }
+
+    double strtodC (const char *source) {
+        return strtod_l (source, 0, cLocale ());
+    }
+#endif
+}
+
+const char *parseDouble (const char *begin, const char *end, double& value, int flags) {
+    const char *chr = skipBlanks (begin, end, flags);
+    bool negative = false;
+
+    if (chr < end && (*chr == '-' || *chr == '+')) negative = *chr ++ == '-';
+
+    // digits are collected once: into the 64-bit mantissa for the fast path and as text for the slow one
+    char digits [MAX_SLOW_DIGITS + 1];
+    size_t numOfDigits = 0, mantissaDigits = 0;
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    bool anyDigit = false, truncated = false, pointSeen = false;
+
+    for (; chr < end; ++ chr) {
+        if (isDigit (*chr)) {
+            anyDigit = true;
+
+            if (pointSeen) -- exponent;
+
+            // leading zeros carry no information
+            if (numOfDigits == 0 && *chr == '0') continue;
+
+            if (mantissaDigits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*chr - '0');
+                ++ mantissaDigits;
+            } else if (*chr != '0' || numOfDigits >= MAX_SLOW_DIGITS) {
+                truncated = true;
+            }
+
+            if (numOfDigits < MAX_SLOW_DIGITS) {
+                digits [numOfDigits ++] = *chr;
+            } else {
+                ++ exponent;
+            }
+        } else if (!pointSeen && (*chr == '.' || (*chr == ',' && (flags & NumberFlags::NumberAcceptComma)))) {
+            pointSeen = true;
+        } else {
+            break;
+        }
+    }
+
+    if (!anyDigit) return begin;
+
+    if (chr < end && (*chr == 'e' || *chr == 'E')) {
+        const char *expChr = chr + 1;
+        bool expNegative = false;
+        int64_t expValue = 0;
+
+        if (expChr < end && (*expChr == '-' || *expChr == '+')) expNegative = *expChr ++ == '-';
+
+        // "1e" or "1e+" is the number 1 followed by something else, as strtod reads it
+        if (expChr < end && isDigit (*expChr)) {
+            for (; expChr < end && isDigit (*expChr); ++ expChr) {
+                if (expValue < 100000) expValue = expValue * 10 + (*expChr - '0');
+            }
+
+            exponent += expNegative ? - expValue : expValue;
+            chr = expChr;
+        }
+    }
+
+    if (numOfDigits == 0) {
+        value = negative ? -0.0 : 0.0; return chr;
+    }
+
+    // digits kept in the mantissa set its scale; the rest (zeros, or truncated ones) shift the exponent
+    int64_t fastExponent = exponent + (int64_t) (numOfDigits - mantissaDigits);
+
+    if (!truncated && mantissa <= MAX_EXACT_MANTISSA) {
+        double result = (double) mantissa;
+
+        // a mantissa small enough can take part of a too large exponent and stay exact (Clinger's fast path)
+        while (fastExponent > 22 && result * 10.0 <= (double) MAX_EXACT_MANTISSA) {
+            result *= 10.0;
+            -- fastExponent;
+        }
+
+        if (fastExponent >= -22 && fastExponent <= 22) {
+            result = fastExponent < 0 ? result / EXACT_POWERS_OF_TEN [- fastExponent] : result * EXACT_POWERS_OF_TEN [fastExponent];
+            value = negative ? - result : result;
+
+            return chr;
+        }
+    }
+
+    // "[-]ddd...e<exp>" built from the digits seen; strtod in the C locale does the correctly rounded rest
+    char text [MAX_SLOW_DIGITS + 32];
+    size_t size = 0;
+
+    if (negative) text [size ++] = '-';
+
+    memcpy (text + size, digits, numOfDigits);
+    size += numOfDigits;
+    text [size ++] = 'e';
+
+    int64_t textExponent = exponent;
+
+    if (textExponent < 0) {
+        text [size ++] = '-';
+        textExponent = - textExponent;
+    }
+
+    char expDigits [24];
+    size_t numOfExpDigits = 0;
+
+    do {
+        expDigits [numOfExpDigits ++] = (char) ('0' + textExponent % 10);
+        textExponent /= 10;
+    } while (textExponent > 0);
+
+    while (numOfExpDigits > 0) text [size ++] = expDigits [-- numOfExpDigits];
+
+    text [size] = '\0';
+    value = strtodC (text);
+
+    return chr;
+}
+
+const char *parseInt (const char *begin, const char *end, int64_t& value, int flags) {
+    const char *chr = skipBlanks (begin, end, flags);
+    bool negative = false;
+
+    if (chr < end && (*chr == '-' || *chr == '+')) negative = *chr ++ == '-';
+
+    if (chr >= end || !isDigit (*chr)) return begin;
+
+    uint64_t result = 0;
+    uint64_t limit = negative ? (uint64_t) INT64_MAX + 1 : (uint64_t) INT64_MAX;
+
+    for (; chr < end && isDigit (*chr); ++ chr) {
+        uint64_t digit = (uint64_t) (*chr - '0');
+
+        result = result > (limit - digit) / 10 ? limit : result * 10 + digit;
+    }
+
+    value = negative ? (int64_t) (0 - result) : (int64_t) result;
+
+    return chr;
+}
+
+double toDouble (const char *begin, const char *end, int flags) {
+    double value = 0.0;
+
+    parseDouble (begin, end, value, flags);
+
+    return value;
+}
+
+int toInt (const char *begin, const char *end, int flags) {
+    int64_t value = 0;
+
+    parseInt (begin, end, value, flags);
+
+    if (value > INT_MAX) return INT_MAX;
+    if (value < INT_MIN) return INT_MIN;
+
+    return (int) value;
+}
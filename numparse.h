@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Locale-free number parsing for NMEA fields and JSON, in the spirit of std::from_chars: no allocation, no
+// terminator needed, the decimal point is always '.' whatever setlocale says. Doubles are correctly rounded:
+// the common case (up to 19 significant digits, exponent within the exactly representable powers of ten) is
+// done with one multiplication or division, everything else goes to the C runtime's strtod in the "C" locale.
+
+enum NumberFlags {
+    NumberDefault = 0,
+    NumberSkipBlanks = 1,   // leading spaces and tabs are skipped
+    NumberAcceptComma = 2,  // ',' is taken as the decimal point as well as '.'
+};
+
+// Returns pointer to the first character not used; equals begin (and value is left alone) when there is no number
+const char *parseDouble (const char *begin, const char *end, double& value, int flags = NumberDefault);
+
+// Decimal integer with optional sign; out of range values are clamped
+const char *parseInt (const char *begin, const char *end, int64_t& value, int flags = NumberDefault);
+
+// Whole-string convenience forms; 0 when there is no number, like atof/atoi
+double toDouble (const char *begin, const char *end, int flags = NumberDefault);
+int toInt (const char *begin, const char *end, int flags = NumberDefault);
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <math.h>
+#include "psmack.h"
+
+static constexpr SentenceLiteral<9> PSMACK_HEAD ("$PSMACK,");
+static constexpr SentenceLiteral<6> PSMACK_MIDDLE (",100,");
+
+static char const HEX_DIGITS [] = "0123456789ABCDEF";
+
+void SentenceWriter::integer (int32_t value, int minDigits) {
+    char digits [12];
+    int count = 0;
+    uint32_t absValue = value < 0 ? 0u - (uint32_t) value : (uint32_t) value;
+
+    if (value < 0) put ('-');
+
+    do {
+        digits [count ++] = (char) ('0' + absValue % 10);
+        absValue /= 10;
+    } while (absValue > 0);
+
+    while (count < minDigits) digits [count ++] = '0';
+    while (count > 0) put (digits [-- count]);
+}
+
+void SentenceWriter::fixed2 (int32_t hundredths, bool negative) {
+    uint32_t absValue = hundredths < 0 ? 0u - (uint32_t) hundredths : (uint32_t) hundredths;
+
+    if (hundredths < 0 || negative) put ('-');
+
+    integer ((int32_t) (absValue / 100));
+    put ('.');
+    put ((char) ('0' + (absValue / 10) % 10));
+    put ((char) ('0' + absValue % 10));
+}
+
+void SentenceWriter::hex (uint32_t value, int minDigits) {
+    char digits [8];
+    int count = 0;
+
+    do {
+        digits [count ++] = HEX_DIGITS [value & 15];
+        value >>= 4;
+    } while (value > 0);
+
+    while (count < minDigits) digits [count ++] = '0';
+    while (count > 0) put (digits [-- count]);
+}
+
+size_t SentenceWriter::finish (char *buffer) {
+    uint8_t checksum = crc;
+
+    *pos ++ = '*';
+    *pos ++ = HEX_DIGITS [checksum >> 4];
+    *pos ++ = HEX_DIGITS [checksum & 15];
+    *pos ++ = '\r';
+    *pos ++ = '\n';
+    *pos = '\0';
+
+    return (size_t) (pos - buffer);
+}
+
+int32_t toHundredths (double value) {
+    double magnitude = fabs (value);
+
+    // magnitude * 100 is exactly hundreds + residual; fma gives the part the rounded product lost
+    double hundreds = magnitude * 100.0;
+    double residual = fma (magnitude, 100.0, - hundreds);
+    double whole = floor (hundreds);
+
+    if (hundreds == whole && residual < 0.0) whole -= 1.0;
+
+    // sign of the exact fraction minus one half; both differences are exact, so only a true tie gives 0
+    double aboveHalf = (hundreds - whole - 0.5) + residual;
+    int32_t result = (int32_t) whole;
+
+    if (aboveHalf > 0.0 || (aboveHalf == 0.0 && (result & 1))) ++ result;
+
+    return value < 0.0 ? - result : result;
+}
+
+const char *PsmackFormatter::format (uint16_t lampID, double brg, double elevation, uint32_t status, size_t& sentenceSize) {
+    int32_t intBrg = (int32_t) brg;
+    bool exact = fabs (elevation) < MAX_FIXED2_VALUE;      // false for inf and nan too
+    int32_t elev = exact ? toHundredths (elevation) : 0;
+    bool negative = signbit (elevation) != 0;               // printf keeps the sign of -0.001 and -0.0: "-0.00"
+
+    if (cached && exact && lampID == lastLampID && intBrg == lastBrg && elev == lastElev && negative == lastNegative && status == lastStatus) {
+        ++ reused;
+    } else {
+        SentenceWriter writer (buffer);
+
+        writer.literal (PSMACK_HEAD);
+        writer.integer (lampID, 2);
+        writer.put (',');
+        writer.integer (intBrg);
+        writer.put (',');
+
+        if (exact) {
+            writer.fixed2 (elev, negative);
+        } else {
+            char text [MAX_PSMACK_SIZE];
+
+            snprintf (text, sizeof (text), "%.2f", elevation);
+
+            for (char *chr = text; *chr && writer.pos < buffer + MAX_PSMACK_SIZE - 24; ++ chr) writer.put (*chr);
+        }
+
+        writer.literal (PSMACK_MIDDLE);
+        writer.hex (status);
+
+        size = writer.finish (buffer);
+        cached = true;
+        lastLampID = lampID;
+        lastBrg = intBrg;
+        lastElev = elev;
+        lastNegative = negative;
+        lastStatus = status;
+
+        ++ encoded;
+    }
+
+    sentenceSize = size;
+
+    return buffer;
+}
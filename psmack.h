@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+static size_t const MAX_PSMACK_SIZE = 64;
+static double const MAX_FIXED2_VALUE = 2.0e7;      // elevations formatted by hand below this, by snprintf from it on
+
+// Constant fragment of a sentence; its checksum contribution is known at compile time
+template<size_t N> struct SentenceLiteral {
+    const char (&text) [N];
+    uint8_t crc;
+
+    constexpr SentenceLiteral (const char (&_text) [N]): text (_text), crc (xorOf (_text)) {}
+
+    static constexpr uint8_t xorOf (const char (&_text) [N]) {
+        uint8_t result = 0;
+
+        for (size_t i = 0; i < N - 1; ++ i) {
+            if (_text [i] != '$') result ^= (uint8_t) _text [i];
+        }
+
+        return result;
+    }
+};
+
+// Appends fields to a buffer and keeps the running NMEA checksum as it goes, so nothing is rescanned afterwards
+struct SentenceWriter {
+    char *pos;
+    uint8_t crc;
+
+    SentenceWriter (char *buffer): pos (buffer), crc (0) {}
+
+    template<size_t N> void literal (const SentenceLiteral<N>& fragment) {
+        for (size_t i = 0; i < N - 1; ++ i) *pos ++ = fragment.text [i];
+
+        crc ^= fragment.crc;
+    }
+
+    void put (char chr) {
+        *pos ++ = chr;
+        crc ^= (uint8_t) chr;
+    }
+
+    void integer (int32_t value, int minDigits = 1);
+    void fixed2 (int32_t hundredths, bool negative = false);   // negative: "-" even when hundredths is 0
+    void hex (uint32_t value, int minDigits = 2);
+
+    // "*hh\r\n"; returns total sentence size
+    size_t finish (char *buffer);
+};
+
+// Builds "$PSMACK,<lamp>,<brg>,<elev>,100,<status>*hh\r\n" byte for byte the way sprintf ("%02d,%d,%.2f,100,%02X") did,
+// but with no format string parsing. When nothing has changed since the previous call for the same lamp,
+// the bytes encoded last time are returned as they are.
+struct PsmackFormatter {
+    char buffer [MAX_PSMACK_SIZE];
+    size_t size;
+    bool cached;
+    uint16_t lastLampID;
+    int32_t lastBrg;
+    int32_t lastElev;
+    bool lastNegative;
+    uint32_t lastStatus;
+    uint64_t encoded;
+    uint64_t reused;
+
+    PsmackFormatter (): size (0), cached (false), encoded (0), reused (0) {}
+
+    const char *format (uint16_t lampID, double brg, double elevation, uint32_t status, size_t& sentenceSize);
+};
+
+// Elevation in hundredths of a degree, rounded as printf ("%.2f") rounds: the exact binary value to the nearest,
+// exact ties to even. |value| must be under MAX_FIXED2_VALUE.
+int32_t toHundredths (double value);
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct RenderColor {
+    uint8_t red, green, blue;
+};
+
+struct RenderPoint {
+    long x, y;
+};
+
+// Right and bottom are exclusive, as with GDI
+struct RenderRect {
+    long left, top, right, bottom;
+};
+
+struct RenderPaint {
+    RenderColor line;
+    int lineWidth;          // 0 for no outline
+    RenderColor fill;
+};
+
+// What the lamp display needs to draw, on whatever surface: the GDI one in the window, a memory image elsewhere
+struct Renderer {
+    virtual ~Renderer () {}
+
+    virtual long width () = 0;
+    virtual long height () = 0;
+
+    virtual void fillRect (const RenderRect& rect, RenderColor color) = 0;
+
+    // Ellipse filling bounds, with an outline the line width wide along its edge
+    virtual void ellipse (const RenderRect& bounds, const RenderPaint& paint) = 0;
+
+    // Closed polygon, filled by the alternate (even-odd) rule
+    virtual void polygon (const RenderPoint *points, size_t count, const RenderPaint& paint) = 0;
+};
+
+enum SpanKernel {
+    ScalarSpan = 0,
+    Sse2Span,
+    Avx2Span,
+    NeonSpan,
+};
+
+// Best kernel the CPU we run on supports; defaultSpanKernel detects it once and remembers
+SpanKernel detectSpanKernel ();
+SpanKernel defaultSpanKernel ();
+const char *spanKernelName (SpanKernel kernel);
+
+// Sets count pixels to value; a kernel this build has no code for falls back to the scalar one
+void fillSpan (SpanKernel kernel, uint32_t *pixels, size_t count, uint32_t value);
+
+// Pixel as it lies in memory: red, green, blue, alpha bytes
+uint32_t packPixel (RenderColor color);
+RenderColor unpackPixel (uint32_t pixel);
+
+// Draws into an RGBA image in memory, on any platform; every primitive comes down to horizontal spans
+struct SoftwareRenderer: Renderer {
+    long imageWidth, imageHeight;
+    std::vector<uint32_t> pixels;       // row after row, no padding
+    SpanKernel kernel;
+    std::vector<double> crossings;      // scratch for polygon scanlines
+
+    SoftwareRenderer (long _width = 0, long _height = 0, SpanKernel _kernel = defaultSpanKernel ());
+
+    void resize (long _width, long _height);
+
+    virtual long width () { return imageWidth; }
+    virtual long height () { return imageHeight; }
+
+    virtual void fillRect (const RenderRect& rect, RenderColor color);
+    virtual void ellipse (const RenderRect& bounds, const RenderPaint& paint);
+    virtual void polygon (const RenderPoint *points, size_t count, const RenderPaint& paint);
+
+    // Binary PPM (P6), alpha left out
+    bool writePpm (const char *path);
+    bool readPpm (const char *path);
+
+    void fillRow (long y, long left, long right, uint32_t value);
+    void fillEllipse (double centerX, double centerY, double radiusX, double radiusY, uint32_t value);
+    void drawLine (RenderPoint from, RenderPoint to, int lineWidth, uint32_t value);
+};
+
+#ifdef _WIN32
+static size_t const MAX_GDI_POLYGON_SIZE = 16;      // points; larger polygons are not drawn
+
+// Draws into a device context; pens and brushes are made on the first use of a paint and kept
+struct GdiRenderer: Renderer {
+    struct GdiObjects {
+        RenderPaint paint;
+        void *pen;
+        void *brush;
+    };
+
+    void *dc;
+    long surfaceWidth, surfaceHeight;
+    std::vector<GdiObjects> objects;
+
+    GdiRenderer (): dc (0), surfaceWidth (0), surfaceHeight (0) {}
+    virtual ~GdiRenderer ();
+
+    void attach (void *_dc, long _width, long _height);
+
+    virtual long width () { return surfaceWidth; }
+    virtual long height () { return surfaceHeight; }
+
+    virtual void fillRect (const RenderRect& rect, RenderColor color);
+    virtual void ellipse (const RenderRect& bounds, const RenderPaint& paint);
+    virtual void polygon (const RenderPoint *points, size_t count, const RenderPaint& paint);
+
+    GdiObjects& select (const RenderPaint& paint);
+};
+#endif
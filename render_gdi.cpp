@@ -0,0 +1,81 @@
+#ifdef _WIN32
+
+#include <Windows.h>
+#include "render.h"
+
+namespace {
+    COLORREF toColorRef (RenderColor color) {
+        return RGB (color.red, color.green, color.blue);
+    }
+
+    bool samePaint (const RenderPaint& first, const RenderPaint& second) {
+        return first.lineWidth == second.lineWidth &&
+            toColorRef (first.line) == toColorRef (second.line) &&
+            toColorRef (first.fill) == toColorRef (second.fill);
+    }
+}
+
+GdiRenderer::~GdiRenderer () {
+    // a paint with no outline has the stock null pen, which is not ours to delete
+    for (auto& item: objects) {
+        if (item.paint.lineWidth > 0) DeleteObject ((HGDIOBJ) item.pen);
+        DeleteObject ((HGDIOBJ) item.brush);
+    }
+}
+
+void GdiRenderer::attach (void *_dc, long _width, long _height) {
+    dc = _dc;
+    surfaceWidth = _width;
+    surfaceHeight = _height;
+}
+
+GdiRenderer::GdiObjects& GdiRenderer::select (const RenderPaint& paint) {
+    GdiObjects *found = 0;
+
+    // a display uses a handful of paints, a linear search finds them quicker than anything else
+    for (auto& item: objects) {
+        if (samePaint (item.paint, paint)) {
+            found = & item; break;
+        }
+    }
+
+    if (!found) {
+        HPEN pen = paint.lineWidth > 0 ? CreatePen (PS_SOLID, paint.lineWidth, toColorRef (paint.line)) : (HPEN) GetStockObject (NULL_PEN);
+
+        objects.push_back (GdiObjects { paint, (void *) pen, (void *) CreateSolidBrush (toColorRef (paint.fill)) });
+
+        found = & objects.back ();
+    }
+
+    SelectObject ((HDC) dc, (HGDIOBJ) found->pen);
+    SelectObject ((HDC) dc, (HGDIOBJ) found->brush);
+
+    return *found;
+}
+
+void GdiRenderer::fillRect (const RenderRect& rect, RenderColor color) {
+    RECT area { rect.left, rect.top, rect.right, rect.bottom };
+
+    FillRect ((HDC) dc, & area, (HBRUSH) select (RenderPaint { color, 0, color }).brush);
+}
+
+void GdiRenderer::ellipse (const RenderRect& bounds, const RenderPaint& paint) {
+    select (paint);
+    Ellipse ((HDC) dc, bounds.left, bounds.top, bounds.right, bounds.bottom);
+}
+
+void GdiRenderer::polygon (const RenderPoint *points, size_t count, const RenderPaint& paint) {
+    POINT vertices [MAX_GDI_POLYGON_SIZE];
+
+    if (count > MAX_GDI_POLYGON_SIZE) return;
+
+    for (size_t i = 0; i < count; ++ i) {
+        vertices [i].x = points [i].x;
+        vertices [i].y = points [i].y;
+    }
+
+    select (paint);
+    Polygon ((HDC) dc, vertices, (int) count);
+}
+
+#endif
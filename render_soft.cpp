@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "render.h"
+#include "motion.h"
+
+#if defined (_M_X64) || defined (_M_IX86) || defined (__x86_64__) || defined (__i386__)
+#define SPAN_X86
+#include <immintrin.h>
+#elif defined (__aarch64__) || defined (_M_ARM64)
+#define SPAN_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined (__GNUC__) || defined (__clang__)
+#define TARGET_AVX2 __attribute__ ((target ("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+namespace {
+    typedef void (*SpanFiller) (uint32_t *pixels, size_t count, uint32_t value);
+
+    void fillSpanScalar (uint32_t *pixels, size_t count, uint32_t value) {
+        for (size_t i = 0; i < count; ++ i) pixels [i] = value;
+    }
+
+#if defined (SPAN_X86)
+    void fillSpanSse2 (uint32_t *pixels, size_t count, uint32_t value) {
+        __m128i const pattern = _mm_set1_epi32 ((int) value);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            _mm_storeu_si128 ((__m128i *) (pixels + i), pattern);
+            _mm_storeu_si128 ((__m128i *) (pixels + i + 4), pattern);
+            _mm_storeu_si128 ((__m128i *) (pixels + i + 8), pattern);
+            _mm_storeu_si128 ((__m128i *) (pixels + i + 12), pattern);
+        }
+        for (; i + 4 <= count; i += 4) _mm_storeu_si128 ((__m128i *) (pixels + i), pattern);
+        for (; i < count; ++ i) pixels [i] = value;
+    }
+
+    TARGET_AVX2 void fillSpanAvx2 (uint32_t *pixels, size_t count, uint32_t value) {
+        __m256i const pattern = _mm256_set1_epi32 ((int) value);
+        size_t i = 0;
+
+        for (; i + 32 <= count; i += 32) {
+            _mm256_storeu_si256 ((__m256i *) (pixels + i), pattern);
+            _mm256_storeu_si256 ((__m256i *) (pixels + i + 8), pattern);
+            _mm256_storeu_si256 ((__m256i *) (pixels + i + 16), pattern);
+            _mm256_storeu_si256 ((__m256i *) (pixels + i + 24), pattern);
+        }
+        for (; i + 8 <= count; i += 8) _mm256_storeu_si256 ((__m256i *) (pixels + i), pattern);
+        for (; i < count; ++ i) pixels [i] = value;
+    }
+#endif
+
+#if defined (SPAN_NEON)
+    void fillSpanNeon (uint32_t *pixels, size_t count, uint32_t value) {
+        uint32x4_t const pattern = vdupq_n_u32 (value);
+        size_t i = 0;
+
+        for (; i + 16 <= count; i += 16) {
+            vst1q_u32 (pixels + i, pattern);
+            vst1q_u32 (pixels + i + 4, pattern);
+            vst1q_u32 (pixels + i + 8, pattern);
+            vst1q_u32 (pixels + i + 12, pattern);
+        }
+        for (; i + 4 <= count; i += 4) vst1q_u32 (pixels + i, pattern);
+        for (; i < count; ++ i) pixels [i] = value;
+    }
+#endif
+
+    SpanFiller spanFiller (SpanKernel kernel) {
+        switch (kernel) {
+#if defined (SPAN_X86)
+            case SpanKernel::Sse2Span: return fillSpanSse2;
+            case SpanKernel::Avx2Span: return fillSpanAvx2;
+#endif
+#if defined (SPAN_NEON)
+            case SpanKernel::NeonSpan: return fillSpanNeon;
+#endif
+            default: return fillSpanScalar;
+        }
+    }
+
+    // First pixel whose center lies at or past x
+    long pixelFrom (double x) {
+        return (long) ceil (x - 0.5);
+    }
+
+    // Part of the segment from + t * delta, 0 <= t <= 1, inside [left, right] x [top, bottom] (Liang-Barsky);
+    // false when none of it is
+    bool clipSegment (double x0, double y0, double dx, double dy, double left, double top, double right, double bottom, double& enter, double& leave) {
+        double const p [4] = { - dx, dx, - dy, dy };
+        double const q [4] = { x0 - left, right - x0, y0 - top, bottom - y0 };
+
+        enter = 0.0;
+        leave = 1.0;
+
+        for (int i = 0; i < 4; ++ i) {
+            if (p [i] == 0.0) {
+                if (q [i] < 0.0) return false;
+                continue;
+            }
+
+            double t = q [i] / p [i];
+
+            if (p [i] < 0.0) {
+                if (t > leave) return false;
+                if (t > enter) enter = t;
+            } else {
+                if (t < enter) return false;
+                if (t < leave) leave = t;
+            }
+        }
+
+        return true;
+    }
+}
+
+SpanKernel detectSpanKernel () {
+#if defined (SPAN_X86)
+    switch (detectMotionKernel ()) {
+        case MotionKernel::Avx2Kernel: return SpanKernel::Avx2Span;
+        case MotionKernel::Sse2Kernel: return SpanKernel::Sse2Span;
+        default: return SpanKernel::ScalarSpan;
+    }
+#elif defined (SPAN_NEON)
+    return SpanKernel::NeonSpan;
+#else
+    return SpanKernel::ScalarSpan;
+#endif
+}
+
+SpanKernel defaultSpanKernel () {
+    static SpanKernel const kernel = detectSpanKernel ();
+
+    return kernel;
+}
+
+const char *spanKernelName (SpanKernel kernel) {
+    switch (kernel) {
+        case SpanKernel::Sse2Span: return "sse2";
+        case SpanKernel::Avx2Span: return "avx2";
+        case SpanKernel::NeonSpan: return "neon";
+        default: return "scalar";
+    }
+}
+
+void fillSpan (SpanKernel kernel, uint32_t *pixels, size_t count, uint32_t value) {
+    spanFiller (kernel) (pixels, count, value);
+}
+
+uint32_t packPixel (RenderColor color) {
+    uint8_t bytes [4] = { color.red, color.green, color.blue, 255 };
+    uint32_t pixel;
+
+    memcpy (& pixel, bytes, sizeof (pixel));
+
+    return pixel;
+}
+
+RenderColor unpackPixel (uint32_t pixel) {
+    uint8_t bytes [4];
+
+    memcpy (bytes, & pixel, sizeof (bytes));
+
+    return RenderColor { bytes [0], bytes [1], bytes [2] };
+}
+
+SoftwareRenderer::SoftwareRenderer (long _width, long _height, SpanKernel _kernel): imageWidth (0), imageHeight (0), kernel (_kernel) {
+    resize (_width, _height);
+}
+
+void SoftwareRenderer::resize (long _width, long _height) {
+    imageWidth = _width > 0 ? _width : 0;
+    imageHeight = _height > 0 ? _height : 0;
+
+    pixels.assign ((size_t) imageWidth * (size_t) imageHeight, packPixel (RenderColor { 0, 0, 0 }));
+}
+
+void SoftwareRenderer::fillRow (long y, long left, long right, uint32_t value) {
+    if (y < 0 || y >= imageHeight) return;
+    if (left < 0) left = 0;
+    if (right > imageWidth) right = imageWidth;
+    if (left >= right) return;
+
+    fillSpan (kernel, pixels.data () + (size_t) y * (size_t) imageWidth + left, (size_t) (right - left), value);
+}
+
+void SoftwareRenderer::fillRect (const RenderRect& rect, RenderColor color) {
+    uint32_t value = packPixel (color);
+
+    for (long y = rect.top; y < rect.bottom; ++ y) fillRow (y, rect.left, rect.right, value);
+}
+
+void SoftwareRenderer::fillEllipse (double centerX, double centerY, double radiusX, double radiusY, uint32_t value) {
+    if (radiusX <= 0.0 || radiusY <= 0.0) return;
+
+    long top = std::max (pixelFrom (centerY - radiusY), 0L), bottom = std::min (pixelFrom (centerY + radiusY), imageHeight);
+
+    for (long y = top; y < bottom; ++ y) {
+        double dy = ((double) y + 0.5 - centerY) / radiusY;
+
+        if (dy * dy >= 1.0) continue;
+
+        double halfWidth = radiusX * sqrt (1.0 - dy * dy);
+
+        fillRow (y, pixelFrom (centerX - halfWidth), pixelFrom (centerX + halfWidth), value);
+    }
+}
+
+void SoftwareRenderer::ellipse (const RenderRect& bounds, const RenderPaint& paint) {
+    double centerX = (double) (bounds.left + bounds.right) * 0.5;
+    double centerY = (double) (bounds.top + bounds.bottom) * 0.5;
+    double radiusX = (double) (bounds.right - bounds.left) * 0.5;
+    double radiusY = (double) (bounds.bottom - bounds.top) * 0.5;
+
+    // the outline is what is left of the line coloured ellipse once the inner one is filled over it
+    if (paint.lineWidth > 0) fillEllipse (centerX, centerY, radiusX, radiusY, packPixel (paint.line));
+
+    fillEllipse (centerX, centerY, radiusX - paint.lineWidth, radiusY - paint.lineWidth, packPixel (paint.fill));
+}
+
+void SoftwareRenderer::drawLine (RenderPoint from, RenderPoint to, int lineWidth, uint32_t value) {
+    long dx = labs (to.x - from.x), dy = labs (to.y - from.y);
+    long stepX = from.x < to.x ? 1 : -1, stepY = from.y < to.y ? 1 : -1;
+    long offset = (lineWidth - 1) / 2;
+    bool xMajor = dx >= dy;
+    int64_t major = xMajor ? dx : dy, minor = xMajor ? dy : dx;
+    double enter, leave;
+
+    // only steps whose squares can touch the image are visited; the margins absorb the rounding of the clip
+    double margin = (double) lineWidth + 2.0;
+
+    if (!clipSegment ((double) from.x, (double) from.y, (double) (to.x - from.x), (double) (to.y - from.y), - margin, - margin, (double) imageWidth + margin, (double) imageHeight + margin, enter, leave)) return;
+
+    int64_t first = std::max ((int64_t) floor (enter * (double) major) - 2, (int64_t) 0);
+    int64_t last = std::min ((int64_t) ceil (leave * (double) major) + 2, major);
+
+    // Bresenham, a lineWidth square at every step; step k moves k along the major axis and
+    // (2 * minor * k + major) / (2 * major) along the other, which is where the error term walk would have got to
+    int64_t denominator = major > 0 ? 2 * major : 1, numerator = 2 * minor * first + major;
+    int64_t shift = numerator / denominator, remainder = numerator % denominator;
+
+    for (int64_t k = first; k <= last; ++ k) {
+        long x = from.x + stepX * (long) (xMajor ? k : shift), y = from.y + stepY * (long) (xMajor ? shift : k);
+
+        for (long i = 0; i < lineWidth; ++ i) fillRow (y - offset + i, x - offset, x - offset + lineWidth, value);
+
+        remainder += 2 * minor;
+
+        if (remainder >= denominator) {
+            remainder -= denominator; ++ shift;
+        }
+    }
+}
+
+void SoftwareRenderer::polygon (const RenderPoint *points, size_t count, const RenderPaint& paint) {
+    if (count < 2) return;
+
+    long top = points [0].y, bottom = points [0].y;
+
+    for (size_t i = 1; i < count; ++ i) {
+        top = std::min (top, points [i].y);
+        bottom = std::max (bottom, points [i].y);
+    }
+
+    top = std::max (top, 0L);
+    bottom = std::min (bottom, imageHeight);
+
+    uint32_t fill = packPixel (paint.fill);
+
+    // every row is sampled through the pixel centers; edges own their upper end and not the lower one
+    for (long y = top; y < bottom; ++ y) {
+        double sampleY = (double) y + 0.5;
+
+        crossings.clear ();
+
+        for (size_t i = 0; i < count; ++ i) {
+            const RenderPoint& from = points [i];
+            const RenderPoint& to = points [(i + 1) % count];
+
+            if ((from.y <= sampleY) == (to.y <= sampleY)) continue;
+
+            crossings.push_back ((double) from.x + (sampleY - (double) from.y) * (double) (to.x - from.x) / (double) (to.y - from.y));
+        }
+
+        std::sort (crossings.begin (), crossings.end ());
+
+        for (size_t i = 0; i + 1 < crossings.size (); i += 2) fillRow (y, pixelFrom (crossings [i]), pixelFrom (crossings [i + 1]), fill);
+    }
+
+    if (paint.lineWidth > 0) {
+        uint32_t line = packPixel (paint.line);
+
+        for (size_t i = 0; i < count; ++ i) drawLine (points [i], points [(i + 1) % count], paint.lineWidth, line);
+    }
+}
+
+bool SoftwareRenderer::writePpm (const char *path) {
+    FILE *output = fopen (path, "wb");
+
+    if (!output) return false;
+
+    std::vector<uint8_t> row ((size_t) imageWidth * 3);
+    bool result = fprintf (output, "P6\n%ld %ld\n255\n", imageWidth, imageHeight) > 0;
+
+    for (long y = 0; result && y < imageHeight; ++ y) {
+        for (long x = 0; x < imageWidth; ++ x) {
+            RenderColor color = unpackPixel (pixels [(size_t) y * (size_t) imageWidth + x]);
+
+            row [x * 3] = color.red;
+            row [x * 3 + 1] = color.green;
+            row [x * 3 + 2] = color.blue;
+        }
+
+        result = fwrite (row.data (), 1, row.size (), output) == row.size ();
+    }
+
+    return fclose (output) == 0 && result;
+}
+
+bool SoftwareRenderer::readPpm (const char *path) {
+    FILE *input = fopen (path, "rb");
+
+    if (!input) return false;
+
+    long width = 0, height = 0;
+    int maxValue = 0;
+    bool result = fscanf (input, "P6 %ld %ld %d", & width, & height, & maxValue) == 3 && maxValue == 255 && width > 0 && height > 0 && fgetc (input) != EOF;
+
+    if (result) {
+        std::vector<uint8_t> row ((size_t) width * 3);
+
+        resize (width, height);
+
+        for (long y = 0; result && y < height; ++ y) {
+            result = fread (row.data (), 1, row.size (), input) == row.size ();
+
+            for (long x = 0; result && x < width; ++ x) {
+                pixels [(size_t) y * (size_t) width + x] = packPixel (RenderColor { row [x * 3], row [x * 3 + 1], row [x * 3 + 2] });
+            }
+        }
+    }
+
+    fclose (input);
+
+    return result;
+}
@@ -24,6 +24,9 @@
 #define IDC_TOGGLE_POWER_LOSS           117
 
 #define ID_EXIT                         200
+#define ID_CAPTURE                      201
+#define ID_REPLAY                       202
+#define ID_DUMP_LATENCY                 203
 #define ID_EDITING_TEXT                 209
 #define ID_PROMPT                       210
 
@@ -0,0 +1,249 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "scenario.h"
+#include "json_lite.h"
+#include "fleet.h"
+#include "engine.h"
+#include "psmack.h"
+#include "geometry.h"
+
+namespace {
+    double getNumber (json::hashNode *hash, const char *key, double defValue) {
+        json::node *item = (*hash) [key];
+
+        return item && item->type == json::nodeType::number ? ((json::numberNode *) item)->getValue () : defValue;
+    }
+
+    bool hasKey (json::hashNode *hash, const char *key) {
+        json::node *item = (*hash) [key];
+
+        return item && item != json::nothing;
+    }
+
+    uint64_t secondsToNs (double seconds) {
+        return seconds > 0.0 ? (uint64_t) llround (seconds * (double) NS_PER_SEC) : 0;
+    }
+
+    bool loadScenario (json::node *item, size_t index, Scenario& scenario) {
+        if (!item || item->type != json::nodeType::hash) return false;
+
+        json::hashNode *hash = (json::hashNode *) item;
+        json::node *name = (*hash) ["name"];
+        json::node *events = (*hash) ["events"];
+
+        if (name && name->type == json::nodeType::string) {
+            scenario.name = ((json::stringNode *) name)->getValue ();
+        } else {
+            scenario.name = "scenario" + std::to_string (index + 1);
+        }
+
+        scenario.mastHeight = getNumber (hash, "mastHeight", 10.0);
+        scenario.numOfLamps = (size_t) getNumber (hash, "lamps", 1.0);
+        scenario.duration = secondsToNs (getNumber (hash, "duration", (double) (DEFAULT_SCENARIO_DURATION_NS / NS_PER_SEC)));
+
+        if (scenario.numOfLamps < 1) scenario.numOfLamps = 1;
+        if (scenario.numOfLamps > MAX_LAMPS) scenario.numOfLamps = MAX_LAMPS;
+
+        if (!events || events->type != json::nodeType::array) return true;
+
+        for (auto eventItem: *(json::arrayNode *) events) {
+            if (!eventItem || eventItem->type != json::nodeType::hash) continue;
+
+            json::hashNode *eventHash = (json::hashNode *) eventItem;
+            ScenarioEvent event;
+
+            memset (& event, 0, sizeof (event));
+
+            event.time = secondsToNs (getNumber (eventHash, "at", 0.0));
+
+            if (hasKey (eventHash, "fault")) {
+                event.type = ScenarioEventType::ToggleFault;
+                event.lampID = (uint16_t) getNumber (eventHash, "lamp", 1.0);
+                event.faults = (uint32_t) getNumber (eventHash, "fault", 0.0);
+            } else if (hasKey (eventHash, "mastHeight")) {
+                event.type = ScenarioEventType::ChangeMastHeight;
+                event.mastHeight = getNumber (eventHash, "mastHeight", scenario.mastHeight);
+            } else {
+                event.type = ScenarioEventType::RequestPosition;
+                event.command.lampID = (uint16_t) getNumber (eventHash, "lamp", 1.0);
+                event.command.brg = getNumber (eventHash, "brg", 0.0);
+                event.command.focus = (uint8_t) getNumber (eventHash, "focus", 99.0);
+
+                if (hasKey (eventHash, "range")) {
+                    event.range = getNumber (eventHash, "range", MAX_RANGE);
+                } else {
+                    event.range = -1.0;
+                    event.command.elev = getNumber (eventHash, "elev", 0.25);
+                }
+            }
+
+            scenario.events.push_back (event);
+        }
+
+        // events are applied in time order whatever order the file lists them in
+        std::stable_sort (scenario.events.begin (), scenario.events.end (), [] (const ScenarioEvent& first, const ScenarioEvent& second) {
+            return first.time < second.time;
+        });
+
+        return true;
+    }
+
+    // Shortest signed turn from actual to requested; an exact half turn counts as positive, like the slew rules
+    double bearingError (double requested, double actual) {
+        double error = fmod (requested - actual, 360.0);
+
+        if (error > 180.0) error -= 360.0;
+        if (error <= -180.0) error += 360.0;
+
+        return error;
+    }
+
+    // Direction each lamp was approaching its target from; an error of the opposite sign means it went past
+    struct Approach {
+        double brgError;
+        double rangeError;
+    };
+
+    // Updates the worst overshoot seen so far; returns true if every lamp is where it was asked to be,
+    // to the resolution of the $PSMACK sentence
+    bool trackLamps (LampFleet& fleet, std::vector<Approach>& approach, ScenarioResult& result) {
+        bool settled = true;
+
+        for (size_t i = 0; i < fleet.size (); ++ i) {
+            double brgError = bearingError (fleet.requestedBrg [i], fleet.actualBrg [i]);
+            double rangeError = elevation2range (fleet.mastHeight, fleet.requestedElev [i]) - elevation2range (fleet.mastHeight, fleet.actualElev [i]);
+
+            if (brgError * approach [i].brgError < 0.0) result.brgOvershoot = std::max (result.brgOvershoot, fabs (brgError));
+            if (rangeError * approach [i].rangeError < 0.0) result.rangeOvershoot = std::max (result.rangeOvershoot, fabs (rangeError));
+
+            if (brgError != 0.0) approach [i].brgError = brgError;
+            if (rangeError != 0.0) approach [i].rangeError = rangeError;
+
+            if (fabs (brgError) >= SETTLED_TOLERANCE || fabs (fleet.requestedElev [i] - fleet.actualElev [i]) >= SETTLED_TOLERANCE) settled = false;
+        }
+
+        return settled;
+    }
+
+    void resetApproach (LampFleet& fleet, size_t index, std::vector<Approach>& approach) {
+        approach [index].brgError = bearingError (fleet.requestedBrg [index], fleet.actualBrg [index]);
+        approach [index].rangeError = elevation2range (fleet.mastHeight, fleet.requestedElev [index]) - elevation2range (fleet.mastHeight, fleet.actualElev [index]);
+    }
+}
+
+bool loadScenarios (const char *path, std::vector<Scenario>& scenarios) {
+    FILE *file = fopen (path, "rb");
+
+    if (!file) return false;
+
+    std::string source;
+    char buffer [4096];
+    size_t bytesRead;
+
+    while ((bytesRead = fread (buffer, 1, sizeof (buffer), file)) > 0) source.append (buffer, bytesRead);
+
+    fclose (file);
+
+    int nextChar = 0;
+    json::node *root = json::parse ((char *) source.c_str (), nextChar);
+    bool result = true;
+
+    if (!root) return false;
+
+    if (root->type == json::nodeType::array) {
+        for (auto item: *(json::arrayNode *) root) {
+            Scenario scenario;
+
+            if (loadScenario (item, scenarios.size (), scenario)) {
+                scenarios.push_back (scenario);
+            } else {
+                result = false;
+            }
+        }
+    } else {
+        Scenario scenario;
+
+        if (loadScenario (root, scenarios.size (), scenario)) {
+            scenarios.push_back (scenario);
+        } else {
+            result = false;
+        }
+    }
+
+    delete root;
+
+    return result;
+}
+
+void runScenario (const Scenario& scenario, ScenarioResult& result, ConversionMode conversion) {
+    LampFleet fleet (scenario.numOfLamps, scenario.mastHeight);
+    MotionEngine engine (fleet, 0, DEFAULT_SLEW_INTERVAL_NS);
+    std::vector<PsmackFormatter> formatters (fleet.size ());
+    std::vector<Approach> approach (fleet.size ());
+    size_t nextEvent = 0;
+    bool wasSettled = false;
+
+    memset (& result, 0, sizeof (result));
+
+    fleet.conversion = conversion;
+
+    for (size_t i = 0; i < fleet.size (); ++ i) resetApproach (fleet, i, approach);
+
+    while (true) {
+        // events falling due before this tick take effect before lamps move, same as commands read between watchdog ticks
+        for (; nextEvent < scenario.events.size () && scenario.events [nextEvent].time <= engine.simTime; ++ nextEvent) {
+            const ScenarioEvent& event = scenario.events [nextEvent];
+
+            switch (event.type) {
+                case ScenarioEventType::RequestPosition:
+                    if (fleet.hasLamp (event.command.lampID)) {
+                        LampCommand command = event.command;
+
+                        // a range is turned into elevation with the mast height in force when the request arrives
+                        if (event.range >= 0.0) command.elev = range2elevation (fleet.mastHeight, event.range);
+
+                        fleet.apply (command);
+                        resetApproach (fleet, fleet.indexOf (event.command.lampID), approach);
+                    }
+                    break;
+                case ScenarioEventType::ToggleFault:
+                    if (fleet.hasLamp (event.lampID)) fleet.status [fleet.indexOf (event.lampID)] ^= event.faults;
+                    break;
+                case ScenarioEventType::ChangeMastHeight:
+                    fleet.mastHeight = event.mastHeight;
+                    for (size_t i = 0; i < fleet.size (); ++ i) resetApproach (fleet, i, approach);
+                    break;
+            }
+        }
+
+        engine.step (SENTENCE_INTERVAL_NS);
+
+        bool settled = trackLamps (fleet, approach, result);
+
+        if (settled && !wasSettled) result.convergenceTime = engine.simTime;
+
+        wasSettled = settled;
+
+        for (size_t i = 0; i < fleet.size (); ++ i) {
+            size_t size;
+
+            formatters [i].format ((uint16_t) (i + 1), fleet.actualBrg [i], fleet.actualElev [i], fleet.status [i], size);
+
+            ++ result.sentences;
+            result.sentenceBytes += size;
+        }
+
+        if (settled && nextEvent >= scenario.events.size ()) {
+            result.converged = true; break;
+        }
+
+        if (engine.simTime >= scenario.duration) break;
+    }
+
+    result.simTime = engine.simTime;
+    result.steps = engine.steps;
+
+    for (auto& formatter: formatters) result.sentencesEncoded += formatter.encoded;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "lamp.h"
+#include "conversion.h"
+
+static uint64_t const DEFAULT_SCENARIO_DURATION_NS = 3600ull * 1000000000ull;
+static uint64_t const SENTENCE_INTERVAL_NS = 250000000ull;
+static double const SETTLED_TOLERANCE = 0.005;     // degrees; below what $PSMACK can show
+
+enum ScenarioEventType {
+    RequestPosition = 0,
+    ToggleFault,
+    ChangeMastHeight,
+};
+
+struct ScenarioEvent {
+    uint64_t time;              // ns since the scenario start
+    ScenarioEventType type;
+    LampCommand command;        // RequestPosition
+    double range;               // RequestPosition, metres; negative when the event gave elevation directly
+    uint16_t lampID;            // ToggleFault
+    uint32_t faults;            // ToggleFault, LampStatus bits flipped
+    double mastHeight;          // ChangeMastHeight
+};
+
+// A scenario file holds either one object or an array of them:
+//   {"name": "sweep", "mastHeight": 10, "lamps": 2, "duration": 600,
+//    "events": [{"at": 0, "lamp": 1, "brg": 90, "range": 1500, "focus": 99},
+//               {"at": 5, "lamp": 2, "fault": 1},
+//               {"at": 30, "mastHeight": 12}]}
+// Times are in seconds; "elev" may be given instead of "range".
+struct Scenario {
+    std::string name;
+    double mastHeight;
+    size_t numOfLamps;
+    uint64_t duration;          // ns of simulated time after which an unconverged scenario gives up
+    std::vector<ScenarioEvent> events;
+
+    Scenario (): mastHeight (10.0), numOfLamps (1), duration (DEFAULT_SCENARIO_DURATION_NS) {}
+};
+
+struct ScenarioResult {
+    bool converged;
+    uint64_t convergenceTime;   // ns since the start until every lamp last settled on its requested position
+    uint64_t simTime;
+    uint64_t steps;
+    double brgOvershoot;        // degrees past the requested bearing, worst lamp
+    double rangeOvershoot;      // metres past the requested range, worst lamp
+    uint64_t sentences;
+    uint64_t sentenceBytes;
+    uint64_t sentencesEncoded;  // the rest were cache hits in the formatter
+};
+
+// Appends every scenario found in the file; returns false if the file cannot be read or parsed
+bool loadScenarios (const char *path, std::vector<Scenario>& scenarios);
+
+// Simulates the scenario as fast as the CPU allows, emitting one $PSMACK per lamp per SENTENCE_INTERVAL_NS
+// the way the window's watchdog does
+void runScenario (const Scenario& scenario, ScenarioResult& result, ConversionMode conversion = ConversionMode::FastConversion);
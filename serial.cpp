@@ -5,143 +5,45 @@
 #include <vector>
 #include <thread>
 #include "defs.h"
+#include "nmea.h"
 
-const uint8_t ASCII_BEL = 0x07;
-const uint8_t ASCII_BS = 0x08;
-const uint8_t ASCII_LF = 0x0A;
-const uint8_t ASCII_CR = 0x0D;
-const uint8_t ASCII_XON = 0x11;
-const uint8_t ASCII_XOFF = 0x13;
-
-uint8_t calcCrc (char *sentence) {
-    uint8_t crc = sentence [1];
-
-    for (int i = 2; sentence [i] != '*' && i < 81; crc ^= sentence [i++]);
-
-    return crc;
+void registerSentenceHandlers (Ctx *ctx) {
+    registerLampCommandHandlers (ctx->dispatcher, ctx->fleet, ctx->commands);
 }
 
-void finalizeSendSentence (char *sentence, Ctx *ctx) {
-    bool fakeMode = ctx->outputFlags & OutputFlags::FAKE_MODE;
-    bool copyToConsole = ctx->outputFlags & OutputFlags::COPY_TO_CONCOLE;
-    char tail [10];
-
-    sprintf (tail, "%02X\r\n", calcCrc (sentence));
-    strcat (sentence, tail);
-
-    unsigned long bytesSent, size;
-
-    //if (copyToConsole) addToConsole (sentence, ctx);
+// Runs on the UI thread, the only owner of the requested position
+void applyPendingCommands (Ctx *ctx) {
+    uint32_t taken = ctx->commands.taken [ctx->shownLamp];
 
-    if (!fakeMode && ctx->port != INVALID_HANDLE_VALUE) {
-        size = strlen (sentence);
-        if (ctx->locker) ctx->lock ();
-        WriteFile (ctx->port, sentence, size, & bytesSent, 0);
-        if (ctx->locker) ctx->unlock ();
-    }
-}
-
-void sendLampSentence (double brg, double elevation, uint32_t status, Ctx *ctx) {
-    char sentence [100];
-    sprintf (sentence, "$PSMACK,01,%d,%.2f,100,%02X*", (int) brg, elevation /*+ 45.0*/, status);
-    finalizeSendSentence (sentence, ctx);
-}
+    applyPendingCommands (ctx->commands, ctx->fleet);
 
-uint8_t htodec (char chr) {
-    if (chr >= '0' && chr <= '9') return chr - '0';
-    if (chr >= 'A' && chr <= 'F') return chr - 'A' + 10;
-    if (chr >= 'a' && chr <= 'f') return chr - 'a' + 10;
-    return 0;
+    // the slot sequence moves on only when a command for the lamp was applied
+    if (ctx->commands.taken [ctx->shownLamp] != taken) ctx->bindings.changed (BoundSource::REQUESTED_POSITION);
 }
 
-int splitFields (char *source, std::vector<std::string>& fields) {
-    int count = 1;
-    uint8_t actualCrc = calcCrc (source);
-
-    fields.clear ();
-
-    std::string field;
-
-    for (char *chr = source + 1; *chr; ++ chr) {
-        if (*chr == ',') {
-            fields.emplace_back (field.c_str ());
-            field.clear ();
-        } else if (*chr == '*') {
-            fields.emplace_back (field.c_str ());
-            uint8_t crc = htodec (chr [1]) * 16 + htodec (chr [2]);
-
-            if (crc != actualCrc) return 0;
+DWORD readerProc (void *param) {
+    Ctx *ctx = (Ctx *) param;
 
-            *chr = '\0';
-        } else {
-            field += *chr;
-        }
-    }
+    runCommandReader (ctx->link, ctx->dispatcher, ctx->commands, WAIT_FOREVER, [ctx] (char *chunk, size_t) {
+        if (ctx->outputFlags & OutputFlags::COPY_TO_CONCOLE) addToConsole (chunk, ctx);
+    });
 
-    return fields.size ();
+    return 0;
 }
 
-void parseCtlUnitData (char *source, Ctx *ctx) {
-    std::vector<std::string> fields;
-    int numOfFields = splitFields (source, fields);
-
-    if (numOfFields > 4) {
-        int lampID = atoi (fields [0].c_str ());
-        if (lampID != 1) {
-            printf ("Invalid lamp %d\n", lampID); return;
-        }
-
-        ctx->requestedElev = atof (fields [2].c_str ()) /*- 45.0*/;
-        ctx->requestedBrg = atof (fields [1].c_str ());
-        ctx->requestedFocus = std::atoi (fields [3].c_str ());
-    }
+void startReader (Ctx *ctx) {
+    ctx->reader = CreateThread (0, 0, readerProc, ctx, 0, 0);
 }
 
-void readAvailableData (Ctx *ctx) {
-    unsigned long errorFlags, bytesRead;
-    COMSTAT commState;
-    char buffer [5000];
-
-    do {
-        ClearCommError (ctx->port, & errorFlags, & commState);
-
-        bool overflow = (errorFlags & (CE_RXOVER | CE_OVERRUN)) != 0L;
-
-        if (commState.cbInQue > 0) {
-            if (ctx->locker) ctx->lock ();
-            auto result = ReadFile (ctx->port, buffer, commState.cbInQue, & bytesRead, NULL);
-            if (ctx->locker) ctx->unlock ();
-            if (result && bytesRead > 0) {
-                buffer [bytesRead] = '\0';
-
-                if (*buffer) {
-                    if (ctx->outputFlags & OutputFlags::COPY_TO_CONCOLE) {
-                        addToConsole (buffer, ctx);
-                    }
-
-                    parseCtlUnitData (buffer, ctx);
-                }
-            }
+void stopReader (Ctx *ctx) {
+    if (ctx->reader) {
+        ctx->link.interrupt ();
 
-            Sleep (0);
-        }
-    } while (commState.cbInQue > 0);
-}
-
-DWORD readerProc (void *param) {
-    Ctx *ctx = (Ctx *) param;
-    while (ctx->keepRunning) {
-        if ((ctx->outputFlags & OutputFlags::FAKE_MODE) == 0 && ctx->port != INVALID_HANDLE_VALUE) {
-            readAvailableData (ctx);
-        }
+        WaitForSingleObject (ctx->reader, INFINITE);
+        CloseHandle (ctx->reader);
 
-        Sleep (1);
+        ctx->reader = 0;
     }
-    return 0;
-}
-
-void startReader (Ctx *ctx) {
-    ctx->reader = CreateThread (0, 0, readerProc, ctx, 0, 0);
 }
 
 void getSerialPortsList (std::vector<std::string>& ports) {
@@ -168,46 +70,43 @@ void getSerialPortsList (std::vector<std::string>& ports) {
     }
 }
 
+static void startLink (Ctx *ctx, Transport *transport) {
+    ctx->link.attach (transport);
+    ctx->transmitter.start (& ctx->link);
+
+    if (!(ctx->outputFlags & OutputFlags::FAKE_MODE)) ctx->telemetry.start (& ctx->transmitter);
+
+    startReader (ctx);
+}
+
 bool openPort (Ctx *ctx) {
     auto selection = SendMessage (ctx->portSelector, CB_GETCURSEL, 0, 0);
     auto portNo = SendMessage (ctx->portSelector, CB_GETITEMDATA, selection, 0);
     char portName [100];
     sprintf (portName, "\\\\.\\COM%Id", portNo);
-    
-    ctx->port = CreateFile (portName, GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, 0, 0);
-
-    bool result = ctx->port != INVALID_HANDLE_VALUE;
 
-    if (result) {
-        DCB dcb;
+    Transport *transport = openSerialTransport (portName, CBR_115200);
 
-        SetupComm (ctx->port, 4096, 4096);
-        PurgeComm (ctx->port, PURGE_TXABORT | PURGE_RXABORT | PURGE_TXCLEAR | PURGE_RXCLEAR);
+    if (transport) startLink (ctx, transport);
 
-        memset (& dcb, 0, sizeof (dcb));
+    return transport != 0;
+}
 
-        GetCommState (ctx->port, & dcb);
+// Runs a capture through the receive path in place of a port; closePort ends it the same way
+bool openReplay (Ctx *ctx, const char *path, double speed) {
+    Transport *transport = openReplayTransport (path, speed);
 
-        dcb.BaudRate = CBR_115200;
-        dcb.ByteSize = 8;
-        dcb.StopBits = ONESTOPBIT;
-        dcb.Parity = NOPARITY;
-        dcb.fBinary = 1;
-        dcb.fParity = 1;
-        dcb.fInX =
-        dcb.fOutX = 1;
-        dcb.XonChar = ASCII_XON;
-        dcb.XoffChar = ASCII_XOFF;
-        dcb.XonLim = 100;
-        dcb.XoffLim = 100;
+    if (transport) startLink (ctx, transport);
 
-        if (!SetCommState (ctx->port, & dcb)) {
-            CloseHandle (ctx->port);
+    return transport != 0;
+}
 
-            ctx->port = INVALID_HANDLE_VALUE;
-            result = false;
-        }
-    }
+// The reader, the telemetry scheduler and the transmitter are all joined before the transport goes away,
+// so no lock is needed around the port itself
+void closePort (Ctx *ctx) {
+    stopReader (ctx);
+    ctx->telemetry.stop ();
+    ctx->transmitter.stop ();
 
-    return result;
+    ctx->link.close ();
 }
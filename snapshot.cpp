@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include "display.h"
+#include "render.h"
+#include "fleet.h"
+
+// lampsnap: draws the lamp display with the software renderer, no window needed. Writes a PPM snapshot,
+// compares one against a reference image, or measures frames per second at several sizes.
+
+struct SnapshotOptions {
+    long size;
+    double mastHeight;
+    double actualBrg, actualElev;
+    double requestedBrg, requestedElev;
+    const char *outputPath;
+    const char *referencePath;
+    double benchmarkSeconds;
+    bool allKernels;
+
+    SnapshotOptions ():
+        size (512),
+        mastHeight (10.0),
+        actualBrg (30.0),
+        actualElev (0.5),
+        requestedBrg (75.0),
+        requestedElev (0.3),
+        outputPath (0),
+        referencePath (0),
+        benchmarkSeconds (0.0),
+        allKernels (false) {}
+};
+
+void showUsage () {
+    printf (
+        "Usage: lampsnap [-s size] [-m mast] [-a brg elev] [-r brg elev] [-o out.ppm] [-c reference.ppm] [-b seconds] [-k]\n"
+        "  -s  display size in pixels, 512 by default\n"
+        "  -m  mast height, 10 m by default\n"
+        "  -a  actual bearing and elevation in degrees\n"
+        "  -r  requested bearing and elevation in degrees\n"
+        "  -o  write the snapshot to a PPM file\n"
+        "  -c  compare the snapshot with a PPM file, exit status 1 when they differ\n"
+        "  -b  benchmark for this long per size instead, 256 to 2048 pixels\n"
+        "  -k  benchmark every span kernel the CPU has, not only the best one\n"
+    );
+}
+
+void renderFrame (SoftwareRenderer& renderer, const LampFleet& fleet) {
+    drawDial (renderer);
+    drawBeams (renderer, fleet, 0);
+}
+
+// Frames per second drawing everything, and drawing only the beams over a copy of the cached dial the way the window does
+void benchmark (const SnapshotOptions& options, LampFleet& fleet, SpanKernel kernel) {
+    static long const SIZES [] = { 256, 512, 1024, 2048 };
+
+    for (long size: SIZES) {
+        SoftwareRenderer dial (size, size, kernel), frame (size, size, kernel);
+        double fullRate, beamRate;
+        uint64_t frames;
+
+        drawDial (dial);
+
+        auto run = [&options, &frames] (const std::function<void (uint64_t)>& draw) {
+            auto started = std::chrono::steady_clock::now ();
+            double elapsed;
+
+            frames = 0;
+
+            do {
+                draw (frames ++);
+                elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - started).count ();
+            } while (elapsed < options.benchmarkSeconds);
+
+            return (double) frames / elapsed;
+        };
+
+        // the beams sweep round so that every frame differs
+        fullRate = run ([&frame, &fleet] (uint64_t index) {
+            fleet.actualBrg [0] = (double) (index % 360);
+            renderFrame (frame, fleet);
+        });
+        beamRate = run ([&frame, &dial, &fleet] (uint64_t index) {
+            fleet.actualBrg [0] = (double) (index % 360);
+            memcpy (frame.pixels.data (), dial.pixels.data (), dial.pixels.size () * sizeof (uint32_t));
+            drawBeams (frame, fleet, 0);
+        });
+
+        printf ("%-6s %5ldx%-5ld full %9.0f fps  beams over cached dial %9.0f fps\n", spanKernelName (kernel), size, size, fullRate, beamRate);
+    }
+}
+
+int main (int argCount, char *args []) {
+    SnapshotOptions options;
+
+    for (int i = 1; i < argCount; ++ i) {
+        bool hasValue = i + 1 < argCount, hasPair = i + 2 < argCount;
+
+        if (strcmp (args [i], "-s") == 0 && hasValue) {
+            options.size = atol (args [++ i]);
+        } else if (strcmp (args [i], "-m") == 0 && hasValue) {
+            options.mastHeight = atof (args [++ i]);
+        } else if (strcmp (args [i], "-a") == 0 && hasPair) {
+            options.actualBrg = atof (args [++ i]);
+            options.actualElev = atof (args [++ i]);
+        } else if (strcmp (args [i], "-r") == 0 && hasPair) {
+            options.requestedBrg = atof (args [++ i]);
+            options.requestedElev = atof (args [++ i]);
+        } else if (strcmp (args [i], "-o") == 0 && hasValue) {
+            options.outputPath = args [++ i];
+        } else if (strcmp (args [i], "-c") == 0 && hasValue) {
+            options.referencePath = args [++ i];
+        } else if (strcmp (args [i], "-b") == 0 && hasValue) {
+            options.benchmarkSeconds = atof (args [++ i]);
+        } else if (strcmp (args [i], "-k") == 0) {
+            options.allKernels = true;
+        } else {
+            showUsage (); return 1;
+        }
+    }
+
+    if (options.size < 64 || options.mastHeight <= 0.0) {
+        showUsage (); return 1;
+    }
+
+    LampFleet fleet (1, options.mastHeight);
+
+    fleet.actualBrg [0] = options.actualBrg;
+    fleet.actualElev [0] = options.actualElev;
+    fleet.requestedBrg [0] = options.requestedBrg;
+    fleet.requestedElev [0] = options.requestedElev;
+
+    if (options.benchmarkSeconds > 0.0) {
+        SpanKernel best = defaultSpanKernel ();
+
+        for (int kernel = SpanKernel::ScalarSpan; kernel <= best; ++ kernel) {
+            if (options.allKernels || kernel == best) benchmark (options, fleet, (SpanKernel) kernel);
+        }
+
+        return 0;
+    }
+
+    SoftwareRenderer renderer (options.size, options.size);
+
+    renderFrame (renderer, fleet);
+
+    if (options.outputPath && !renderer.writePpm (options.outputPath)) {
+        fprintf (stderr, "Unable to write %s\n", options.outputPath); return 2;
+    }
+
+    if (options.referencePath) {
+        SoftwareRenderer reference;
+
+        if (!reference.readPpm (options.referencePath)) {
+            fprintf (stderr, "Unable to read %s\n", options.referencePath); return 2;
+        }
+
+        if (reference.imageWidth != renderer.imageWidth || reference.imageHeight != renderer.imageHeight) {
+            printf ("size differs: %ldx%ld, reference %ldx%ld\n", renderer.imageWidth, renderer.imageHeight, reference.imageWidth, reference.imageHeight);
+            return 1;
+        }
+
+        size_t differences = 0;
+
+        for (size_t i = 0; i < renderer.pixels.size (); ++ i) {
+            if (renderer.pixels [i] != reference.pixels [i]) ++ differences;
+        }
+
+        printf ("%zu of %zu pixels differ\n", differences, renderer.pixels.size ());
+
+        return differences > 0 ? 1 : 0;
+    }
+
+    return 0;
+}
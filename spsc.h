@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+static size_t const CACHE_LINE_SIZE = 64;
+
+// Bounded single-producer/single-consumer queue. Neither side ever blocks or takes a lock;
+// push fails when the queue is full and pop fails when it is empty.
+template<typename T, size_t Capacity> struct SpscQueue {
+    static_assert ((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    alignas (CACHE_LINE_SIZE) std::atomic<size_t> head;     // written by the producer only
+    alignas (CACHE_LINE_SIZE) std::atomic<size_t> tail;     // written by the consumer only
+    alignas (CACHE_LINE_SIZE) T items [Capacity];
+
+    SpscQueue (): head (0), tail (0) {}
+
+    bool push (const T& item) {
+        size_t pos = head.load (std::memory_order_relaxed);
+
+        if (pos - tail.load (std::memory_order_acquire) >= Capacity) return false;
+
+        items [pos & (Capacity - 1)] = item;
+        head.store (pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool pop (T& item) {
+        size_t pos = tail.load (std::memory_order_relaxed);
+
+        if (pos == head.load (std::memory_order_acquire)) return false;
+
+        item = items [pos & (Capacity - 1)];
+        tail.store (pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    size_t size () const {
+        return head.load (std::memory_order_acquire) - tail.load (std::memory_order_acquire);
+    }
+};
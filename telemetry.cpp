@@ -0,0 +1,358 @@
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <queue>
+#include <functional>
+#include "telemetry.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#include <errno.h>
+#endif
+
+namespace {
+    // Longest single sleep, so that stop () is never kept waiting on a slow lamp
+    uint64_t const MAX_SLEEP_NS = 50000000ull;
+
+    uint64_t monotonicNow () {
+        return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+    }
+
+    uint64_t rateToPeriod (double rate) {
+        if (!(rate >= MIN_TELEMETRY_RATE)) rate = MIN_TELEMETRY_RATE;
+        if (rate > MAX_TELEMETRY_RATE) rate = MAX_TELEMETRY_RATE;
+
+        return (uint64_t) llround (1.0e9 / rate);
+    }
+
+    uint64_t toBits (double value) {
+        uint64_t bits;
+
+        memcpy (& bits, & value, sizeof (bits));
+
+        return bits;
+    }
+
+    double fromBits (uint64_t bits) {
+        double value;
+
+        memcpy (& value, & bits, sizeof (value));
+
+        return value;
+    }
+
+#ifdef _WIN32
+    // Sleeps until the deadline or until stopEvent is set; returns false in the latter case
+    struct DeadlineTimer {
+        HANDLE timer;
+
+        DeadlineTimer () {
+            timer = CreateWaitableTimerEx (0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+            // high resolution timers need Windows 10 1803+, older systems get the ordinary one
+            if (!timer) timer = CreateWaitableTimer (0, TRUE, 0);
+        }
+
+        ~DeadlineTimer () {
+            if (timer) CloseHandle (timer);
+        }
+
+        bool waitUntil (uint64_t deadline, void *stopEvent) {
+            uint64_t now = monotonicNow ();
+
+            if (now >= deadline) return WaitForSingleObject ((HANDLE) stopEvent, 0) != WAIT_OBJECT_0;
+
+            // the due time is relative, in 100 ns units; it is recomputed from the absolute deadline every time
+            LARGE_INTEGER dueTime;
+
+            dueTime.QuadPart = - (LONGLONG) ((deadline - now + 99) / 100);
+
+            HANDLE handles [2] { (HANDLE) stopEvent, timer };
+
+            if (!timer || !SetWaitableTimer (timer, & dueTime, 0, 0, 0, FALSE)) {
+                return WaitForSingleObject ((HANDLE) stopEvent, (DWORD) ((deadline - now) / 1000000)) != WAIT_OBJECT_0;
+            }
+
+            return WaitForMultipleObjects (2, handles, FALSE, INFINITE) != WAIT_OBJECT_0;
+        }
+    };
+#else
+    struct DeadlineTimer {
+        bool waitUntil (uint64_t deadline, void *) {
+            timespec until;
+
+            until.tv_sec = (time_t) (deadline / 1000000000ull);
+            until.tv_nsec = (long) (deadline % 1000000000ull);
+
+            // steady_clock is CLOCK_MONOTONIC on every POSIX library we build with
+            while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, & until, 0) == EINTR);
+
+            return true;
+        }
+    };
+#endif
+}
+
+TelemetryScheduler::TelemetryScheduler (size_t _numOfLamps, double rate):
+    numOfLamps (_numOfLamps > 0 ? _numOfLamps : 1),
+    snapshots (new LampSnapshot [_numOfLamps > 0 ? _numOfLamps : 1]),
+    periods (new std::atomic<uint64_t> [_numOfLamps > 0 ? _numOfLamps : 1]),
+    silent (_numOfLamps > 0 ? _numOfLamps : 1, false),
+    mode (EmissionMode::EmitPeriodic),
+    heartbeat ((uint64_t) (DEFAULT_HEARTBEAT_INTERVAL * 1.0e9)),
+    brgDeadband (0.0),
+    elevDeadband (0.0),
+    transmitter (0),
+    latency (0),
+    running (false),
+    stopEvent (0) {
+    for (size_t i = 0; i < numOfLamps; ++ i) {
+        snapshots [i].sequence = 0;
+        snapshots [i].brg = toBits (0.0);
+        snapshots [i].elev = toBits (0.0);
+        snapshots [i].status = LampStatus::NoLampFound;
+        snapshots [i].appliedNs = 0;
+    }
+
+    setRate (rate);
+    memset (& counters, 0, sizeof (counters));
+
+#ifdef _WIN32
+    stopEvent = CreateEvent (0, TRUE, FALSE, 0);
+#endif
+}
+
+TelemetryScheduler::~TelemetryScheduler () {
+    stop ();
+
+#ifdef _WIN32
+    if (stopEvent) CloseHandle ((HANDLE) stopEvent);
+#endif
+}
+
+void TelemetryScheduler::start (Transmitter *_transmitter) {
+    stop ();
+
+    transmitter = _transmitter;
+    latenessSum = latenessSquareSum = 0.0;
+
+    memset (& counters, 0, sizeof (counters));
+
+#ifdef _WIN32
+    ResetEvent ((HANDLE) stopEvent);
+#endif
+
+    running = true;
+    worker = std::thread (& TelemetryScheduler::run, this);
+}
+
+void TelemetryScheduler::stop () {
+    running = false;
+
+#ifdef _WIN32
+    if (stopEvent) SetEvent ((HANDLE) stopEvent);
+#endif
+
+    if (worker.joinable ()) worker.join ();
+
+    transmitter = 0;
+}
+
+void TelemetryScheduler::setRate (double rate) {
+    for (size_t i = 0; i < numOfLamps; ++ i) periods [i] = rateToPeriod (rate);
+}
+
+void TelemetryScheduler::setRate (size_t lamp, double rate) {
+    if (lamp < numOfLamps) periods [lamp] = rateToPeriod (rate);
+}
+
+double TelemetryScheduler::rate (size_t lamp) const {
+    return lamp < numOfLamps ? 1.0e9 / (double) periods [lamp].load () : 0.0;
+}
+
+void TelemetryScheduler::silence (size_t lamp) {
+    if (lamp < numOfLamps) silent [lamp] = true;
+}
+
+void TelemetryScheduler::setEmissionMode (EmissionMode _mode, double heartbeatInterval) {
+    mode = _mode;
+    heartbeat = heartbeatInterval > 0.0 ? (uint64_t) llround (heartbeatInterval * 1.0e9) : 0;
+}
+
+void TelemetryScheduler::setDeadband (double brg, double elev) {
+    brgDeadband = brg > 0.0 ? brg : 0.0;
+    elevDeadband = elev > 0.0 ? elev : 0.0;
+}
+
+void TelemetryScheduler::publish (const LampFleet& fleet) {
+    size_t count = fleet.size () < numOfLamps ? fleet.size () : numOfLamps;
+
+    for (size_t i = 0; i < count; ++ i) {
+        LampSnapshot& snapshot = snapshots [i];
+        uint32_t sequence = snapshot.sequence.load (std::memory_order_relaxed);
+        uint64_t appliedNs = latency ? latency->takeApplied (i) : 0;
+
+        snapshot.sequence.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        snapshot.brg.store (toBits (fleet.actualBrg [i]), std::memory_order_relaxed);
+        snapshot.elev.store (toBits (fleet.actualElev [i]), std::memory_order_relaxed);
+        snapshot.status.store (fleet.status [i], std::memory_order_relaxed);
+
+        if (appliedNs != 0) snapshot.appliedNs.store (appliedNs, std::memory_order_relaxed);
+
+        snapshot.sequence.store (sequence + 2, std::memory_order_release);
+    }
+}
+
+TelemetryStats TelemetryScheduler::stats () {
+    std::lock_guard<std::mutex> guard (statsLocker);
+    TelemetryStats result = counters;
+
+    if (counters.wakeups > 0) {
+        double count = (double) counters.wakeups;
+
+        result.meanLatenessNs = latenessSum / count;
+        result.jitterNs = sqrt (fmax (0.0, latenessSquareSum / count - result.meanLatenessNs * result.meanLatenessNs));
+    }
+
+    return result;
+}
+
+namespace {
+    // What went out last for one lamp
+    struct SentState {
+        bool valid;
+        double brg;
+        double elev;
+        uint32_t status;
+        uint64_t time;
+        uint64_t appliedNs;     // latency stamp already sent with a sentence
+    };
+
+    bool beyondDeadband (const SentState& sent, double brg, double elev, uint32_t status, double brgDeadband, double elevDeadband) {
+        double brgChange = fabs (brg - sent.brg);
+
+        if (brgChange > 180.0) brgChange = 360.0 - brgChange;
+
+        return !sent.valid || status != sent.status || brgChange > brgDeadband || fabs (elev - sent.elev) > elevDeadband;
+    }
+}
+
+void TelemetryScheduler::run () {
+    typedef std::pair<uint64_t, size_t> Deadline;
+
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+    std::vector<PsmackFormatter> formatters (numOfLamps);
+    std::vector<SentState> sent (numOfLamps, SentState { false, 0.0, 0.0, 0, 0, 0 });
+    DeadlineTimer timer;
+    uint64_t startedAt = monotonicNow ();
+
+    // every lamp starts on the same edge; lamps sharing a rate then go out in one wake-up
+    for (size_t i = 0; i < numOfLamps; ++ i) if (!silent [i]) deadlines.push (Deadline (startedAt + periods [i], i));
+
+    while (running) {
+        uint64_t now = monotonicNow ();
+        uint64_t deadline = deadlines.empty () ? now + 2 * MAX_SLEEP_NS : deadlines.top ().first;
+
+        if (deadline > now + MAX_SLEEP_NS) {
+            if (!timer.waitUntil (now + MAX_SLEEP_NS, stopEvent)) break;
+
+            continue;
+        }
+
+        if (!timer.waitUntil (deadline, stopEvent) || !running) break;
+
+        now = monotonicNow ();
+
+        int64_t lateness = (int64_t) (now - deadline);
+        uint64_t sentences = 0, heartbeats = 0, suppressed = 0, missed = 0;
+        bool onChange = mode == EmissionMode::EmitOnChange;
+        uint64_t heartbeatInterval = heartbeat;
+        double brgLimit = brgDeadband, elevLimit = elevDeadband;
+
+        while (!deadlines.empty () && deadlines.top ().first <= now) {
+            Deadline due = deadlines.top ();
+            LampSnapshot& snapshot = snapshots [due.second];
+            uint32_t sequence;
+            double brg, elev;
+            uint32_t status;
+            uint64_t appliedNs;
+
+            deadlines.pop ();
+
+            do {
+                sequence = snapshot.sequence.load (std::memory_order_acquire);
+                brg = fromBits (snapshot.brg.load (std::memory_order_relaxed));
+                elev = fromBits (snapshot.elev.load (std::memory_order_relaxed));
+                status = snapshot.status.load (std::memory_order_relaxed);
+                appliedNs = snapshot.appliedNs.load (std::memory_order_relaxed);
+                std::atomic_thread_fence (std::memory_order_acquire);
+            } while ((sequence & 1) || sequence != snapshot.sequence.load (std::memory_order_relaxed));
+
+            SentState& last = sent [due.second];
+            bool heartbeatDue = !onChange || heartbeatInterval == 0 || now - last.time >= heartbeatInterval;
+            bool changed = onChange && beyondDeadband (last, brg, elev, status, brgLimit, elevLimit);
+
+            if (changed || heartbeatDue) {
+                PsmackFormatter& formatter = formatters [due.second];
+                uint64_t reused = formatter.reused;
+                size_t size;
+                const char *sentence = formatter.format ((uint16_t) (due.second + 1), brg, elev, status, size);
+
+                // a change too small to show in the sentence is not worth the line time either
+                if (changed && !heartbeatDue && last.valid && formatter.reused != reused) {
+                    ++ suppressed;
+                } else {
+                    // only the first sentence after a command counts for apply->transmit
+                    if (transmitter) transmitter->enqueue (sentence, size, appliedNs != last.appliedNs ? appliedNs : 0);
+
+                    if (onChange && !changed) ++ heartbeats;
+
+                    ++ sentences;
+
+                    last.valid = true;
+                    last.brg = brg;
+                    last.elev = elev;
+                    last.status = status;
+                    last.time = now;
+                    last.appliedNs = appliedNs;
+                }
+            } else {
+                ++ suppressed;
+            }
+
+            // the next deadline follows from this one; whole periods already gone are skipped and counted, not bunched up
+            uint64_t period = periods [due.second];
+            uint64_t next = due.first + period;
+
+            if (next <= now) {
+                uint64_t behind = (now - next) / period + 1;
+
+                missed += behind;
+                next += behind * period;
+            }
+
+            deadlines.push (Deadline (next, due.second));
+        }
+
+        std::lock_guard<std::mutex> guard (statsLocker);
+
+        if (counters.wakeups == 0 || lateness < counters.minLatenessNs) counters.minLatenessNs = lateness;
+        if (counters.wakeups == 0 || lateness > counters.maxLatenessNs) counters.maxLatenessNs = lateness;
+
+        ++ counters.wakeups;
+        counters.sentences += sentences;
+        counters.heartbeats += heartbeats;
+        counters.suppressed += suppressed;
+        counters.missed += missed;
+        latenessSum += (double) lateness;
+        latenessSquareSum += (double) lateness * (double) lateness;
+    }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include "fleet.h"
+#include "psmack.h"
+#include "transmitter.h"
+#include "latency.h"
+
+static double const DEFAULT_TELEMETRY_RATE = 4.0;      // Hz, what the window timer used to give
+static double const MIN_TELEMETRY_RATE = 0.1;
+static double const MAX_TELEMETRY_RATE = 1000.0;
+static double const DEFAULT_HEARTBEAT_INTERVAL = 1.0;  // seconds
+
+enum EmissionMode {
+    EmitPeriodic = 0,       // every lamp at every tick of its rate
+    EmitOnChange,           // at a tick only if the lamp changed since the last sentence sent, otherwise at the heartbeat
+};
+
+// Last published state of one lamp. The UI thread writes, the scheduler thread reads; the sequence is odd
+// while a write is in progress, and a reader which sees it change retries.
+struct LampSnapshot {
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> brg;          // bit patterns of the doubles
+    std::atomic<uint64_t> elev;
+    std::atomic<uint32_t> status;
+    std::atomic<uint64_t> appliedNs;    // latency stamp of the last command applied, kept until a newer one comes
+};
+
+struct TelemetryStats {
+    uint64_t wakeups;
+    uint64_t sentences;         // sent
+    uint64_t heartbeats;        // sent in EmitOnChange mode only because the heartbeat was due
+    uint64_t suppressed;        // ticks which sent nothing because the lamp had not changed
+    uint64_t missed;            // emissions skipped because the thread woke up a whole period or more late
+    int64_t minLatenessNs;      // wake-up time minus deadline
+    int64_t maxLatenessNs;
+    double meanLatenessNs;
+    double jitterNs;            // standard deviation of the lateness
+};
+
+// Emits $PSMACK for every lamp at its own rate from a dedicated thread, off the message loop. Deadlines are
+// absolute (the next one is the previous one plus the period, never "now" plus the period), so a late wake-up
+// does not shift the ones after it. Waits use a high resolution waitable timer on Windows and
+// clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME) elsewhere.
+//
+// In EmitOnChange mode the rate becomes how often a lamp is checked: a change in status, or in bearing/elevation
+// beyond the deadband (measured from what was last sent, so slow drift still gets out) goes at the next tick;
+// a lamp that stays put is repeated only every heartbeat interval.
+struct TelemetryScheduler {
+    size_t numOfLamps;
+    std::unique_ptr<LampSnapshot []> snapshots;
+    std::unique_ptr<std::atomic<uint64_t> []> periods;     // ns per lamp
+    std::vector<bool> silent;                               // lamps never sent
+    std::atomic<int> mode;
+    std::atomic<uint64_t> heartbeat;                        // ns
+    std::atomic<double> brgDeadband;                        // degrees
+    std::atomic<double> elevDeadband;
+    Transmitter *transmitter;
+    LatencyMonitor *latency;                                // optional, source of the stamps sentences carry
+    std::atomic<bool> running;
+    std::thread worker;
+    std::mutex statsLocker;
+    TelemetryStats counters;
+    double latenessSum;
+    double latenessSquareSum;
+    void *stopEvent;
+
+    TelemetryScheduler (size_t _numOfLamps, double rate = DEFAULT_TELEMETRY_RATE);
+    ~TelemetryScheduler ();
+
+    void start (Transmitter *_transmitter);
+    void stop ();
+
+    // Rates in Hz, clamped to MIN_TELEMETRY_RATE .. MAX_TELEMETRY_RATE; take effect from the lamp's next emission
+    void setRate (double rate);
+    void setRate (size_t lamp, double rate);
+    double rate (size_t lamp) const;
+
+    // Nothing is ever sent for a silent lamp, as for a lamp not on the bus; before start only
+    void silence (size_t lamp);
+
+    // Heartbeat in seconds; deadbands in degrees, changes up to them do not count (0 means any change on the wire)
+    void setEmissionMode (EmissionMode _mode, double heartbeatInterval = DEFAULT_HEARTBEAT_INTERVAL);
+    void setDeadband (double brg, double elev);
+
+    // Copies the current state of every lamp for the scheduler thread to pick up; one writer thread only
+    void publish (const LampFleet& fleet);
+
+    TelemetryStats stats ();
+
+    void run ();
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+
+// Bare bones assertions for the test programs: a failed check is reported with where it was and counted,
+// and main returns checkResult (), which ctest takes as pass or fail
+static int checkFailures = 0;
+static int checksMade = 0;
+
+inline bool checkThat (bool condition, const char *text, const char *file, int line) {
+    ++ checksMade;
+
+    if (!condition) {
+        ++ checkFailures;
+
+        if (checkFailures <= 20) fprintf (stderr, "%s:%d: check failed: %s\n", file, line, text);
+    }
+
+    return condition;
+}
+
+#define CHECK(condition) checkThat ((condition), #condition, __FILE__, __LINE__)
+
+inline int checkResult (const char *name) {
+    printf ("%s: %d checks, %d failed\n", name, checksMade, checkFailures);
+
+    return checkFailures > 0 ? 1 : 0;
+}
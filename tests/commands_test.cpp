@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "commands.h"
+#include "check.h"
+
+// The command inbox with the reader and the owner running flat out: the owner never sees a torn command or an older
+// one after a newer, every command is either applied or superseded, and every lamp ends on its last command.
+// Commands for an absent lamp are counted with the unknown lamps and never reach the fleet.
+
+static void dispatchCommand (SentenceDispatcher& dispatcher, int lampID, double brg) {
+    char sentence [64];
+    int size = snprintf (sentence, sizeof (sentence), "$PSMACC,%d,%.1f,1.0,50", lampID, brg);
+    uint8_t crc = 0;
+
+    for (int i = 1; i < size; ++ i) crc ^= (uint8_t) sentence [i];
+
+    size += snprintf (sentence + size, sizeof (sentence) - size, "*%02X", crc);
+    dispatcher.dispatch (sentence, (size_t) size);
+}
+
+int main () {
+    size_t const numOfLamps = 37;
+    uint32_t const commandsPerLamp = 20000;
+    LampFleet fleet (numOfLamps);
+    CommandInbox inbox;
+    std::atomic<bool> writing (true);
+
+    std::thread reader ([&] () {
+        for (uint32_t n = 1; n <= commandsPerLamp; ++ n) {
+            for (size_t lamp = 0; lamp < numOfLamps; ++ lamp) {
+                // brg and elev always written as a pair the owner can check
+                inbox.post (lamp, LampCommand { (uint16_t) (lamp + 1), (uint8_t) (n % 100), (double) n, (double) n * 0.5 }, 0);
+            }
+        }
+
+        writing = false;
+    });
+
+    uint64_t applied = 0;
+    size_t torn = 0, backwards = 0;
+    std::vector<double> lastBrg (numOfLamps, 0.0);
+
+    auto check = [&] () {
+        for (size_t lamp = 0; lamp < numOfLamps; ++ lamp) {
+            double brg = fleet.requestedBrg [lamp];
+
+            // still where the fleet put it
+            if (brg == 0.0) continue;
+
+            if (fleet.requestedElev [lamp] != brg * 0.5 || fleet.requestedFocus [lamp] != (uint8_t) ((uint32_t) brg % 100)) ++ torn;
+            if (brg < lastBrg [lamp]) ++ backwards;
+
+            lastBrg [lamp] = brg;
+        }
+    };
+
+    while (writing.load ()) {
+        applied += applyPendingCommands (inbox, fleet);
+        check ();
+    }
+
+    reader.join ();
+    applied += applyPendingCommands (inbox, fleet);
+    check ();
+
+    CHECK (torn == 0);
+    CHECK (backwards == 0);
+    CHECK (applied + inbox.superseded == (uint64_t) numOfLamps * commandsPerLamp);
+
+    for (size_t lamp = 0; lamp < numOfLamps; ++ lamp) CHECK (fleet.requestedBrg [lamp] == (double) commandsPerLamp);
+
+    // nothing new, nothing applied
+    CHECK (applyPendingCommands (inbox, fleet) == 0);
+
+    // lamp 2 of 3 left out of the configuration
+    LampFleet partial (3);
+    CommandInbox partialInbox;
+    SentenceDispatcher dispatcher;
+
+    registerLampCommandHandlers (dispatcher, partial, partialInbox);
+    partialInbox.markAbsent (1);
+
+    for (int lampID = 1; lampID <= 4; ++ lampID) dispatchCommand (dispatcher, lampID, 10.0 * lampID);
+
+    CHECK (applyPendingCommands (partialInbox, partial) == 2);
+    CHECK (partialInbox.invalidLamps == 2);
+    CHECK (partial.requestedBrg [0] == 10.0 && partial.requestedBrg [1] == 0.0 && partial.requestedBrg [2] == 30.0);
+
+    printf ("%llu applied, %llu superseded\n", (unsigned long long) applied, (unsigned long long) inbox.superseded.load ());
+
+    return checkResult ("commands");
+}
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "conversion.h"
+#include "lamp.h"
+#include "check.h"
+
+// The fast conversions against libm over everything a lamp can be asked for: ranges 0.5 m .. MAX_RANGE on a
+// 200001 point grid for every mast height 1 .. 100 m in 0.5 m steps. The limits are the ones conversion.h gives.
+
+static double const MAX_ELEVATION_ERROR = 9.47e-9;         // degrees
+static double const MAX_RANGE_RELATIVE_ERROR = 2.64e-9;
+
+int main () {
+    int const numOfRanges = 200000;
+    double maxElevationError = 0.0, maxRangeError = 0.0;
+
+    for (double mastHeight = 1.0; mastHeight <= 100.0; mastHeight += 0.5) {
+        for (int k = 0; k <= numOfRanges; ++ k) {
+            double range = 0.5 + (MAX_RANGE - 0.5) * k / numOfRanges;
+            double elevation = range2elevation (mastHeight, range);
+            double exactRange = elevation2range (mastHeight, elevation);
+
+            maxElevationError = fmax (maxElevationError, fabs (fastRange2elevation (mastHeight, range) - elevation));
+            maxRangeError = fmax (maxRangeError, fabs (fastElevation2range (mastHeight, elevation) - exactRange) / exactRange);
+        }
+    }
+
+    printf ("elevation error %.6g degrees, range relative error %.6g\n", maxElevationError, maxRangeError);
+
+    CHECK (maxElevationError <= MAX_ELEVATION_ERROR);
+    CHECK (maxRangeError <= MAX_RANGE_RELATIVE_ERROR);
+
+    // the batch functions give the scalar results bit for bit, odd counts and in place included
+    size_t const count = 100001;
+    std::vector<double> elevations (count), ranges (count), converted (count);
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < count; ++ i) {
+        ranges [i] = 0.5 + (MAX_RANGE - 0.5) * i / (count - 1);
+        elevations [i] = 0.001 + 89.99 * i / (count - 1);
+    }
+
+    for (double mastHeight: { 1.0, 10.0, 99.5 }) {
+        elevations2ranges (ConversionMode::FastConversion, mastHeight, elevations.data (), converted.data (), count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            if (converted [i] != fastElevation2range (mastHeight, elevations [i])) ++ mismatches;
+        }
+
+        ranges2elevations (ConversionMode::FastConversion, mastHeight, ranges.data (), converted.data (), count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            if (converted [i] != fastRange2elevation (mastHeight, ranges [i])) ++ mismatches;
+        }
+
+        converted = ranges;
+        ranges2elevations (ConversionMode::ExactConversion, mastHeight, converted.data (), converted.data (), count);
+
+        for (size_t i = 0; i < count; ++ i) {
+            if (converted [i] != range2elevation (mastHeight, ranges [i])) ++ mismatches;
+        }
+    }
+
+    CHECK (mismatches == 0);
+
+    return checkResult ("conversion");
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "framer.h"
+#include "check.h"
+
+// SentenceFramer fed random streams in random pieces, against a byte by byte framing of the whole stream at once
+
+struct Framed {
+    std::vector<std::string> sentences;
+    uint64_t droppedBytes = 0;
+    uint64_t resyncs = 0;
+
+    bool operator == (const Framed& other) const {
+        return sentences == other.sentences && droppedBytes == other.droppedBytes && resyncs == other.resyncs;
+    }
+};
+
+// What the framer has to make of the stream: sentences run from '$' to LF, CR/LF stripped; a '$' restarts, bytes outside
+// a sentence are dropped, and a sentence which reaches MAX_SENTENCE_SIZE without its LF is dropped at that byte
+static Framed referenceFraming (const std::string& stream) {
+    Framed result;
+    size_t start = 0;
+    bool inSentence = false, discarding = false;
+
+    auto discard = [&] (size_t upTo) {
+        if (upTo > start) {
+            result.droppedBytes += upTo - start;
+
+            if (!discarding) {
+                discarding = true;
+                ++ result.resyncs;
+            }
+        }
+
+        start = upTo;
+    };
+
+    for (size_t i = 0; i < stream.size (); ++ i) {
+        if (stream [i] == '$') {
+            discard (i);
+            discarding = false;
+            inSentence = true;
+        } else if (!inSentence) {
+            discard (i + 1);
+        } else if (stream [i] == '\n') {
+            size_t size = i - start;
+
+            if (size > 0 && stream [i - 1] == '\r') -- size;
+
+            result.sentences.push_back (stream.substr (start, size));
+            start = i + 1;
+            inSentence = false;
+        } else if (i + 1 - start >= MAX_SENTENCE_SIZE) {
+            inSentence = false;
+            discard (i + 1);
+        }
+    }
+
+    return result;
+}
+
+static Framed feedInPieces (const std::string& stream, std::vector<size_t> pieces) {
+    SentenceFramer framer;
+    Framed result;
+    size_t pos = 0;
+
+    for (size_t i = 0; pos < stream.size (); ++ i) {
+        size_t size = i < pieces.size () ? pieces [i] : stream.size () - pos;
+
+        if (size > stream.size () - pos) size = stream.size () - pos;
+
+        framer.feed (stream.data () + pos, size, [&] (const char *sentence, size_t sentenceSize, const SentenceScan *) {
+            result.sentences.emplace_back (sentence, sentenceSize);
+        });
+
+        pos += size;
+    }
+
+    CHECK (framer.sentences == result.sentences.size ());
+
+    result.droppedBytes = framer.droppedBytes;
+    result.resyncs = framer.resyncs;
+
+    return result;
+}
+
+static std::string makeSentence (std::mt19937& random) {
+    std::string sentence = "$GPRMC";
+
+    for (size_t fields = random () % 16; fields > 0; -- fields) {
+        sentence += ',';
+
+        for (size_t size = random () % 10; size > 0; -- size) sentence += "0123456789.NSEW" [random () % 15];
+    }
+
+    return sentence + (random () % 4 ? "*5A\r\n" : "\n");
+}
+
+static size_t const LARGEST_PIECES [] = { 1, 16, 300, 3 * FRAMER_RING_SIZE };
+
+int main () {
+    // the plain cases, whole and a byte at a time
+    std::string const known = "junk$GPGGA,1*00\r\n\n$A,2\n$B,cut$C,3\r\n\r\n$" + std::string (MAX_SENTENCE_SIZE, 'x') + "\n$D\r\n";
+    Framed expected = referenceFraming (known);
+    std::vector<std::string> const knownSentences { "$GPGGA,1*00", "$A,2", "$C,3", "$D" };
+
+    CHECK (expected.sentences == knownSentences);
+    CHECK (feedInPieces (known, {}) == expected);
+    CHECK (feedInPieces (known, std::vector<size_t> (known.size (), 1)) == expected);
+
+    // a sentence of exactly MAX_SENTENCE_SIZE bytes with its LF still gets through, one byte more does not
+    std::string const longest = "$" + std::string (MAX_SENTENCE_SIZE - 3, 'y') + "\r\n";
+
+    CHECK (feedInPieces (longest, {}).sentences.size () == 1);
+    CHECK (feedInPieces ("$y" + longest.substr (1), {}).sentences.empty ());
+
+    std::mt19937 random (2);
+    size_t mismatches = 0;
+
+    // sentences, noise, bare LFs and oversized sentences, cut at random from single bytes to several ring sizes
+    for (int i = 0; i < 2000; ++ i) {
+        std::string stream;
+
+        while (stream.size () < 30000) {
+            unsigned kind = random () % 20;
+
+            if (kind < 14) {
+                stream += makeSentence (random);
+            } else if (kind < 17) {
+                for (size_t size = random () % 300; size > 0; -- size) stream += "$,*\r\nab09" [random () % 9];
+            } else if (kind < 19) {
+                stream += random () % 2 ? "\n" : "\r\n";
+            } else {
+                stream += '$';
+                stream.append (MAX_SENTENCE_SIZE - 8 + random () % 16, 'z');
+                stream += "\r\n";
+            }
+        }
+
+        std::vector<size_t> pieces;
+        size_t const largest = LARGEST_PIECES [i % 4];
+
+        for (size_t total = 0; total < stream.size (); total += pieces.back ()) pieces.push_back (1 + random () % largest);
+
+        Framed reference = referenceFraming (stream);
+
+        if (!(feedInPieces (stream, pieces) == reference)) ++ mismatches;
+        if (i % 16 == 0 && !(feedInPieces (stream, {}) == reference)) ++ mismatches;
+    }
+
+    CHECK (mismatches == 0);
+
+    return checkResult ("framer");
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+#include "motion.h"
+#include "fleet.h"
+#include "check.h"
+
+// Every motion kernel the CPU runs against the scalar one, which steps each lamp with stepLamp: same lamps moved and
+// the same bits in every position, tick after tick, at fleet sizes which do and do not fill whole vectors
+
+struct Lamps {
+    std::vector<double> actualBrg, actualElev, requestedBrg, requestedElev;
+
+    explicit Lamps (size_t count): actualBrg (count), actualElev (count), requestedBrg (count), requestedElev (count) {}
+
+    bool operator == (const Lamps& other) const {
+        size_t bytes = actualBrg.size () * sizeof (double);
+
+        return memcmp (actualBrg.data (), other.actualBrg.data (), bytes) == 0 && memcmp (actualElev.data (), other.actualElev.data (), bytes) == 0;
+    }
+};
+
+int main () {
+    MotionKernel const best = detectMotionKernel ();
+    std::vector<MotionKernel> kernels;
+
+    if (best != MotionKernel::ScalarKernel) kernels.push_back (MotionKernel::Sse2Kernel);
+    if (best == MotionKernel::Avx2Kernel) kernels.push_back (MotionKernel::Avx2Kernel);
+
+    for (MotionKernel kernel: kernels) printf ("testing %s\n", motionKernelName (kernel));
+
+    size_t const counts [] = { 1, 2, 3, 4, 5, 7, 64, 65, 1021, MAX_LAMPS };
+    ConversionMode const modes [] = { ConversionMode::ExactConversion, ConversionMode::FastConversion };
+    std::mt19937_64 random (9);
+    std::uniform_real_distribution<double> anyBrg (0.0, 360.0), anyElev (0.02, 89.7), anyMast (1.0, 100.0);
+    size_t positionMismatches = 0, movedMismatches = 0;
+
+    for (ConversionMode mode: modes) {
+        for (size_t count: counts) {
+            double mastHeight = anyMast (random);
+            Lamps reference (count);
+            std::vector<Lamps> lamps (kernels.size (), reference);
+
+            for (int tick = 0; tick < 400; ++ tick) {
+                // new targets now and then, some lamps left alone, some turned by bearing or elevation only
+                if (tick % 50 == 0) {
+                    for (size_t i = 0; i < count; ++ i) {
+                        unsigned what = (unsigned) (random () % 4);
+
+                        if (tick == 0) {
+                            reference.actualBrg [i] = anyBrg (random);
+                            reference.actualElev [i] = anyElev (random);
+                        }
+                        if (what & 1) reference.requestedBrg [i] = anyBrg (random);
+                        if (what & 2) reference.requestedElev [i] = anyElev (random);
+                        if (tick == 0 && !(what & 1)) reference.requestedBrg [i] = reference.actualBrg [i];
+                        if (tick == 0 && !(what & 2)) reference.requestedElev [i] = reference.actualElev [i];
+                    }
+
+                    for (Lamps& kernelLamps: lamps) {
+                        if (tick == 0) kernelLamps = reference;
+
+                        kernelLamps.requestedBrg = reference.requestedBrg;
+                        kernelLamps.requestedElev = reference.requestedElev;
+                    }
+                }
+
+                size_t moved = stepLamps (
+                    MotionKernel::ScalarKernel, mode, mastHeight, reference.actualBrg.data (), reference.actualElev.data (),
+                    reference.requestedBrg.data (), reference.requestedElev.data (), count
+                );
+
+                for (size_t k = 0; k < kernels.size (); ++ k) {
+                    Lamps& kernelLamps = lamps [k];
+                    size_t kernelMoved = stepLamps (
+                        kernels [k], mode, mastHeight, kernelLamps.actualBrg.data (), kernelLamps.actualElev.data (),
+                        kernelLamps.requestedBrg.data (), kernelLamps.requestedElev.data (), count
+                    );
+
+                    if (kernelMoved != moved) ++ movedMismatches;
+
+                    if (!(kernelLamps == reference)) {
+                        if (positionMismatches ++ < 20) {
+                            fprintf (stderr, "%s, %zu lamps, tick %d: positions differ\n", motionKernelName (kernels [k]), count, tick);
+                        }
+
+                        kernelLamps = reference;
+                    }
+                }
+            }
+        }
+    }
+
+    CHECK (positionMismatches == 0);
+    CHECK (movedMismatches == 0);
+
+    // the fleet steps with the kernel it picked and never holds more than MAX_LAMPS
+    LampFleet fleet (MAX_LAMPS + 3);
+
+    CHECK (fleet.size () == MAX_LAMPS);
+    CHECK (fleet.kernel == best);
+
+    return checkResult ("motion");
+}
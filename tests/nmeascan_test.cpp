@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "nmeascan.h"
+#include "nmea.h"
+#include "framer.h"
+#include "check.h"
+
+// Every scan kernel the CPU runs against a byte by byte reference, the vector tokenizer against the scalar one,
+// and the framer driven by each kernel against the framer driven by the scalar one, fields taken from its scan included
+
+static char const ALPHABET [] = "$,*\r\n\0ab09.-";
+
+static char randomByte (std::mt19937& random) {
+    return random () % 3 ? ALPHABET [random () % (sizeof (ALPHABET) - 1)] : (char) random ();
+}
+
+// "$GPGGA,..." with random fields, now and then a bad or missing checksum, CRLF or a bare LF
+static std::string makeSentence (std::mt19937& random) {
+    std::string sentence = "$GPGGA";
+    int numOfFields = (int) (random () % 20);
+
+    for (int i = 0; i < numOfFields; ++ i) {
+        int size = (int) (random () % 12);
+
+        sentence += ',';
+
+        for (int k = 0; k < size; ++ k) sentence += "0123456789.-ABCabc" [random () % 18];
+    }
+
+    uint8_t crc = 0;
+    char checksum [8];
+
+    for (size_t i = 1; i < sentence.size (); ++ i) crc ^= (uint8_t) sentence [i];
+
+    snprintf (checksum, sizeof (checksum), "*%02X", random () % 10 ? crc : (uint8_t) (crc + 1));
+
+    if (random () % 8) sentence += checksum;
+
+    sentence += random () % 5 ? "\r\n" : "\n";
+
+    return sentence;
+}
+
+static bool sameMasks (const ScanBlock *first, const ScanBlock *second, size_t size) {
+    return memcmp (first, second, sizeof (ScanBlock) * ((size + SCAN_BLOCK_SIZE - 1) / SCAN_BLOCK_SIZE)) == 0;
+}
+
+static bool sameFields (int count, SentenceFields& fields, int expectedCount, SentenceFields& expected) {
+    bool same = count == expectedCount && fields.count == expected.count && fields.crcPresent == expected.crcPresent &&
+                fields.crcFailed == expected.crcFailed;
+
+    for (int k = 0; same && k < expected.count; ++ k) same = fields [k].data == expected [k].data && fields [k].size == expected [k].size;
+
+    return same;
+}
+
+int main () {
+    ScanKernel const best = detectScanKernel ();
+    std::vector<ScanKernel> kernels { ScanKernel::ScalarScan };
+
+    // only the kernels this CPU can run; AVX2 implies SSE2
+    if (best == ScanKernel::Avx2Scan) kernels.push_back (ScanKernel::Sse2Scan);
+    if (best != ScanKernel::ScalarScan) kernels.push_back (best);
+
+    for (ScanKernel kernel: kernels) printf ("testing %s\n", scanKernelName (kernel));
+
+    std::mt19937 random (7);
+    size_t const MAX_SIZE = 300;
+    ScanBlock expected [8], blocks [8];
+    uint8_t expectedXor [MAX_SIZE], prefixXor [MAX_SIZE];
+    size_t maskMismatches = 0, xorMismatches = 0;
+
+    // any size and alignment, delimiters dense
+    for (int i = 0; i < 200000; ++ i) {
+        size_t size = random () % MAX_SIZE, offset = random () % SCAN_BLOCK_SIZE;
+        std::vector<char> buffer (size + SCAN_BLOCK_SIZE);
+
+        for (char& chr: buffer) chr = randomByte (random);
+
+        const char *data = buffer.data () + offset;
+        uint8_t carry = 0;
+
+        memset (expected, 0, sizeof (expected));
+
+        for (size_t k = 0; k < size; ++ k) {
+            uint64_t bit = 1ull << (k % SCAN_BLOCK_SIZE);
+            ScanBlock& block = expected [k / SCAN_BLOCK_SIZE];
+
+            switch (data [k]) {
+                case '$': block.dollars |= bit; break;
+                case ',': block.commas |= bit; break;
+                case '*': block.stars |= bit; break;
+                case '\r': block.crs |= bit; break;
+                case '\n': block.lfs |= bit; break;
+            }
+
+            expectedXor [k] = carry ^= (uint8_t) data [k];
+        }
+
+        for (ScanKernel kernel: kernels) {
+            scanNmea (kernel, data, size, blocks, prefixXor);
+
+            if (!sameMasks (expected, blocks, size)) ++ maskMismatches;
+            if (memcmp (expectedXor, prefixXor, size) != 0) ++ xorMismatches;
+
+            scanNmea (kernel, data, size, blocks, 0);
+
+            if (!sameMasks (expected, blocks, size)) ++ maskMismatches;
+        }
+    }
+
+    CHECK (maskMismatches == 0);
+    CHECK (xorMismatches == 0);
+
+    size_t tokenizerMismatches = 0;
+
+    // valid and broken sentences, and plain noise, with and without their terminators
+    for (int i = 0; i < 300000; ++ i) {
+        std::string sentence;
+
+        if (i % 3) {
+            sentence = makeSentence (random);
+        } else {
+            for (size_t size = random () % MAX_SIZE; size > 0; -- size) sentence += randomByte (random);
+        }
+
+        while (!sentence.empty () && (sentence.back () == '\n' || sentence.back () == '\r') && random () % 2) sentence.pop_back ();
+
+        SentenceFields reference, fields;
+        int expectedCount = tokenizeSentenceScalar (sentence.data (), sentence.size (), reference);
+
+        if (!sameFields (tokenizeSentence (sentence.data (), sentence.size (), fields), fields, expectedCount, reference)) ++ tokenizerMismatches;
+    }
+
+    CHECK (tokenizerMismatches == 0);
+
+    size_t framerMismatches = 0, scannedMismatches = 0, numOfScanned = 0;
+
+    // sentences, noise and oversized sentences, read in pieces from a byte to more than the ring holds
+    for (int i = 0; i < 1000; ++ i) {
+        std::string stream;
+
+        while (stream.size () < 20000) {
+            unsigned kind = random () % 10;
+
+            if (kind < 7) {
+                stream += makeSentence (random);
+            } else if (kind < 9) {
+                for (size_t size = random () % 400; size > 0; -- size) stream += randomByte (random);
+            } else {
+                stream += '$';
+                stream.append (200 + random () % 200, 'x');
+            }
+        }
+
+        std::vector<SentenceFramer> framers (kernels.size ());
+        std::vector<std::vector<std::string>> delivered (kernels.size ());
+
+        for (size_t k = 0; k < kernels.size (); ++ k) framers [k].kernel = kernels [k];
+
+        for (size_t pos = 0; pos < stream.size ();) {
+            size_t size = 1 + random () % (i % 2 ? 9000 : 100);
+
+            if (size > stream.size () - pos) size = stream.size () - pos;
+
+            for (size_t k = 0; k < kernels.size (); ++ k) {
+                framers [k].feed (stream.data () + pos, size, [&] (const char *sentence, size_t sentenceSize, const SentenceScan *scan) {
+                    delivered [k].emplace_back (sentence, sentenceSize);
+
+                    if (scan) {
+                        SentenceFields reference, fields;
+                        int expectedCount = tokenizeSentenceScalar (sentence, sentenceSize, reference);
+
+                        if (!sameFields (tokenizeScannedSentence (sentence, sentenceSize, * scan, fields), fields, expectedCount, reference)) ++ scannedMismatches;
+
+                        ++ numOfScanned;
+                    }
+                });
+            }
+
+            pos += size;
+        }
+
+        for (size_t k = 1; k < kernels.size (); ++ k) {
+            bool same = delivered [k] == delivered [0] && framers [k].sentences == framers [0].sentences &&
+                        framers [k].droppedBytes == framers [0].droppedBytes && framers [k].resyncs == framers [0].resyncs &&
+                        framers [k].tail == framers [0].tail && framers [k].inSentence == framers [0].inSentence;
+
+            if (!same) ++ framerMismatches;
+        }
+    }
+
+    CHECK (framerMismatches == 0);
+    CHECK (scannedMismatches == 0);
+    CHECK (numOfScanned > 100000);
+
+    return checkResult ("nmeascan");
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clocale>
+#include <random>
+#include <string>
+#include "numparse.h"
+#include "check.h"
+
+// parseDouble against the C runtime's strtod in the "C" locale: same bits, same number of characters used
+
+static size_t mismatches = 0;
+
+static void compareWithStrtod (const std::string& text) {
+    double parsed = 0.0;
+    char *strtodEnd;
+    double expected = strtod (text.c_str (), & strtodEnd);
+    const char *end = parseDouble (text.data (), text.data () + text.size (), parsed);
+    size_t used = (size_t) (end - text.data ()), expectedUsed = (size_t) (strtodEnd - text.c_str ());
+
+    // strtod leaves nothing behind when there is no number; parseDouble leaves value alone
+    if (expectedUsed == 0) parsed = expected;
+
+    if (memcmp (& parsed, & expected, sizeof (double)) != 0 || used != expectedUsed) {
+        if (mismatches ++ < 20) fprintf (stderr, "\"%s\": %.17g used %zu, strtod %.17g used %zu\n", text.c_str (), parsed, used, expected, expectedUsed);
+    }
+}
+
+int main () {
+    setlocale (LC_NUMERIC, "C");
+
+    // halfway and boundary cases, subnormals, overflow, long mantissas, partial and empty numbers
+    const char *const fixed [] = {
+        "0", "-0", "1", "1.", ".5", "0.1", "0.2", "0.3", "123.456", "-17.25", "1e10", "1E-10", "1e", "1e+", "1e-x",
+        "9007199254740993", "9007199254740992", "9007199254740991", "1.7976931348623157e308", "1.7976931348623159e308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "2.2250738585072011e-308",
+        "1e23", "8.98846567431158e307", "123456789012345678901234567890", "0.000000000000000000000000000000000001",
+        "1e400", "-1e-400", "00000000000123.45000000000", "7.038531e-26", "9214843084008499", "30078505129381147446200",
+        "1777820000000000000001", "0.500000000000000166533453693773481063544750213623046875", "3.518437208883201171875e13",
+        "62.5364939768271845828", "8.10109172351e-10", "1448997445238699", "45.5", "359.9999", "-.", "+", "-", "", ".",
+        "abc", "12abc", "1.5e3,", "-2E-2*", "1,5"
+    };
+
+    for (const char *text: fixed) compareWithStrtod (text);
+
+    std::mt19937_64 random (42);
+    std::uniform_int_distribution<int> numOfDigits (1, 25), exponent (-330, 310), digit (0, 9);
+
+    // random digit strings, some with exponents
+    for (int i = 0; i < 500000; ++ i) {
+        std::string text;
+        int count = numOfDigits (random), point = (int) (random () % (count + 1));
+
+        if (random () & 1) text += '-';
+
+        for (int k = 0; k < count; ++ k) {
+            if (k == point) text += '.';
+            text += (char) ('0' + digit (random));
+        }
+
+        if (random () % 3 == 0) text += 'e' + std::to_string (exponent (random));
+
+        compareWithStrtod (text);
+    }
+
+    // random doubles printed in full and to 15 digits, and NMEA style fields
+    for (int i = 0; i < 250000; ++ i) {
+        uint64_t bits = random ();
+        double value;
+        char text [64];
+
+        memcpy (& value, & bits, sizeof (value));
+
+        if (value == value && value - value == 0.0) {
+            snprintf (text, sizeof (text), "%.17g", value);
+            compareWithStrtod (text);
+            snprintf (text, sizeof (text), "%.15g", value);
+            compareWithStrtod (text);
+        }
+
+        snprintf (text, sizeof (text), "%.*f", (int) (random () % 5), (double) (random () % 3600000) / 1000.0);
+        compareWithStrtod (text);
+    }
+
+    CHECK (mismatches == 0);
+
+    // flags
+    double value = 0.0;
+    const char *blanks = "  \t-12,75";
+
+    CHECK (toDouble (blanks, blanks + strlen (blanks), NumberFlags::NumberSkipBlanks | NumberFlags::NumberAcceptComma) == -12.75);
+    CHECK (parseDouble (blanks, blanks + strlen (blanks), value) == blanks);
+    CHECK (toDouble ("1,5", "1,5" + 3) == 1.0);
+
+    // no terminator needed: only [begin, end) is looked at
+    const char *digits = "12345";
+
+    CHECK (toDouble (digits, digits + 3) == 123.0);
+    CHECK (toInt (digits, digits + 2) == 12);
+
+    // integers, clamped when out of range
+    int64_t integer = 0;
+    const char *huge = "-99999999999999999999999";
+
+    CHECK (toInt ("-42", "-42" + 3) == -42);
+    CHECK (parseInt (huge, huge + strlen (huge), integer) == huge + strlen (huge) && integer == INT64_MIN);
+    CHECK (toInt ("x", "x" + 1) == 0);
+
+    // the process locale does not matter
+    const char *const commaLocales [] = { "de_DE.UTF-8", "de_DE.utf8", "fr_FR.UTF-8", "ru_RU.UTF-8", "German_Germany.1252" };
+
+    for (const char *locale: commaLocales) {
+        if (setlocale (LC_NUMERIC, locale)) {
+            CHECK (toDouble ("12.5", "12.5" + 4) == 12.5);
+            setlocale (LC_NUMERIC, "C");
+            break;
+        }
+    }
+
+    return checkResult ("numparse");
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <random>
+#include "psmack.h"
+#include "check.h"
+
+// $PSMACK the way sendLampSentence built it with sprintf before PsmackFormatter, checksum included
+static size_t referencePsmack (char *buffer, uint16_t lampID, double brg, double elevation, uint32_t status) {
+    int size = snprintf (buffer, MAX_PSMACK_SIZE * 8, "$PSMACK,%02d,%d,%.2f,100,%02X", lampID, (int) brg, elevation, status);
+    uint8_t crc = 0;
+
+    for (int i = 1; i < size; ++ i) crc ^= (uint8_t) buffer [i];
+
+    return (size_t) (size + sprintf (buffer + size, "*%02X\r\n", crc));
+}
+
+static bool sameAsSprintf (PsmackFormatter& formatter, uint16_t lampID, double brg, double elevation, uint32_t status) {
+    char expected [MAX_PSMACK_SIZE * 8];
+    size_t expectedSize = referencePsmack (expected, lampID, brg, elevation, status), size;
+    const char *sentence = formatter.format (lampID, brg, elevation, status, size);
+    bool same = size == expectedSize && memcmp (sentence, expected, size) == 0;
+
+    if (!same && checkFailures < 20) fprintf (stderr, "elevation %.17g: %.*s expected %s", elevation, (int) size, sentence, expected);
+
+    return same;
+}
+
+int main () {
+    PsmackFormatter formatter;
+
+    // the cases rounding value * 100 half away from zero used to get wrong, exact ties and signed zeros
+    double const edges [] = {
+        0.125, 2.675, 45.125, -0.001, -0.0, 0.0, 0.005, 0.015, 0.025, -0.125, -2.675, 1.005, 89.995, -89.995,
+        0.375, 0.625, 0.875, 1.125, 0.0049999999999999999, 0.995, 9.995, 99.995, 1e-300, -1e-300, 5e-324,
+        19999999.995, -19999999.995, 2e7, -2e7, -123456789.125, INFINITY, -INFINITY, NAN
+    };
+
+    for (double elevation: edges) CHECK (sameAsSprintf (formatter, 1, 10.0, elevation, 0));
+
+    // every quarter, eighth and sixteenth of a hundredth is an exact binary tie or close to one
+    for (int i = -800000; i <= 800000; ++ i) {
+        if (!sameAsSprintf (formatter, 2, 0.0, (double) i / 1600.0, 0)) CHECK (false);
+    }
+
+    std::mt19937_64 random (7);
+    std::uniform_int_distribution<int> decimals (-9000000, 9000000);
+    std::uniform_real_distribution<double> anyElevation (-90.0, 90.0), anyBearing (0.0, 360.0);
+    std::uniform_int_distribution<int> anyLamp (1, 1024);
+    std::uniform_int_distribution<uint32_t> anyStatus (0, 255);
+    size_t mismatches = 0;
+
+    // 5-decimal elevations as a control unit sends them, then any double at all
+    for (int i = 0; i < 2000000; ++ i) {
+        if (!sameAsSprintf (formatter, 3, 0.0, (double) decimals (random) / 100000.0, 0)) ++ mismatches;
+    }
+    for (int i = 0; i < 1000000; ++ i) {
+        if (!sameAsSprintf (formatter, (uint16_t) anyLamp (random), anyBearing (random), anyElevation (random), anyStatus (random))) ++ mismatches;
+    }
+
+    CHECK (mismatches == 0);
+
+    // an unchanged lamp is served from the cache, and the cache tells -0.00 from 0.00
+    PsmackFormatter cached;
+    size_t size;
+
+    cached.format (5, 90.0, 1.0, 0, size);
+    cached.format (5, 90.4, 1.001, 0, size);
+    CHECK (cached.encoded == 1 && cached.reused == 1);
+    CHECK (sameAsSprintf (cached, 5, 90.0, 0.0, 0));
+    CHECK (sameAsSprintf (cached, 5, 90.0, -0.0, 0));
+    CHECK (sameAsSprintf (cached, 5, 90.0, -0.001, 0));
+    CHECK (cached.encoded == 3 && cached.reused == 2);         // -0.001 prints as -0.0 did
+
+    return checkResult ("psmack");
+}
@@ -0,0 +1,147 @@
+#include <string.h>
+#include <chrono>
+#include "transmitter.h"
+
+Transmitter::Transmitter (size_t capacity, BackpressurePolicy _policy):
+    queue (capacity > 0 ? capacity : 1),
+    head (0),
+    tail (0),
+    policy (_policy),
+    link (0),
+    running (false),
+    latency (0) {
+    memset (& counters, 0, sizeof (counters));
+}
+
+Transmitter::~Transmitter () {
+    stop ();
+}
+
+void Transmitter::start (Link *_link) {
+    stop ();
+
+    std::lock_guard<std::mutex> guard (locker);
+
+    link = _link;
+    head = tail = 0;
+    running = true;
+    worker = std::thread (& Transmitter::run, this);
+}
+
+void Transmitter::stop () {
+    {
+        std::lock_guard<std::mutex> guard (locker);
+
+        running = false;
+    }
+
+    queueChanged.notify_all ();
+
+    if (worker.joinable ()) worker.join ();
+
+    link = 0;
+}
+
+bool Transmitter::enqueue (const char *data, size_t size, uint64_t appliedNs) {
+    if (size > MAX_TX_SENTENCE_SIZE) return false;
+
+    std::unique_lock<std::mutex> guard (locker);
+
+    if (policy == BackpressurePolicy::BlockSender) {
+        queueChanged.wait (guard, [this] { return !running || head - tail < queue.size (); });
+    }
+
+    if (!running) return false;
+
+    if (head - tail >= queue.size ()) {
+        ++ tail;
+        ++ counters.dropped;
+    }
+
+    auto& item = queue [head % queue.size ()];
+
+    memcpy (item.data, data, size);
+    item.size = (uint16_t) size;
+    item.appliedNs = appliedNs;
+
+    ++ head;
+    ++ counters.queued;
+
+    if (head - tail > counters.maxDepth) counters.maxDepth = head - tail;
+
+    guard.unlock ();
+    queueChanged.notify_all ();
+
+    return true;
+}
+
+size_t Transmitter::depth () {
+    std::lock_guard<std::mutex> guard (locker);
+
+    return head - tail;
+}
+
+TransmitterStats Transmitter::stats () {
+    std::lock_guard<std::mutex> guard (locker);
+    TransmitterStats result = counters;
+
+    result.depth = head - tail;
+
+    return result;
+}
+
+void Transmitter::run () {
+    char batch [MAX_TX_BATCH_SIZE];
+    std::vector<uint64_t> stamps;
+
+    // room for a full batch of short sentences; the writer loop never allocates
+    stamps.reserve (MAX_TX_BATCH_SIZE / 8);
+
+    while (true) {
+        size_t batchSize = 0, batchCount = 0;
+
+        stamps.clear ();
+
+        {
+            std::unique_lock<std::mutex> guard (locker);
+
+            queueChanged.wait (guard, [this] { return !running || head != tail; });
+
+            if (!running) break;
+
+            // coalesce whatever is pending into one write
+            while (tail != head && batchSize + queue [tail % queue.size ()].size <= sizeof (batch)) {
+                auto& item = queue [tail % queue.size ()];
+
+                memcpy (batch + batchSize, item.data, item.size);
+
+                if (item.appliedNs != 0 && stamps.size () < stamps.capacity ()) stamps.push_back (item.appliedNs);
+
+                batchSize += item.size;
+                ++ batchCount;
+                ++ tail;
+            }
+        }
+
+        queueChanged.notify_all ();
+
+        auto startedAt = std::chrono::steady_clock::now ();
+        bool sent = link->send (batch, batchSize);
+        uint64_t writeNs = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now () - startedAt).count ();
+
+        if (sent && latency && !stamps.empty ()) {
+            uint64_t now = latencyNow ();
+
+            for (auto stamp: stamps) latency->record (LatencyStage::ApplyToTransmit, stamp, now);
+        }
+
+        std::lock_guard<std::mutex> guard (locker);
+
+        ++ counters.writes;
+        counters.sentences += batchCount;
+        counters.totalWriteNs += writeNs;
+
+        if (writeNs > counters.maxWriteNs) counters.maxWriteNs = writeNs;
+        if (!sent) ++ counters.writeErrors;
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "link.h"
+#include "latency.h"
+
+static size_t const MAX_TX_SENTENCE_SIZE = 100;
+static size_t const MAX_TX_BATCH_SIZE = 4096;
+
+enum BackpressurePolicy {
+    DropOldest = 0,     // a full queue discards the oldest sentence; the caller never waits
+    BlockSender,        // a full queue makes the caller wait until the port catches up
+};
+
+struct TxSentence {
+    uint64_t appliedNs;         // stamp of the command the sentence reflects, 0 if none
+    uint16_t size;
+    char data [MAX_TX_SENTENCE_SIZE];
+};
+
+struct TransmitterStats {
+    size_t depth;
+    size_t maxDepth;
+    uint64_t queued;
+    uint64_t dropped;
+    uint64_t sentences;
+    uint64_t writes;
+    uint64_t writeErrors;
+    uint64_t totalWriteNs;
+    uint64_t maxWriteNs;
+};
+
+// Owns the transmit direction of a link: sentences are queued pre-formatted by any thread and written out
+// by a dedicated thread, several pending ones coalesced into a single write. A stalled port (XOFF, full driver
+// buffer) only ever holds up this thread.
+struct Transmitter {
+    std::vector<TxSentence> queue;
+    size_t head, tail;
+    BackpressurePolicy policy;
+    Link *link;
+    bool running;
+    std::thread worker;
+    std::mutex locker;
+    std::condition_variable queueChanged;
+    TransmitterStats counters;
+    LatencyMonitor *latency;                // optional; gets apply->transmit once a stamped sentence is written
+
+    Transmitter (size_t capacity = 64, BackpressurePolicy _policy = BackpressurePolicy::DropOldest);
+    ~Transmitter ();
+
+    void start (Link *_link);
+    void stop ();
+
+    // Returns false when the sentence was not queued (transmitter stopped, sentence too long)
+    bool enqueue (const char *data, size_t size, uint64_t appliedNs = 0);
+
+    size_t depth ();
+    TransmitterStats stats ();
+
+    void run ();
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+static uint32_t const DEFAULT_BAUD_RATE = 115200;
+static uint32_t const WAIT_FOREVER = 0xFFFFFFFF;
+
+enum WaitResult {
+    DataReady = 0,
+    WaitTimeout,
+    WaitInterrupted,
+    WaitFailed,
+};
+
+// Byte stream between the simulator and a control unit; a serial port, a pseudo-terminal or anything alike
+struct Transport {
+    virtual ~Transport () {}
+
+    virtual bool isOpen () = 0;
+    virtual void close () = 0;
+
+    // Never blocks; returns number of bytes read, 0 when nothing is pending or -1 on error
+    virtual long read (char *buffer, size_t size) = 0;
+
+    // Returns number of bytes written or -1 on error
+    virtual long write (const char *data, size_t size) = 0;
+
+    // Sleeps until bytes arrive, interrupt () is called or the timeout expires; no CPU is used meanwhile
+    virtual WaitResult waitForData (uint32_t timeoutMs = WAIT_FOREVER) = 0;
+
+    // Wakes up a waitForData pending on another thread; every following wait returns WaitInterrupted as well.
+    // A write stalled on a full port gives up too, returning what got out, so the writer can be joined.
+    virtual void interrupt () = 0;
+};
+
+// "\\.\COM3" on Windows, "/dev/ttyS0" or a pty slave name elsewhere; returns 0 when the port cannot be opened
+Transport *openSerialTransport (const char *name, uint32_t baudRate = DEFAULT_BAUD_RATE);
+
+static size_t const DEFAULT_LOOPBACK_CAPACITY = 4096;
+
+// Two transports wired to each other in memory, on every platform; whatever one writes the other reads.
+// A full direction makes the writer wait, so a fast writer is held to the pace of the reader.
+void openLoopbackPair (Transport *& first, Transport *& second, size_t capacity = DEFAULT_LOOPBACK_CAPACITY);
+
+#ifndef _WIN32
+// Opens a pseudo-terminal pair. The simulator normally takes the slave side while a peer (load generator,
+// test, replay) drives the master side, so the whole receive/transmit path runs with no hardware at all.
+bool openPtyPair (Transport *& master, Transport *& slave, char *slaveName = 0, size_t nameSize = 0);
+#endif
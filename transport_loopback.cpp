@@ -0,0 +1,129 @@
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include "transport.h"
+
+// Bytes going one way between the two ends; a full pipe makes the writer wait as a saturated line would
+struct LoopbackPipe {
+    std::vector<char> ring;
+    size_t head, tail;              // total bytes written and read
+    bool readerInterrupted;
+    bool closed;
+
+    LoopbackPipe (size_t capacity): ring (capacity), head (0), tail (0), readerInterrupted (false), closed (false) {}
+};
+
+struct LoopbackShared {
+    std::mutex locker;
+    std::condition_variable changed;
+    LoopbackPipe pipes [2];
+
+    LoopbackShared (size_t capacity): pipes { LoopbackPipe (capacity), LoopbackPipe (capacity) } {}
+};
+
+struct LoopbackTransport: Transport {
+    std::shared_ptr<LoopbackShared> shared;
+    LoopbackPipe& incoming;
+    LoopbackPipe& outgoing;
+    bool opened;
+
+    LoopbackTransport (std::shared_ptr<LoopbackShared> _shared, int side):
+        shared (_shared), incoming (_shared->pipes [side]), outgoing (_shared->pipes [1 - side]), opened (true) {}
+    virtual ~LoopbackTransport () {
+        close ();
+    }
+
+    virtual bool isOpen () {
+        return opened;
+    }
+
+    virtual void close () {
+        std::lock_guard<std::mutex> lock (shared->locker);
+
+        if (opened) {
+            opened = false;
+            incoming.closed = outgoing.closed = true;
+
+            shared->changed.notify_all ();
+        }
+    }
+
+    virtual long read (char *buffer, size_t size) {
+        std::lock_guard<std::mutex> lock (shared->locker);
+
+        if (!opened) return -1;
+
+        size_t capacity = incoming.ring.size ();
+        size_t available = incoming.head - incoming.tail;
+        size_t count = available < size ? available : size;
+
+        for (size_t i = 0; i < count; ++ i) buffer [i] = incoming.ring [(incoming.tail + i) % capacity];
+
+        incoming.tail += count;
+
+        if (count > 0) shared->changed.notify_all ();
+
+        return (long) count;
+    }
+
+    virtual long write (const char *data, size_t size) {
+        std::unique_lock<std::mutex> lock (shared->locker);
+        size_t capacity = outgoing.ring.size ();
+        size_t written = 0;
+
+        while (written < size) {
+            if (!opened || outgoing.closed || incoming.readerInterrupted) return written > 0 ? (long) written : -1;
+
+            size_t space = capacity - (outgoing.head - outgoing.tail);
+
+            if (space == 0) {
+                shared->changed.wait (lock); continue;
+            }
+
+            size_t count = size - written < space ? size - written : space;
+
+            for (size_t i = 0; i < count; ++ i) outgoing.ring [(outgoing.head + i) % capacity] = data [written + i];
+
+            outgoing.head += count;
+            written += count;
+
+            shared->changed.notify_all ();
+        }
+
+        return (long) written;
+    }
+
+    virtual WaitResult waitForData (uint32_t timeoutMs) {
+        std::unique_lock<std::mutex> lock (shared->locker);
+        auto ready = [this] { return incoming.readerInterrupted || !opened || incoming.closed || incoming.head != incoming.tail; };
+
+        if (timeoutMs == WAIT_FOREVER) {
+            shared->changed.wait (lock, ready);
+        } else if (!shared->changed.wait_for (lock, std::chrono::milliseconds (timeoutMs), ready)) {
+            return WaitResult::WaitTimeout;
+        }
+
+        if (incoming.readerInterrupted) return WaitResult::WaitInterrupted;
+
+        // what the other end wrote before it closed can still be read
+        return opened && incoming.head != incoming.tail ? WaitResult::DataReady : WaitResult::WaitFailed;
+    }
+
+    virtual void interrupt () {
+        std::lock_guard<std::mutex> lock (shared->locker);
+
+        incoming.readerInterrupted = true;
+
+        shared->changed.notify_all ();
+    }
+};
+
+void openLoopbackPair (Transport *& first, Transport *& second, size_t capacity) {
+    std::shared_ptr<LoopbackShared> shared = std::make_shared<LoopbackShared> (capacity);
+
+    first = new LoopbackTransport (shared, 0);
+    second = new LoopbackTransport (shared, 1);
+}
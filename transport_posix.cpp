@@ -0,0 +1,184 @@
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#if defined (__APPLE__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+#include "transport.h"
+
+const uint8_t ASCII_XON = 0x11;
+const uint8_t ASCII_XOFF = 0x13;
+
+static speed_t baudRateToSpeed (uint32_t baudRate) {
+    switch (baudRate) {
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 230400: return B230400;
+        default: return B115200;
+    }
+}
+
+static bool setupTerminal (int fd, uint32_t baudRate, bool flowControl) {
+    termios settings;
+
+    if (tcgetattr (fd, & settings) != 0) return false;
+
+    cfmakeraw (& settings);
+    cfsetispeed (& settings, baudRateToSpeed (baudRate));
+    cfsetospeed (& settings, baudRateToSpeed (baudRate));
+
+    settings.c_cflag |= CLOCAL | CREAD;
+    settings.c_cflag &= ~(CSTOPB | PARENB | CSIZE);
+    settings.c_cflag |= CS8;
+    settings.c_cc [VMIN] = 0;
+    settings.c_cc [VTIME] = 0;
+
+    if (flowControl) {
+        settings.c_iflag |= IXON | IXOFF;
+        settings.c_cc [VSTART] = ASCII_XON;
+        settings.c_cc [VSTOP] = ASCII_XOFF;
+    }
+
+    if (tcsetattr (fd, TCSANOW, & settings) != 0) return false;
+
+    tcflush (fd, TCIOFLUSH);
+
+    return fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK) == 0;
+}
+
+struct PosixTransport: Transport {
+    int fd;
+    int wakePipe [2];
+
+    PosixTransport (int _fd): fd (_fd) {
+        if (pipe (wakePipe) == 0) {
+            fcntl (wakePipe [0], F_SETFL, fcntl (wakePipe [0], F_GETFL) | O_NONBLOCK);
+            fcntl (wakePipe [1], F_SETFL, fcntl (wakePipe [1], F_GETFL) | O_NONBLOCK);
+        } else {
+            wakePipe [0] = wakePipe [1] = -1;
+        }
+    }
+    virtual ~PosixTransport () {
+        close ();
+
+        if (wakePipe [0] >= 0) ::close (wakePipe [0]);
+        if (wakePipe [1] >= 0) ::close (wakePipe [1]);
+    }
+
+    virtual bool isOpen () {
+        return fd >= 0;
+    }
+
+    virtual void close () {
+        if (fd >= 0) {
+            ::close (fd);
+
+            fd = -1;
+        }
+    }
+
+    virtual long read (char *buffer, size_t size) {
+        ssize_t bytesRead = ::read (fd, buffer, size);
+
+        if (bytesRead >= 0) return (long) bytesRead;
+
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    virtual long write (const char *data, size_t size) {
+        size_t bytesSent = 0;
+
+        while (bytesSent < size) {
+            ssize_t result = ::write (fd, data + bytesSent, size - bytesSent);
+
+            if (result > 0) {
+                bytesSent += (size_t) result;
+            } else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                pollfd items [2] { { fd, POLLOUT, 0 }, { wakePipe [0], POLLIN, 0 } };
+
+                // a port nobody drains would hold the writer here for ever; interrupt () lets it go
+                if (poll (items, 2, 100) > 0 && (items [1].revents & POLLIN)) return bytesSent > 0 ? (long) bytesSent : -1;
+            } else if (result < 0 && errno != EINTR) {
+                return bytesSent > 0 ? (long) bytesSent : -1;
+            }
+        }
+
+        return (long) bytesSent;
+    }
+
+    virtual WaitResult waitForData (uint32_t timeoutMs) {
+        pollfd items [2] { { fd, POLLIN, 0 }, { wakePipe [0], POLLIN, 0 } };
+        int result;
+
+        do {
+            result = poll (items, 2, timeoutMs == WAIT_FOREVER ? -1 : (int) timeoutMs);
+        } while (result < 0 && errno == EINTR);
+
+        if (result < 0) return WaitResult::WaitFailed;
+        if (result == 0) return WaitResult::WaitTimeout;
+
+        // the wake-up byte is never drained, so the interrupted state sticks as the interface promises
+        if (items [1].revents & POLLIN) return WaitResult::WaitInterrupted;
+        if (items [0].revents & POLLIN) return WaitResult::DataReady;
+
+        return WaitResult::WaitFailed;
+    }
+
+    virtual void interrupt () {
+        char wakeUp = 1;
+
+        if (wakePipe [1] >= 0 && ::write (wakePipe [1], & wakeUp, 1) < 0) {
+            // the pipe is already full, so the waiter is awake anyway
+        }
+    }
+};
+
+Transport *openSerialTransport (const char *name, uint32_t baudRate) {
+    int fd = open (name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) return 0;
+
+    if (!setupTerminal (fd, baudRate, true)) {
+        ::close (fd); return 0;
+    }
+
+    return new PosixTransport (fd);
+}
+
+bool openPtyPair (Transport *& master, Transport *& slave, char *slaveName, size_t nameSize) {
+    int masterFd, slaveFd;
+    char name [256];
+
+    master = slave = 0;
+
+    if (openpty (& masterFd, & slaveFd, name, 0, 0) != 0) return false;
+
+    // no software flow control on a loopback pair, there is no UART on either side to honour it
+    if (!setupTerminal (masterFd, DEFAULT_BAUD_RATE, false) || !setupTerminal (slaveFd, DEFAULT_BAUD_RATE, false)) {
+        ::close (masterFd);
+        ::close (slaveFd);
+        return false;
+    }
+
+    if (slaveName && nameSize > 0) {
+        strncpy (slaveName, name, nameSize - 1);
+        slaveName [nameSize - 1] = '\0';
+    }
+
+    master = new PosixTransport (masterFd);
+    slave = new PosixTransport (slaveFd);
+
+    return true;
+}
+
+#endif
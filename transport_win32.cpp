@@ -0,0 +1,164 @@
+#ifdef _WIN32
+
+#include <Windows.h>
+#include <cstdint>
+#include "transport.h"
+
+const uint8_t ASCII_XON = 0x11;
+const uint8_t ASCII_XOFF = 0x13;
+
+struct Win32Transport: Transport {
+    HANDLE port;
+    HANDLE stopEvent, commEvent, readEvent, writeEvent;
+
+    Win32Transport (HANDLE _port):
+        port (_port),
+        stopEvent (CreateEvent (0, 1, 0, 0)),
+        commEvent (CreateEvent (0, 1, 0, 0)),
+        readEvent (CreateEvent (0, 1, 0, 0)),
+        writeEvent (CreateEvent (0, 1, 0, 0)) {
+        SetCommMask (port, EV_RXCHAR);
+    }
+    virtual ~Win32Transport () {
+        close ();
+
+        CloseHandle (stopEvent);
+        CloseHandle (commEvent);
+        CloseHandle (readEvent);
+        CloseHandle (writeEvent);
+    }
+
+    virtual bool isOpen () {
+        return port != INVALID_HANDLE_VALUE;
+    }
+
+    virtual void close () {
+        if (port != INVALID_HANDLE_VALUE) {
+            CloseHandle (port);
+
+            port = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    // Completes an overlapped operation synchronously; used for reads and writes which normally finish at once
+    bool complete (BOOL started, OVERLAPPED& overlapped, unsigned long& bytesTransferred) {
+        if (started) return true;
+        if (GetLastError () != ERROR_IO_PENDING) return false;
+
+        return GetOverlappedResult (port, & overlapped, & bytesTransferred, 1) != 0;
+    }
+
+    virtual long read (char *buffer, size_t size) {
+        unsigned long errorFlags, bytesRead = 0;
+        COMSTAT commState;
+        OVERLAPPED overlapped;
+
+        if (!ClearCommError (port, & errorFlags, & commState)) return -1;
+        if (commState.cbInQue == 0) return 0;
+
+        unsigned long bytesToRead = commState.cbInQue < size ? commState.cbInQue : (unsigned long) size;
+
+        memset (& overlapped, 0, sizeof (overlapped));
+        overlapped.hEvent = readEvent;
+
+        if (!complete (ReadFile (port, buffer, bytesToRead, & bytesRead, & overlapped), overlapped, bytesRead)) return -1;
+
+        return (long) bytesRead;
+    }
+
+    virtual long write (const char *data, size_t size) {
+        unsigned long bytesSent = 0;
+        OVERLAPPED overlapped;
+
+        memset (& overlapped, 0, sizeof (overlapped));
+        overlapped.hEvent = writeEvent;
+
+        if (WriteFile (port, data, (unsigned long) size, & bytesSent, & overlapped)) return (long) bytesSent;
+        if (GetLastError () != ERROR_IO_PENDING) return -1;
+
+        // a port held by XOFF would keep the writer here for ever; interrupt () lets it go with what got out
+        HANDLE events [2] { writeEvent, stopEvent };
+
+        if (WaitForMultipleObjects (2, events, 0, INFINITE) != WAIT_OBJECT_0) CancelIo (port);
+
+        if (!GetOverlappedResult (port, & overlapped, & bytesSent, 1)) return bytesSent > 0 ? (long) bytesSent : -1;
+
+        return (long) bytesSent;
+    }
+
+    virtual WaitResult waitForData (uint32_t timeoutMs) {
+        unsigned long errorFlags, eventMask = 0, bytesTransferred;
+        COMSTAT commState;
+        OVERLAPPED overlapped;
+
+        if (WaitForSingleObject (stopEvent, 0) == WAIT_OBJECT_0) return WaitResult::WaitInterrupted;
+        if (!ClearCommError (port, & errorFlags, & commState)) return WaitResult::WaitFailed;
+        if (commState.cbInQue > 0) return WaitResult::DataReady;
+
+        memset (& overlapped, 0, sizeof (overlapped));
+        overlapped.hEvent = commEvent;
+
+        if (WaitCommEvent (port, & eventMask, & overlapped)) return WaitResult::DataReady;
+        if (GetLastError () != ERROR_IO_PENDING) return WaitResult::WaitFailed;
+
+        HANDLE events [2] { commEvent, stopEvent };
+
+        switch (WaitForMultipleObjects (2, events, 0, timeoutMs == WAIT_FOREVER ? INFINITE : timeoutMs)) {
+            case WAIT_OBJECT_0:
+                return GetOverlappedResult (port, & overlapped, & bytesTransferred, 0) ? WaitResult::DataReady : WaitResult::WaitFailed;
+            case WAIT_OBJECT_0 + 1:
+                CancelIo (port);
+                GetOverlappedResult (port, & overlapped, & bytesTransferred, 1);
+                return WaitResult::WaitInterrupted;
+            case WAIT_TIMEOUT:
+                CancelIo (port);
+                GetOverlappedResult (port, & overlapped, & bytesTransferred, 1);
+                return WaitResult::WaitTimeout;
+            default:
+                return WaitResult::WaitFailed;
+        }
+    }
+
+    virtual void interrupt () {
+        SetEvent (stopEvent);
+    }
+};
+
+Transport *openSerialTransport (const char *name, uint32_t baudRate) {
+    HANDLE port = CreateFile (name, GENERIC_READ | GENERIC_WRITE, 0, 0, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, 0);
+
+    if (port == INVALID_HANDLE_VALUE) return 0;
+
+    DCB dcb;
+
+    SetupComm (port, 4096, 4096);
+    PurgeComm (port, PURGE_TXABORT | PURGE_RXABORT | PURGE_TXCLEAR | PURGE_RXCLEAR);
+
+    memset (& dcb, 0, sizeof (dcb));
+
+    GetCommState (port, & dcb);
+
+    dcb.BaudRate = baudRate;
+    dcb.ByteSize = 8;
+    dcb.StopBits = ONESTOPBIT;
+    dcb.Parity = NOPARITY;
+    dcb.fBinary = 1;
+    dcb.fParity = 1;
+    dcb.fInX =
+    dcb.fOutX = 1;
+    dcb.XonChar = ASCII_XON;
+    dcb.XoffChar = ASCII_XOFF;
+    dcb.XonLim = 100;
+    dcb.XoffLim = 100;
+
+    // reads return at once with whatever is queued, waiting is done by WaitCommEvent
+    COMMTIMEOUTS timeouts { MAXDWORD, 0, 0, 0, 0 };
+
+    if (!SetCommState (port, & dcb) || !SetCommTimeouts (port, & timeouts)) {
+        CloseHandle (port); return 0;
+    }
+
+    return new Win32Transport (port);
+}
+
+#endif
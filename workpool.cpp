@@ -0,0 +1,62 @@
+#include <thread>
+#include <vector>
+#include <memory>
+#include "workpool.h"
+
+WorkStealingPool::WorkStealingPool (size_t _numOfThreads): numOfThreads (_numOfThreads) {
+    if (numOfThreads == 0) numOfThreads = std::thread::hardware_concurrency ();
+    if (numOfThreads == 0) numOfThreads = 1;
+}
+
+bool WorkStealingPool::takeJob (WorkerQueue *queues, size_t numOfWorkers, size_t worker, size_t& job) {
+    {
+        std::lock_guard<std::mutex> guard (queues [worker].lock);
+
+        if (!queues [worker].jobs.empty ()) {
+            job = queues [worker].jobs.front ();
+            queues [worker].jobs.pop_front ();
+
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < numOfWorkers; ++ i) {
+        WorkerQueue& victim = queues [(worker + i) % numOfWorkers];
+        std::lock_guard<std::mutex> guard (victim.lock);
+
+        if (!victim.jobs.empty ()) {
+            job = victim.jobs.back ();
+            victim.jobs.pop_back ();
+
+            return true;
+        }
+    }
+
+    // no job produces new jobs, so once every deque is seen empty there is nothing left to do
+    return false;
+}
+
+void WorkStealingPool::run (size_t count, std::function<void (size_t)> job) {
+    size_t numOfWorkers = numOfThreads < count ? numOfThreads : count;
+
+    if (numOfWorkers <= 1) {
+        for (size_t i = 0; i < count; ++ i) job (i);
+
+        return;
+    }
+
+    std::unique_ptr<WorkerQueue []> queues (new WorkerQueue [numOfWorkers]);
+    std::vector<std::thread> workers;
+
+    for (size_t i = 0; i < count; ++ i) queues [i % numOfWorkers].jobs.push_back (i);
+
+    for (size_t worker = 0; worker < numOfWorkers; ++ worker) {
+        workers.emplace_back ([this, &queues, &job, numOfWorkers, worker] () {
+            size_t index;
+
+            while (takeJob (queues.get (), numOfWorkers, worker, index)) job (index);
+        });
+    }
+
+    for (auto& worker: workers) worker.join ();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <functional>
+
+// Runs job (0) .. job (count - 1) on the given number of threads. Jobs are dealt round-robin into a deque
+// per worker; a worker takes from the front of its own deque and, once that is empty, steals from the back
+// of the others, so a few long jobs do not leave the remaining threads idle.
+struct WorkStealingPool {
+    struct WorkerQueue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    size_t numOfThreads;
+
+    WorkStealingPool (size_t _numOfThreads = 0);
+
+    void run (size_t count, std::function<void (size_t)> job);
+
+    private:
+        bool takeJob (WorkerQueue *queues, size_t numOfWorkers, size_t worker, size_t& job);
+};